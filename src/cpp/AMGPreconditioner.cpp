@@ -0,0 +1,607 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#include "AMGPreconditioner.h"
+#include "Eigen/Dense"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+using namespace std;
+using namespace Eigen;
+
+//  y = A * x
+void CAMGPreconditioner::CSparseRows::Multiply(const double* x, double* y) const
+{
+    for (int i = 0; i < Rows; i++)
+    {
+        double sum = 0.0;
+        for (CSRIndex_t p = Start[i]; p < Start[i + 1]; p++)
+            sum += Value[p] * x[Index[p]];
+        y[i] = sum;
+    }
+}
+
+//  Row start of a level matrix, which must be addressable by CSRIndex_t
+static CSRIndex_t RowStart(size_t Position)
+{
+    if (Position > size_t(numeric_limits<CSRIndex_t>::max()))
+    {
+        cerr << "*** Error *** An AMG level has more entries than CSRIndex_t can address," << endl
+             << "    rebuild with STAP++_INDEX64" << endl;
+        exit(6);
+    }
+
+    return CSRIndex_t(Position);
+}
+
+//  C = A * B, row by row with a dense accumulator; the columns of each row are sorted
+void CAMGPreconditioner::Product(const CSparseRows& A, const CSparseRows& B, CSparseRows& C)
+{
+    C.Rows = A.Rows;
+    C.Columns = B.Columns;
+    C.Start.assign(A.Rows + 1, 0);
+    C.Index.clear();
+    C.Value.clear();
+
+    vector<int> Marker(B.Columns, -1);
+    vector<double> Sum(B.Columns, 0.0);
+
+    for (int i = 0; i < A.Rows; i++)
+    {
+        const size_t first = C.Index.size();
+
+        for (CSRIndex_t p = A.Start[i]; p < A.Start[i + 1]; p++)
+        {
+            const int k = A.Index[p];
+            const double a = A.Value[p];
+            for (CSRIndex_t q = B.Start[k]; q < B.Start[k + 1]; q++)
+            {
+                const int j = B.Index[q];
+                if (Marker[j] != i)
+                {
+                    Marker[j] = i;
+                    Sum[j] = 0.0;
+                    C.Index.push_back(j);
+                }
+                Sum[j] += a * B.Value[q];
+            }
+        }
+
+        sort(C.Index.begin() + first, C.Index.end());
+        for (size_t q = first; q < C.Index.size(); q++)
+            C.Value.push_back(Sum[C.Index[q]]);
+
+        C.Start[i + 1] = RowStart(C.Index.size());
+    }
+}
+
+//  T = A^T
+void CAMGPreconditioner::Transpose(const CSparseRows& A, CSparseRows& T)
+{
+    T.Rows = A.Columns;
+    T.Columns = A.Rows;
+    T.Start.assign(T.Rows + 1, 0);
+    T.Index.resize(A.Index.size());
+    T.Value.resize(A.Value.size());
+
+    for (size_t p = 0; p < A.Index.size(); p++)
+        T.Start[A.Index[p] + 1]++;
+    for (int i = 0; i < T.Rows; i++)
+        T.Start[i + 1] += T.Start[i];
+
+    vector<CSRIndex_t> Next(T.Start.begin(), T.Start.end() - 1);
+    for (int i = 0; i < A.Rows; i++)
+        for (CSRIndex_t p = A.Start[i]; p < A.Start[i + 1]; p++)
+        {
+            const CSRIndex_t q = Next[A.Index[p]]++;
+            T.Index[q] = i;
+            T.Value[q] = A.Value[p];
+        }
+}
+
+//  Constructor: build the hierarchy of levels
+CAMGPreconditioner::CAMGPreconditioner(CSRMatrix<double>& K, const vector<int>& _BlockStart,
+                                       const vector<int>& _BlockIndex,
+                                       const vector<double>& _NullSpace, int NumModes)
+{
+    const int N = K.size;
+
+    // Finest level: both triangles of K
+    Levels.resize(1);
+    CSparseRows& A = Levels[0].A;
+    A.Rows = A.Columns = N;
+    A.Start.assign(N + 1, 0);
+    for (int row = 0; row < N; row++)
+        for (CSRIndex_t p = K.rowIndexs[row] - 1; p < K.rowIndexs[row + 1] - 1; p++)
+        {
+            A.Start[row + 1]++;
+            if (K.columns[p] - 1 != row)
+                A.Start[K.columns[p]]++;
+        }
+    size_t Entries = 0;
+    for (int i = 0; i < N; i++)
+        Entries += size_t(A.Start[i + 1]);
+    RowStart(Entries);
+    for (int i = 0; i < N; i++)
+        A.Start[i + 1] += A.Start[i];
+
+    A.Index.resize(A.Start[N]);
+    A.Value.resize(A.Start[N]);
+    {
+        vector<CSRIndex_t> Next(A.Start.begin(), A.Start.end() - 1);
+        for (int row = 0; row < N; row++)
+            for (CSRIndex_t p = K.rowIndexs[row] - 1; p < K.rowIndexs[row + 1] - 1; p++)
+            {
+                const int column = K.columns[p] - 1;
+                A.Index[Next[row]] = column;
+                A.Value[Next[row]++] = K.values[p];
+                if (column != row)
+                {
+                    A.Index[Next[column]] = row;
+                    A.Value[Next[column]++] = K.values[p];
+                }
+            }
+    }
+
+    // Equations left out of the nodal blocks become blocks of their own
+    vector<int> BlockStart(_BlockStart), BlockIndex(_BlockIndex);
+    vector<double> NullSpace(_NullSpace);
+    {
+        vector<bool> Listed(N, false);
+        for (int eq : BlockIndex)
+            Listed[eq] = true;
+
+        if (BlockStart.empty())
+            BlockStart.push_back(0);
+
+        for (int eq = 0; eq < N; eq++)
+            if (!Listed[eq])
+            {
+                BlockIndex.push_back(eq);
+                BlockStart.push_back(int(BlockIndex.size()));
+            }
+    }
+
+    double Theta = 0.08;
+    while (Levels.back().A.Rows > CoarseSize && Levels.size() < 10)
+    {
+        if (!Coarsen(Levels.size() - 1, BlockStart, BlockIndex, NullSpace, NumModes, Theta))
+            break;
+        Theta *= 0.5;
+    }
+
+    for (CLevel& Level : Levels)
+    {
+        const int n = Level.A.Rows;
+        Level.x.resize(n);
+        Level.b.resize(n);
+        Level.r.resize(n);
+
+        Level.Diagonal.assign(n, -1);
+        for (int i = 0; i < n; i++)
+            for (CSRIndex_t p = Level.A.Start[i]; p < Level.A.Start[i + 1]; p++)
+                if (Level.A.Index[p] == i)
+                    Level.Diagonal[i] = p;
+    }
+
+    // Direct solution on the coarsest level
+    const CSparseRows& Ac = Levels.back().A;
+    if (Ac.Rows <= 4 * CoarseSize)
+    {
+        MatrixXd Dense = MatrixXd::Zero(Ac.Rows, Ac.Rows);
+        for (int i = 0; i < Ac.Rows; i++)
+            for (CSRIndex_t p = Ac.Start[i]; p < Ac.Start[i + 1]; p++)
+                Dense(i, Ac.Index[p]) = Ac.Value[p];
+
+        CoarseInverse.resize(size_t(Ac.Rows) * Ac.Rows);
+        Map<MatrixXd>(CoarseInverse.data(), Ac.Rows, Ac.Rows) =
+            Dense.ldlt().solve(MatrixXd::Identity(Ac.Rows, Ac.Rows));
+    }
+}
+
+//  Build level l+1 by smoothed aggregation of the blocks of level l
+bool CAMGPreconditioner::Coarsen(size_t l, vector<int>& BlockStart, vector<int>& BlockIndex,
+                                 vector<double>& NullSpace, int NumModes, double Theta)
+{
+    const CSparseRows& A = Levels[l].A;
+    const int n = A.Rows;
+    const int NB = int(BlockStart.size()) - 1;
+
+    vector<int> BlockOf(n);
+    for (int b = 0; b < NB; b++)
+        for (int p = BlockStart[b]; p < BlockStart[b + 1]; p++)
+            BlockOf[BlockIndex[p]] = b;
+
+    // Strength of connection between blocks: ||A_ab|| >= Theta * sqrt(||A_aa|| * ||A_bb||)
+    vector<int> SStart(NB + 1, 0), SIndex;
+    vector<double> SNorm, DiagNorm(NB, 0.0);
+    {
+        vector<int> Marker(NB, -1), Touched;
+        vector<double> Norm(NB, 0.0);
+        vector<int> NbrStart(NB + 1, 0), NbrIndex;
+        vector<double> NbrNorm;
+
+        for (int b = 0; b < NB; b++)
+        {
+            Touched.clear();
+            for (int p = BlockStart[b]; p < BlockStart[b + 1]; p++)
+            {
+                const int i = BlockIndex[p];
+                for (CSRIndex_t q = A.Start[i]; q < A.Start[i + 1]; q++)
+                {
+                    const int c = BlockOf[A.Index[q]];
+                    if (Marker[c] != b)
+                    {
+                        Marker[c] = b;
+                        Norm[c] = 0.0;
+                        Touched.push_back(c);
+                    }
+                    Norm[c] += A.Value[q] * A.Value[q];
+                }
+            }
+
+            sort(Touched.begin(), Touched.end());
+            for (int c : Touched)
+            {
+                if (c == b)
+                    DiagNorm[b] = sqrt(Norm[c]);
+                else
+                {
+                    NbrIndex.push_back(c);
+                    NbrNorm.push_back(sqrt(Norm[c]));
+                }
+            }
+            NbrStart[b + 1] = int(NbrIndex.size());
+        }
+
+        for (int b = 0; b < NB; b++)
+        {
+            for (int p = NbrStart[b]; p < NbrStart[b + 1]; p++)
+                if (NbrNorm[p] >= Theta * sqrt(DiagNorm[b] * DiagNorm[NbrIndex[p]]))
+                {
+                    SIndex.push_back(NbrIndex[p]);
+                    SNorm.push_back(NbrNorm[p]);
+                }
+            SStart[b + 1] = int(SIndex.size());
+        }
+    }
+
+    // Aggregation
+    vector<int> Aggregate(NB, -1);
+    int NA = 0;
+
+    // Pass 1: a block whose strong neighbours are all free forms an aggregate with them
+    for (int b = 0; b < NB; b++)
+    {
+        if (Aggregate[b] != -1 || SStart[b] == SStart[b + 1])
+            continue;
+
+        bool Free = true;
+        for (int p = SStart[b]; p < SStart[b + 1] && Free; p++)
+            Free = Aggregate[SIndex[p]] == -1;
+
+        if (!Free)
+            continue;
+
+        Aggregate[b] = NA;
+        for (int p = SStart[b]; p < SStart[b + 1]; p++)
+            Aggregate[SIndex[p]] = NA;
+        NA++;
+    }
+
+    // Pass 2: the remaining blocks join the aggregate of their strongest aggregated neighbour
+    {
+        vector<int> Pass1(Aggregate);
+        for (int b = 0; b < NB; b++)
+        {
+            if (Pass1[b] != -1)
+                continue;
+
+            double Strongest = -1.0;
+            for (int p = SStart[b]; p < SStart[b + 1]; p++)
+                if (Pass1[SIndex[p]] != -1 && SNorm[p] > Strongest)
+                {
+                    Strongest = SNorm[p];
+                    Aggregate[b] = Pass1[SIndex[p]];
+                }
+        }
+    }
+
+    // Pass 3: the blocks still free form aggregates with their free strong neighbours
+    for (int b = 0; b < NB; b++)
+    {
+        if (Aggregate[b] != -1 || SStart[b] == SStart[b + 1])
+            continue;
+
+        Aggregate[b] = NA;
+        for (int p = SStart[b]; p < SStart[b + 1]; p++)
+            if (Aggregate[SIndex[p]] == -1)
+                Aggregate[SIndex[p]] = NA;
+        NA++;
+    }
+
+    if (NA == 0)
+        return false;
+
+    // Tentative prolongator: orthonormalize the near null space on each aggregate
+    vector<vector<int>> Rows(NA);
+    for (int b = 0; b < NB; b++)
+        if (Aggregate[b] != -1)
+            for (int p = BlockStart[b]; p < BlockStart[b + 1]; p++)
+                Rows[Aggregate[b]].push_back(BlockIndex[p]);
+
+    vector<int> PRowCount(n, 0);
+    vector<int> PColumn(size_t(n) * NumModes);
+    vector<double> PValue(size_t(n) * NumModes);
+
+    vector<int> CoarseBlockStart(1, 0), CoarseBlockIndex;
+    vector<double> CoarseNullSpace;
+    int nc = 0;
+
+    for (int a = 0; a < NA; a++)
+    {
+        const vector<int>& I = Rows[a];
+        const int m = int(I.size());
+
+        MatrixXd Ba(m, NumModes);
+        for (int i = 0; i < m; i++)
+            for (int k = 0; k < NumModes; k++)
+                Ba(i, k) = NullSpace[size_t(I[i]) * NumModes + k];
+
+        // Modified Gram-Schmidt, dropping the modes that are dependent on this aggregate
+        MatrixXd Q(m, NumModes);
+        MatrixXd R = MatrixXd::Zero(NumModes, NumModes);
+        int rank = 0;
+        for (int k = 0; k < NumModes && rank < m; k++)
+        {
+            VectorXd v = Ba.col(k);
+            const double norm0 = v.norm();
+            for (int pass = 0; pass < 2; pass++)
+                for (int j = 0; j < rank; j++)
+                {
+                    const double h = Q.col(j).dot(v);
+                    R(j, k) += h;
+                    v -= h * Q.col(j);
+                }
+
+            const double norm = v.norm();
+            if (norm0 == 0.0 || norm <= 1.0e-10 * norm0)
+                continue;
+
+            Q.col(rank) = v / norm;
+            R(rank, k) = norm;
+            rank++;
+        }
+
+        for (int i = 0; i < m; i++)
+            for (int j = 0; j < rank; j++)
+            {
+                const size_t q = size_t(I[i]) * NumModes + PRowCount[I[i]]++;
+                PColumn[q] = nc + j;
+                PValue[q] = Q(i, j);
+            }
+
+        for (int j = 0; j < rank; j++)
+        {
+            CoarseBlockIndex.push_back(nc + j);
+            for (int k = 0; k < NumModes; k++)
+                CoarseNullSpace.push_back(R(j, k));
+        }
+        CoarseBlockStart.push_back(int(CoarseBlockIndex.size()));
+        nc += rank;
+    }
+
+    if (nc == 0 || nc >= n)
+        return false;
+
+    CSparseRows P0;
+    P0.Rows = n;
+    P0.Columns = nc;
+    P0.Start.assign(n + 1, 0);
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < PRowCount[i]; j++)
+        {
+            P0.Index.push_back(PColumn[size_t(i) * NumModes + j]);
+            P0.Value.push_back(PValue[size_t(i) * NumModes + j]);
+        }
+        P0.Start[i + 1] = RowStart(P0.Index.size());
+    }
+
+    // Spectral radius of D^(-1)*A by power iteration
+    vector<double> InvDiag(n, 0.0);
+    for (int i = 0; i < n; i++)
+        for (CSRIndex_t p = A.Start[i]; p < A.Start[i + 1]; p++)
+            if (A.Index[p] == i && A.Value[p] != 0.0)
+                InvDiag[i] = 1.0 / A.Value[p];
+
+    double Rho = 1.0;
+    {
+        vector<double> v(n), w(n);
+        for (int i = 0; i < n; i++)
+            v[i] = 1.0 + 0.1 * (i % 7);
+
+        for (int it = 0; it < 15; it++)
+        {
+            A.Multiply(v.data(), w.data());
+            double nv = 0.0, nw = 0.0;
+            for (int i = 0; i < n; i++)
+            {
+                w[i] *= InvDiag[i];
+                nv += v[i] * v[i];
+                nw += w[i] * w[i];
+            }
+            if (nw == 0.0)
+                break;
+
+            Rho = sqrt(nw / nv);
+            const double scale = 1.0 / sqrt(nw);
+            for (int i = 0; i < n; i++)
+                v[i] = w[i] * scale;
+        }
+    }
+
+    // Smoothed prolongator P = (I - omega*D^(-1)*A) * P0
+    const double Omega = 4.0 / (3.0 * Rho);
+
+    CSparseRows AP0;
+    Product(A, P0, AP0);
+
+    CSparseRows& P = Levels[l].P;
+    P.Rows = n;
+    P.Columns = nc;
+    P.Start.assign(n + 1, 0);
+    P.Index.clear();
+    P.Value.clear();
+    {
+        vector<int> Marker(nc, -1);
+        vector<double> Sum(nc, 0.0);
+        for (int i = 0; i < n; i++)
+        {
+            const size_t first = P.Index.size();
+            for (CSRIndex_t p = P0.Start[i]; p < P0.Start[i + 1]; p++)
+            {
+                Marker[P0.Index[p]] = i;
+                Sum[P0.Index[p]] = P0.Value[p];
+                P.Index.push_back(P0.Index[p]);
+            }
+            for (CSRIndex_t p = AP0.Start[i]; p < AP0.Start[i + 1]; p++)
+            {
+                const int j = AP0.Index[p];
+                if (Marker[j] != i)
+                {
+                    Marker[j] = i;
+                    Sum[j] = 0.0;
+                    P.Index.push_back(j);
+                }
+                Sum[j] -= Omega * InvDiag[i] * AP0.Value[p];
+            }
+
+            sort(P.Index.begin() + first, P.Index.end());
+            for (size_t q = first; q < P.Index.size(); q++)
+                P.Value.push_back(Sum[P.Index[q]]);
+            P.Start[i + 1] = RowStart(P.Index.size());
+        }
+    }
+
+    Transpose(P, Levels[l].R);
+
+    // Galerkin coarse matrix R*A*P
+    CLevel Coarse;
+    {
+        CSparseRows AP;
+        Product(A, P, AP);
+        Product(Levels[l].R, AP, Coarse.A);
+    }
+    Levels.push_back(Coarse);
+
+    BlockStart.swap(CoarseBlockStart);
+    BlockIndex.swap(CoarseBlockIndex);
+    NullSpace.swap(CoarseNullSpace);
+
+    return true;
+}
+
+//  Gauss-Seidel sweep on level l
+void CAMGPreconditioner::GaussSeidel(size_t l, bool Forward)
+{
+    CLevel& Level = Levels[l];
+    const CSparseRows& A = Level.A;
+    const int n = A.Rows;
+
+    for (int k = 0; k < n; k++)
+    {
+        const int i = Forward ? k : n - 1 - k;
+        if (Level.Diagonal[i] < 0)
+            continue;
+
+        double sum = Level.b[i];
+        for (CSRIndex_t p = A.Start[i]; p < A.Start[i + 1]; p++)
+            sum -= A.Value[p] * Level.x[A.Index[p]];
+
+        Level.x[i] += sum / A.Value[Level.Diagonal[i]];
+    }
+}
+
+//  V-cycle on level l
+void CAMGPreconditioner::Cycle(size_t l)
+{
+    CLevel& Level = Levels[l];
+    const int n = Level.A.Rows;
+
+    if (l + 1 == Levels.size())
+    {
+        if (!CoarseInverse.empty())
+        {
+            for (int i = 0; i < n; i++)
+                Level.x[i] = 0.0;
+            for (int j = 0; j < n; j++)
+            {
+                const double* Column = &CoarseInverse[size_t(j) * n];
+                for (int i = 0; i < n; i++)
+                    Level.x[i] += Column[i] * Level.b[j];
+            }
+        }
+        else
+        {
+            fill(Level.x.begin(), Level.x.end(), 0.0);
+            for (int sweep = 0; sweep < 4; sweep++)
+            {
+                GaussSeidel(l, true);
+                GaussSeidel(l, false);
+            }
+        }
+
+        return;
+    }
+
+    fill(Level.x.begin(), Level.x.end(), 0.0);
+    GaussSeidel(l, true);
+
+    Level.A.Multiply(Level.x.data(), Level.r.data());
+    for (int i = 0; i < n; i++)
+        Level.r[i] = Level.b[i] - Level.r[i];
+
+    CLevel& Coarse = Levels[l + 1];
+    Level.R.Multiply(Level.r.data(), Coarse.b.data());
+
+    Cycle(l + 1);
+
+    Level.P.Multiply(Coarse.x.data(), Level.r.data());
+    for (int i = 0; i < n; i++)
+        Level.x[i] += Level.r[i];
+
+    GaussSeidel(l, false);
+}
+
+//  Apply one V-cycle: z = M^(-1) r
+void CAMGPreconditioner::Apply(const double* r, double* z)
+{
+    CLevel& Fine = Levels[0];
+    copy(r, r + Fine.A.Rows, Fine.b.begin());
+
+    Cycle(0);
+
+    copy(Fine.x.begin(), Fine.x.end(), z);
+}
+
+//  Operator complexity
+double CAMGPreconditioner::GetOperatorComplexity() const
+{
+    double nnz = 0.0;
+    for (const CLevel& Level : Levels)
+        nnz += Level.A.Value.size();
+
+    return nnz / Levels[0].A.Value.size();
+}
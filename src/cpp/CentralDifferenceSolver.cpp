@@ -0,0 +1,196 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#include "CentralDifferenceSolver.h"
+
+#ifdef _VIB_
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "Eigen/Dense"
+#include "ThreadPool.h"
+
+using namespace std;
+
+CCentralDifferenceSolver::CCentralDifferenceSolver(CElementGroup* EleGrpList, unsigned int NUMEG, Index_t NEQ,
+                                                   const double* _LumpedM, MassTypes _MassType,
+                                                   double _DampingM, double _DampingK, unsigned int _NumThreads)
+    : N(NEQ), LumpedM(_LumpedM), MassType(_MassType), DampingM(_DampingM), DampingK(_DampingK),
+      NumThreads(_NumThreads), TimeStep(0.0), Time(0.0), FirstStep(true)
+{
+    if (NumThreads == 0)
+        NumThreads = max(thread::hardware_concurrency(), 1u);
+
+    for (unsigned int EleGrp = 0; EleGrp < NUMEG; EleGrp++)
+        EleGrpList[EleGrp].AppendElements(Elements);
+
+    MatrixStart.assign(Elements.size() + 1, 0);
+    ForceStart.assign(Elements.size() + 1, 0);
+    for (size_t e = 0; e < Elements.size(); e++)
+    {
+        MatrixStart[e + 1] = MatrixStart[e] + Elements[e]->SizeOfStiffnessMatrix();
+        ForceStart[e + 1] = ForceStart[e] + Elements[e]->GetLMSize();
+    }
+
+    Matrices.resize(MatrixStart.back());
+    ElementForces.resize(ForceStart.back());
+
+    ForEach(Elements.size(), [this](size_t begin, size_t end)
+    {
+        for (size_t e = begin; e < end; e++)
+            Elements[e]->CondensedStiffness(&Matrices[MatrixStart[e]]);
+    });
+
+//  Slots of the active DOFs of the elements, equation by equation
+    GatherStart.assign(N + 1, 0);
+    for (size_t e = 0; e < Elements.size(); e++)
+    {
+        const Index_t* LM = Elements[e]->GetLocationMatrix();
+        for (unsigned int j = 0; j < Elements[e]->GetLMSize(); j++)
+            if (LM[j])
+                GatherStart[LM[j]]++;
+    }
+
+    for (Index_t i = 0; i < N; i++)
+        GatherStart[i + 1] += GatherStart[i];
+
+    GatherIndex.resize(GatherStart[N]);
+    vector<size_t> Next(GatherStart.begin(), GatherStart.end() - 1);
+    for (size_t e = 0; e < Elements.size(); e++)
+    {
+        const Index_t* LM = Elements[e]->GetLocationMatrix();
+        for (unsigned int j = 0; j < Elements[e]->GetLMSize(); j++)
+            if (LM[j])
+                GatherIndex[Next[LM[j] - 1]++] = ForceStart[e] + j;
+    }
+}
+
+//  The ranges are split evenly over the tasks of the thread pool
+template <class Task_>
+void CCentralDifferenceSolver::ForEach(size_t Size, Task_ Task)
+{
+    const unsigned int Tasks = (unsigned int)max<size_t>(1, min<size_t>(NumThreads, Size / 256));
+
+    CThreadPool::Instance().Run(Tasks, [&](unsigned int t)
+    {
+        Task(Size * t / Tasks, Size * (t + 1) / Tasks);
+    });
+}
+
+//  The highest frequency of the model is at most the highest one of its elements (Irons), which
+//  are calculated on the active DOFs with element mass, from D^-1/2 K_e D^-1/2 with D the lumped
+//  element mass matrix. With the damping ratio xi = DampingK*omega/2 of the highest frequency,
+//  the stable step is 2/omega (sqrt(1 + xi^2) - xi)
+double CCentralDifferenceSolver::StableTimeStep()
+{
+    double OmegaMax2 = 0.0;
+
+    vector<double> Mass, Lumped;
+    vector<unsigned int> Active;
+    for (size_t e = 0; e < Elements.size(); e++)
+    {
+        CElement& Element = *Elements[e];
+        const unsigned int ND = Element.GetLMSize();
+        const Index_t* LM = Element.GetLocationMatrix();
+
+        Mass.resize(Element.SizeOfStiffnessMatrix());
+        Lumped.resize(ND);
+        Element.ElementMass(Mass.data());
+        Element.LumpMass(Mass.data(), Lumped.data(), MassType);
+
+        Active.clear();
+        for (unsigned int j = 0; j < ND; j++)
+            if (LM[j] && Lumped[j] > 0.0)
+                Active.push_back(j);
+
+        if (Active.empty())
+            continue;
+
+        const double* Ke = &Matrices[MatrixStart[e]];
+        Eigen::MatrixXd S(Active.size(), Active.size());
+        for (size_t b = 0; b < Active.size(); b++)
+            for (size_t a = 0; a <= b; a++)
+            {
+                const unsigned int i = Active[a], j = Active[b];  // i <= j
+                S(a, b) = S(b, a) = Ke[(j + 1) * j / 2 + j - i] / sqrt(Lumped[i] * Lumped[j]);
+            }
+
+        Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> Eig(S, Eigen::EigenvaluesOnly);
+        OmegaMax2 = max(OmegaMax2, Eig.eigenvalues().maxCoeff());
+    }
+
+    if (OmegaMax2 <= 0.0)
+        return 0.0;
+
+    const double Omega = sqrt(OmegaMax2);
+    const double xi = 0.5 * DampingK * Omega;
+    return 2.0 / Omega * (sqrt(1.0 + xi * xi) - xi);
+}
+
+//  The DOFs without mass get no acceleration
+void CCentralDifferenceSolver::Initialize(double _TimeStep, const double* Force)
+{
+    TimeStep = _TimeStep;
+    Time = 0.0;
+    FirstStep = true;
+
+    U.assign(N, 0.0);
+    V.assign(N, 0.0);
+    W.assign(N, 0.0);
+    A.resize(N);
+
+    for (Index_t i = 0; i < N; i++)
+        A[i] = LumpedM[i] > 0.0 ? Force[i] / LumpedM[i] : 0.0;
+}
+
+//  The first step starts from v_0, i.e. v_1/2 = v_0 + dt/2 a_0
+void CCentralDifferenceSolver::Step(const double* NextForce)
+{
+    const double dt = TimeStep;
+    const double dv = FirstStep ? 0.5 * dt : dt;
+    FirstStep = false;
+
+    for (Index_t i = 0; i < N; i++)
+    {
+        V[i] += dv * A[i];
+        U[i] += dt * V[i];
+        W[i] = U[i] + DampingK * V[i];
+    }
+
+    // Element forces K_e w_e
+    ForEach(Elements.size(), [this](size_t begin, size_t end)
+    {
+        vector<double> we;
+        for (size_t e = begin; e < end; e++)
+        {
+            we.resize(Elements[e]->GetLMSize());
+            Elements[e]->GatherDOFs(W.data(), we.data());
+            Elements[e]->MatrixProduct(&Matrices[MatrixStart[e]], we.data(), &ElementForces[ForceStart[e]]);
+        }
+    });
+
+    ForEach(N, [this, NextForce](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            double Internal = 0.0;
+            for (size_t k = GatherStart[i]; k < GatherStart[i + 1]; k++)
+                Internal += ElementForces[GatherIndex[k]];
+
+            A[i] = LumpedM[i] > 0.0 ? (NextForce[i] - Internal) / LumpedM[i] - DampingM * V[i] : 0.0;
+        }
+    });
+
+    Time += dt;
+}
+
+#endif
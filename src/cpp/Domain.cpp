@@ -12,20 +12,30 @@
 #include "Material.h"
 #include <Eigen/Dense>
 #ifdef _VIB_
-#include "mkl.h"
+#include "LanczosSolver.h"
+#include "SpectrumSlicer.h"
+#include "NewmarkSolver.h"
+#include "CentralDifferenceSolver.h"
 #endif
 #include <cmath>
+#include <limits>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
 
 using namespace std;
 using namespace Eigen;
 
 //	Clear an array
-template <class type> void clear( type* a, unsigned int N )
+template <class type> void clear( type* a, size_t N )
 {
-	for (unsigned int i = 0; i < N; i++)
+	for (size_t i = 0; i < N; i++)
 		a[i] = 0;
 }
 
+//	Elements call clear() from other translation units, so instantiate it here
+template void clear<double>(double* a, size_t N);
+
 CDomain* CDomain::_instance = nullptr;
 
 //	Constructor
@@ -45,6 +55,7 @@ CDomain::CDomain()
 	LoadCases = nullptr;
 	
 	NEQ = 0;
+	NCEQ = 0;
 	NWK = 0;
 	MK = 0;
 
@@ -52,8 +63,39 @@ CDomain::CDomain()
 	StiffnessMatrix = nullptr;
 #ifdef _VIB_
 	MassMatrix = nullptr;
+	LumpedMass = nullptr;
+	MassType = MassTypes::Consistent;
+	Explicit = false;
+
+	NumSteps = 0;
+	TimeStep = HHTAlpha = StableTimeStep = 0.0;
+	DampingM = DampingK = 0.0;
 #endif
 	CSRStiffnessMatrix = nullptr;
+	Substructures = nullptr;
+	NumParts = 1;
+
+#ifdef MKL
+	SolverType = SolverTypes::PARDISO;
+#else
+	SolverType = SolverTypes::LDLT;
+#endif
+
+	NodeOrdering = OrderingTypes::Input;
+	InputProfile = OrderedProfile = 0;
+	InputBandwidth = OrderedBandwidth = 0;
+	InputOrderKept = false;
+
+	SparseOrdering = OrderingTypes::ND;
+	PredictedFill = PredictedFlops = 0.0;
+
+	SolverChosen = false;
+	SkylineFill = SkylineFlops = CSREntries = AvailableMemory = 0.0;
+	EstimatedMemory = EstimatedFlops = 0.0;
+
+	ModelKey = 0;
+
+	OutOfCoreBudget = 0;
 }
 
 //	Destructor
@@ -70,8 +112,10 @@ CDomain::~CDomain()
 	delete StiffnessMatrix;
 #ifdef _VIB_
 	delete MassMatrix;
+	delete [] LumpedMass;
 #endif
 	delete CSRStiffnessMatrix;
+	delete Substructures;
 }
 
 //	Return pointer to the instance of the Domain class
@@ -83,6 +127,30 @@ CDomain* CDomain::Instance()
 	return _instance;
 }
 
+//	FNV-1a hash of the bytes of Value
+template <class type> static void HashValue(unsigned long long& Hash, const type& Value)
+{
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&Value);
+	for (size_t i = 0; i < sizeof(type); i++)
+		Hash = (Hash ^ bytes[i]) * 1099511628211ULL;
+}
+
+//	Hash the whitespace separated tokens of file FileName between Begin and End,
+//	so that the key does not depend on the layout of the data lines
+static void HashTokens(const string& FileName, streampos Begin, streampos End, unsigned long long& Hash)
+{
+	ifstream File(FileName);
+	File.seekg(Begin);
+
+	string token;
+	while (File.tellg() < End && File >> token)
+	{
+		for (char c : token)
+			HashValue(Hash, c);
+		HashValue(Hash, ' ');
+	}
+}
+
 //	Read domain data from the input data file
 bool CDomain::ReadData(string FileName, string OutFile)
 {
@@ -103,28 +171,45 @@ bool CDomain::ReadData(string FileName, string OutFile)
 //	Read the control line
 	Input >> NUMNP >> NUMEG >> NLCASE >> MODEX;
 
+	streampos NodeBegin = Input.tellg();
+
 //	Read nodal point data
 	if (ReadNodalPoints())
         Output->OutputNodeInfo();
     else
         return false;
 
+    streampos NodeEnd = Input.tellg();
+
     //	Read load data
     if (ReadLoadCases())
         Output->OutputLoadInfo();
     else
         return false;
 
+    streampos ElementBegin = Input.tellg();
+
     //	Read element data
     if (ReadElements())
         Output->OutputElementInfo();
     else
         return false;
 
+    streampos ElementEnd = Input.tellg();
+
     //	Update equation number
     CalculateEquationNumber();
     Output->OutputEquationNumber();
 
+//	Key of the stiffness matrix: the nodal data and the element groups (with their materials),
+//	but not the load cases
+	ModelKey = 14695981039346656037ULL;
+	HashValue(ModelKey, NUMNP);
+	HashValue(ModelKey, NUMEG);
+	HashValue(ModelKey, NodeOrdering);
+	HashTokens(FileName, NodeBegin, NodeEnd, ModelKey);
+	HashTokens(FileName, ElementBegin, ElementEnd, ModelKey);
+
 #ifdef _VIB_
 	if (ReadVibNum())
 		Output->PrintVibModNum();
@@ -267,37 +352,449 @@ void CDomain::CalculateEquationNumber()
         }
     }
 
+//	Boundary codes of all DOFs (nonzero: fixed)
+	vector<unsigned int> BoundaryCodes(NUMNP * CNode::NDF);
+	for (unsigned int np = 0; np < NUMNP; np++)
+		for (unsigned int dof = 0; dof < CNode::NDF; dof++)
+			BoundaryCodes[np * CNode::NDF + dof] = NodeList[np].bcode[dof];
+
+	FindCondensedNodes();
+
+	vector<unsigned int> Order(NUMNP);
+	for (unsigned int np = 0; np < NUMNP; np++)
+		Order[np] = np;
+
+	if (NodeOrdering != OrderingTypes::Input)
+	{
+//		Profile and bandwidth of the input order
+		NumberEquations(Order, BoundaryCodes);
+		GenerateLocationMatrix();
+		CalculateProfile(InputProfile, InputBandwidth);
+
+		OrderNodes(Order);
+	}
+
+	NumberEquations(Order, BoundaryCodes);
+
+    GenerateLocationMatrix();
+
+	if (NodeOrdering != OrderingTypes::Input)
+	{
+		CalculateProfile(OrderedProfile, OrderedBandwidth);
+
+//		Keep the input order if it has a smaller profile
+		if (OrderedProfile >= InputProfile)
+		{
+			for (unsigned int np = 0; np < NUMNP; np++)
+				Order[np] = np;
+
+			NumberEquations(Order, BoundaryCodes);
+			GenerateLocationMatrix();
+
+			OrderedProfile = InputProfile;
+			OrderedBandwidth = InputBandwidth;
+			NodeOrdering = OrderingTypes::Input;
+			InputOrderKept = true;
+		}
+	}
+
+    if (SolverType == SolverTypes::Auto)
+        ChooseSolver();
+
+    if (SolverType == SolverTypes::Substructure)
+    {
+        Substructures = new CSubstructureSolver();
+        Substructures->Partition(EleGrpList, NUMEG, NEQ, NumParts);
+    }
+    else if (SolverType == SolverTypes::EBE)
+        ;	// The element-by-element solver does not assemble the stiffness matrix
+    else if (SolverType != SolverTypes::LDLT)
+    {
+        CSRStiffnessMatrix = new CSRMatrix<double>(NEQ);
+        CalculateCSRColumns();
+
+        if (SolverType == SolverTypes::Sparse && !SolverChosen)
+            CalculateSparseOrdering();
+    }
+#ifdef _VIB_
+    else if (Explicit)
+    {
+//      The central difference solver only uses the lumped mass and the element matrices
+        LumpedMass = new double[NEQ];
+        clear(LumpedMass, NEQ);
+    }
+#endif
+    else
+    {
+        StiffnessMatrix = new CSkylineMatrix<double>(NEQ);
+#ifdef _VIB_
+        if (MassType == MassTypes::Consistent)
+            MassMatrix = new CSkylineMatrix<double>(NEQ);
+        else
+        {
+            LumpedMass = new double[NEQ];
+            clear(LumpedMass, NEQ);
+        }
+#endif
+        //	Calculate column heights
+        CalculateColumnHeights();
+        //	Calculate address of diagonal elements in banded matrix
+        CalculateDiagnoalAddress();
+    }
+
+}
+
+//	The last GetNumInternalNodes() nodes of an element are condensed out of the system if no
+//	other element uses them and no load is applied to them
+void CDomain::FindCondensedNodes()
+{
+	CondensedNode.assign(NUMNP, false);
+
+#ifndef _VIB_	// The mass matrix is assembled with all DOFs
+	vector<unsigned int> NumElements(NUMNP, 0);
+	for (unsigned int EleGrp = 0; EleGrp < NUMEG; EleGrp++)
+	{
+		CElementGroup& ElementGrp = EleGrpList[EleGrp];
+		for (unsigned int Ele = 0; Ele < ElementGrp.GetNUME(); Ele++)
+		{
+			CElement& Element = ElementGrp.GetElement(Ele);
+			for (int n = 0; n < Element.GetNEN(); n++)
+				NumElements[Element.GetNodes()[n]->NodeNumber - 1]++;
+		}
+	}
+
+	vector<bool> Loaded(NUMNP, false);
+	for (unsigned int lcase = 0; lcase < NLCASE; lcase++)
+		for (unsigned int lnum = 0; lnum < LoadCases[lcase].nloads; lnum++)
+			Loaded[LoadCases[lcase].node[lnum] - 1] = true;
+
+	for (unsigned int EleGrp = 0; EleGrp < NUMEG; EleGrp++)
+	{
+		CElementGroup& ElementGrp = EleGrpList[EleGrp];
+		for (unsigned int Ele = 0; Ele < ElementGrp.GetNUME(); Ele++)
+		{
+			CElement& Element = ElementGrp.GetElement(Ele);
+			const unsigned int NumInternal = Element.GetNumInternalNodes();
+			if (!NumInternal)
+				continue;
+
+			const unsigned int NEN = Element.GetNEN();
+			bool Condensed = true;
+			for (unsigned int n = NEN - NumInternal; n < NEN; n++)
+			{
+				const unsigned int np = Element.GetNodes()[n]->NodeNumber - 1;
+				Condensed = Condensed && NumElements[np] == 1 && !Loaded[np];
+			}
+
+			if (Condensed)
+				for (unsigned int n = NEN - NumInternal; n < NEN; n++)
+					CondensedNode[Element.GetNodes()[n]->NodeNumber - 1] = true;
+
+			Element.SetCondensed(Condensed);
+		}
+	}
+#endif
+}
+
+//	Number the active DOFs node by node in the given order of nodes. The DOFs of the
+//	condensed nodes are numbered after all equations of the system
+void CDomain::NumberEquations(const vector<unsigned int>& Order, const vector<unsigned int>& BoundaryCodes)
+{
 	NEQ = 0;
-	for (unsigned int np = 0; np < NUMNP; np++)	// Loop over for all node
+	NCEQ = 0;
+	for (int Pass = 0; Pass < 2; Pass++)	// Pass 1 numbers the condensed nodes
 	{
-		for (unsigned int dof = 0; dof < CNode::NDF; dof++)	// Loop over for DOFs of node np
+		for (unsigned int k = 0; k < NUMNP; k++)	// Loop over for all node
 		{
-			if (NodeList[np].bcode[dof]) 
-				NodeList[np].bcode[dof] = 0;
-			else
+			const unsigned int np = Order[k];
+			if (CondensedNode[np] != (Pass == 1))
+				continue;
+
+			for (unsigned int dof = 0; dof < CNode::NDF; dof++)	// Loop over for DOFs of node np
 			{
-				NEQ++;
-				NodeList[np].bcode[dof] = NEQ;
+				if (BoundaryCodes[np * CNode::NDF + dof]) 
+					NodeList[np].bcode[dof] = 0;
+				else if (Pass == 0)
+				{
+					NEQ++;
+					NodeList[np].bcode[dof] = NEQ;
+				}
+				else
+				{
+					NCEQ++;
+					NodeList[np].bcode[dof] = NEQ + NCEQ;
+				}
 			}
 		}
 	}
+}
 
-    GenerateLocationMatrix();
+//	Adjacency graph of the nodes, connecting the nodes of each element
+void CDomain::NodeGraph(vector<int>& Start, vector<int>& Index)
+{
+//	Nodes of all elements
+	vector<unsigned int> ElementStart(1, 0), ElementNodes;
+	for (unsigned int EleGrp = 0; EleGrp < NUMEG; EleGrp++)
+	{
+		CElementGroup& ElementGrp = EleGrpList[EleGrp];
+		for (unsigned int Ele = 0; Ele < ElementGrp.GetNUME(); Ele++)
+		{
+			CElement& Element = ElementGrp.GetElement(Ele);
+			CNode** Nodes = Element.GetNodes();
+			for (int n = 0; n < Element.GetNEN(); n++)
+				ElementNodes.push_back(Nodes[n]->NodeNumber - 1);
+			ElementStart.push_back(ElementNodes.size());
+		}
+	}
 
-#ifdef MKL
-    CSRStiffnessMatrix = new CSRMatrix<double>(NEQ);
-    CalculateCSRColumns();
-#else
-    StiffnessMatrix = new CSkylineMatrix<double>(NEQ);
-#ifdef _VIB_
-	MassMatrix = new CSkylineMatrix<double>(NEQ);
+//	Elements connected to each node
+	vector<int> NodeStart(NUMNP + 1, 0), NodeElements(ElementNodes.size());
+	for (unsigned int np : ElementNodes)
+		NodeStart[np + 1]++;
+	for (unsigned int np = 0; np < NUMNP; np++)
+		NodeStart[np + 1] += NodeStart[np];
+	{
+		vector<int> Next(NodeStart.begin(), NodeStart.end() - 1);
+		for (unsigned int e = 0; e + 1 < ElementStart.size(); e++)
+			for (unsigned int k = ElementStart[e]; k < ElementStart[e + 1]; k++)
+				NodeElements[Next[ElementNodes[k]]++] = e;
+	}
+
+//	Adjacency graph of the nodes
+	Start.assign(NUMNP + 1, 0);
+	Index.clear();
+	vector<int> Marker(NUMNP, -1);
+	for (unsigned int np = 0; np < NUMNP; np++)
+	{
+		Marker[np] = np;
+		for (int k = NodeStart[np]; k < NodeStart[np + 1]; k++)
+		{
+			const unsigned int e = NodeElements[k];
+			for (unsigned int q = ElementStart[e]; q < ElementStart[e + 1]; q++)
+				if (Marker[ElementNodes[q]] != (int)np)
+				{
+					Marker[ElementNodes[q]] = np;
+					Index.push_back(ElementNodes[q]);
+				}
+		}
+		sort(Index.begin() + Start[np], Index.end());
+		Start[np + 1] = Index.size();
+	}
+}
+
+//	Order the nodes on the graph connecting the nodes of each element
+void CDomain::OrderNodes(vector<unsigned int>& Order)
+{
+	vector<int> Start, Index;
+	NodeGraph(Start, Index);
+
+	CGraphOrdering Graph(Start, Index);
+
+	vector<int> NodeOrder;
+	if (NodeOrdering == OrderingTypes::RCM)
+		Graph.RCM(NodeOrder);
+	else
+		Graph.Sloan(NodeOrder);
+
+	Order.assign(NodeOrder.begin(), NodeOrder.end());
+}
+
+//	Fill-reducing ordering of the equations for the sparse solver
+void CDomain::CalculateSparseOrdering()
+{
+	vector<int> Start, Index;
+	NodeGraph(Start, Index);
+
+//	Graph of the nodes with active DOFs, weighted by their number of equations
+	vector<int> Active(NUMNP, -1), Nodes, Weight;
+	for (unsigned int np = 0; np < NUMNP; np++)
+	{
+		int w = 0;
+		for (unsigned int dof = 0; dof < CNode::NDF; dof++)
+			if (NodeList[np].bcode[dof] && !CondensedNode[np])
+				w++;
+
+		if (w)
+		{
+			Active[np] = Nodes.size();
+			Nodes.push_back(np);
+			Weight.push_back(w);
+		}
+	}
+
+	vector<int> ActiveStart(1, 0), ActiveIndex;
+	for (int np : Nodes)
+	{
+		for (int p = Start[np]; p < Start[np + 1]; p++)
+			if (Active[Index[p]] >= 0)
+				ActiveIndex.push_back(Active[Index[p]]);
+		ActiveStart.push_back(ActiveIndex.size());
+	}
+
+	CGraphOrdering Graph(ActiveStart, ActiveIndex);
+
+	vector<int> Order;
+	if (SparseOrdering == OrderingTypes::AMD)
+		Graph.AMD(Weight, Order);
+	else if (SparseOrdering == OrderingTypes::ND)
+	{
+		vector<double> XYZ;
+		for (int np : Nodes)
+			XYZ.insert(XYZ.end(), NodeList[np].XYZ, NodeList[np].XYZ + 3);
+		Graph.NestedDissection(XYZ, Order);
+	}
+	else
+	{
+		Order.resize(Nodes.size());
+		for (unsigned int k = 0; k < Nodes.size(); k++)
+			Order[k] = k;
+	}
+
+	Graph.SymbolicFactorization(Order, Weight, PredictedFill, PredictedFlops);
+
+//	Equations of the nodes in this order
+	EquationOrder.clear();
+	for (int k : Order)
+		for (unsigned int dof = 0; dof < CNode::NDF; dof++)
+			if (NodeList[Nodes[k]].bcode[dof])
+				EquationOrder.push_back(NodeList[Nodes[k]].bcode[dof] - 1);
+}
+
+//	Calculate the skyline profile (number of elements below the skyline) and the
+//	maximum half bandwidth from the location matrices of the elements
+void CDomain::CalculateProfile(unsigned long long& Profile, Index_t& Bandwidth, double* Flops)
+{
+	vector<Index_t> ColumnHeights(NEQ, 0);
+	for (unsigned int EleGrp = 0; EleGrp < NUMEG; EleGrp++)
+	{
+		CElementGroup& ElementGrp = EleGrpList[EleGrp];
+		for (unsigned int Ele = 0; Ele < ElementGrp.GetNUME(); Ele++)
+			ElementGrp.GetElement(Ele).CalculateColumnHeight(ColumnHeights.data());
+	}
+
+	Profile = 0;
+	Bandwidth = 0;
+	for (Index_t i = 0; i < NEQ; i++)
+	{
+		Profile += ColumnHeights[i] + 1;
+		Bandwidth = max(Bandwidth, ColumnHeights[i] + 1);
+	}
+
+//	Column j is reduced by about (H_j + 1)^2 multiplications, counted as in SymbolicFactorization
+	if (Flops)
+	{
+		*Flops = 0.0;
+		for (Index_t i = 0; i < NEQ; i++)
+			*Flops += (ColumnHeights[i] + 1.0) * (ColumnHeights[i] + 1.0);
+	}
+}
+
+//	Memory available to the process in bytes, 0 if it cannot be found
+static double AvailableBytes()
+{
+	ifstream MemInfo("/proc/meminfo");
+	string Key;
+	double Value;
+	while (MemInfo >> Key >> Value)
+	{
+		if (Key == "MemAvailable:")
+			return Value * 1024;
+		MemInfo.ignore(numeric_limits<streamsize>::max(), '\n');
+	}
+
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+	const long Pages = sysconf(_SC_PHYS_PAGES);
+	const long PageSize = sysconf(_SC_PAGESIZE);
+	if (Pages > 0 && PageSize > 0)
+		return double(Pages) * PageSize;
 #endif
-    //	Calculate column heights
-	CalculateColumnHeights();
-	//	Calculate address of diagonal elements in banded matrix
-	CalculateDiagnoalAddress();
+
+	return 0.0;
+}
+
+//	Choose the solver from the number of equations, the skyline profile and the available memory
+void CDomain::ChooseSolver()
+{
+//	Models solved by the skyline solver without looking at the sparse ordering, which would take
+//	longer than the skyline factorization
+	const Index_t SmallNEQ = 5000;
+
+	SolverChosen = true;
+
+#ifdef _VIB_
+//	The vibration solver works on the skyline matrices
+	SolverType = SolverTypes::LDLT;
+	return;
 #endif
 
+	unsigned long long Profile;
+	Index_t Bandwidth;
+	CalculateProfile(Profile, Bandwidth, &SkylineFlops);
+	SkylineFill = Profile;
+
+	AvailableMemory = AvailableBytes();
+
+//	Only half of the available memory is given to the factor, the rest is left for the
+//	stiffness matrix of the sparse solver, the element data and the other processes
+	auto Fits = [this](double Bytes) { return AvailableMemory == 0.0 || Bytes <= 0.5 * AvailableMemory; };
+
+	const double SkylineMemory = SkylineFill * sizeof(double);
+	const bool SkylineFits = Fits(SkylineMemory) && SkylineFill < (double)numeric_limits<Index_t>::max();
+
+	if (NEQ <= SmallNEQ && SkylineFits)
+	{
+		SolverType = SolverTypes::LDLT;
+		EstimatedMemory = SkylineMemory;
+		EstimatedFlops = SkylineFlops;
+		return;
+	}
+
+//	Entries of the upper triangle of K: every node with w active DOFs couples them to each
+//	other and to the active DOFs of its neighbours
+	vector<int> Start, Index;
+	NodeGraph(Start, Index);
+
+	vector<double> Weight(NUMNP, 0.0);
+	for (unsigned int np = 0; np < NUMNP; np++)
+		if (!CondensedNode[np])
+			for (unsigned int dof = 0; dof < CNode::NDF; dof++)
+				if (NodeList[np].bcode[dof])
+					Weight[np]++;
+
+	CSREntries = 0.0;
+	for (unsigned int np = 0; np < NUMNP; np++)
+	{
+		CSREntries += Weight[np] * (Weight[np] + 1) / 2;
+		for (int p = Start[np]; p < Start[np + 1]; p++)
+			if (Index[p] > (int)np)
+				CSREntries += Weight[np] * Weight[Index[p]];
+	}
+
+	const double CSRMemory = CSREntries * (sizeof(double) + sizeof(CSRIndex_t)) + (NEQ + 1.0) * sizeof(CSRIndex_t);
+
+	CalculateSparseOrdering();
+	const double SparseMemory = PredictedFill * sizeof(double) + CSRMemory;
+	const bool SparseFits = Fits(SparseMemory);
+
+	if (SkylineFits && (!SparseFits || SkylineFlops <= PredictedFlops))
+	{
+		SolverType = SolverTypes::LDLT;
+		EstimatedMemory = SkylineMemory;
+		EstimatedFlops = SkylineFlops;
+	}
+	else if (SparseFits)
+	{
+		SolverType = SolverTypes::Sparse;
+		EstimatedMemory = SparseMemory;
+		EstimatedFlops = PredictedFlops;
+	}
+	else
+	{
+//		K and its incomplete factor, and the products by both of them in every iteration
+		SolverType = SolverTypes::PCG;
+		EstimatedMemory = 2 * CSRMemory;
+		EstimatedFlops = 8 * CSREntries;
+	}
 }
 
 //	Read load case data
@@ -330,7 +827,7 @@ bool CDomain::ReadElements()
 //	Calculate column heights
 void CDomain::CalculateColumnHeights()
 {
-    unsigned int* ColumnHeights = StiffnessMatrix->GetColumnHeights();
+    Index_t* ColumnHeights = StiffnessMatrix->GetColumnHeights();
 
 	for (unsigned int EleGrp = 0; EleGrp < NUMEG; EleGrp++)		//	Loop over for all element groups
     {
@@ -344,7 +841,7 @@ void CDomain::CalculateColumnHeights()
 	//	Maximum half bandwidth ( = max(ColumnHeights) + 1 )
 	MK = ColumnHeights[0];
 
-	for (unsigned int i=1; i<NEQ; i++)
+	for (Index_t i=1; i<NEQ; i++)
 		if (MK < ColumnHeights[i])
 			MK = ColumnHeights[i];
 
@@ -356,10 +853,12 @@ void CDomain::CalculateColumnHeights()
 #endif
 
 #ifdef _VIB_
-	unsigned int* ColumnHeights_mass = MassMatrix->GetColumnHeights();
-	for (unsigned int i=0; i<NEQ; ++i){
+	if (MassMatrix){
+	Index_t* ColumnHeights_mass = MassMatrix->GetColumnHeights();
+	for (Index_t i=0; i<NEQ; ++i){
 		ColumnHeights_mass[i]=ColumnHeights[i];
 	}
+	}
 #endif
 }
 
@@ -367,14 +866,23 @@ void CDomain::CalculateColumnHeights()
 //	Caution: Address is numbered from 1 !
 void CDomain::CalculateDiagnoalAddress()
 {
-    unsigned int* ColumnHeights = StiffnessMatrix->GetColumnHeights();
-    unsigned int* DiagonalAddress = StiffnessMatrix->GetDiagonalAddress();
+    Index_t* ColumnHeights = StiffnessMatrix->GetColumnHeights();
+    Index_t* DiagonalAddress = StiffnessMatrix->GetDiagonalAddress();
 
 //	Calculate the address of diagonal elements
 //	M(0) = 1;  M(i+1) = M(i) + H(i) + 1 (i = 0:NEQ)
 	DiagonalAddress[0] = 1;
-	for (unsigned int col = 1; col <= NEQ; col++)
+	for (Index_t col = 1; col <= NEQ; col++)
+	{
+		if (ColumnHeights[col-1] >= numeric_limits<Index_t>::max() - DiagonalAddress[col - 1])
+		{
+			cerr << "*** Error *** The skyline matrix has more entries than Index_t can address," << endl
+				 << "    rebuild with STAP++_INDEX64 or use the sparse solver" << endl;
+			exit(6);
+		}
+
 		DiagonalAddress[col] = DiagonalAddress[col - 1] + ColumnHeights[col-1] + 1;
+	}
 
 //	Number of elements in banded global stiffness matrix
 	NWK = DiagonalAddress[NEQ] - DiagonalAddress[0];
@@ -385,34 +893,121 @@ void CDomain::CalculateDiagnoalAddress()
 #endif
 
 #ifdef _VIB_
-	unsigned int* DiagonalAddress_mass = MassMatrix->GetDiagonalAddress();
-	for (unsigned int i=0; i<=NEQ; ++i){
+	if (MassMatrix){
+	Index_t* DiagonalAddress_mass = MassMatrix->GetDiagonalAddress();
+	for (Index_t i=0; i<=NEQ; ++i){
 		DiagonalAddress_mass[i]=DiagonalAddress[i];
 	}
+	}
 #endif
 
 
 }
 
+//	Factor cache file: header, key, NEQ, NWK, equation numbers of all nodes, column heights
+//	and the factored skyline matrix. The last character of the header is the size of Index_t
+static const char FactorCacheMagic[8] = {'S', 'T', 'A', 'P', 'L', 'D', 'L', char('0' + sizeof(Index_t))};
+
+//	Write the factored skyline matrix and the equation numbers to a cache file
+bool CDomain::WriteFactorCache(const string& FileName)
+{
+	ofstream File(FileName, ios::binary);
+	if (!File)
+		return false;
+
+	File.write(FactorCacheMagic, sizeof(FactorCacheMagic));
+	File.write((const char*)&ModelKey, sizeof(ModelKey));
+	File.write((const char*)&NEQ, sizeof(NEQ));
+	File.write((const char*)&NWK, sizeof(NWK));
+
+	for (unsigned int np = 0; np < NUMNP; np++)
+		File.write((const char*)NodeList[np].bcode, sizeof(NodeList[np].bcode));
+
+	File.write((const char*)StiffnessMatrix->GetColumnHeights(), sizeof(Index_t) * NEQ);
+	File.write((const char*)StiffnessMatrix->GetData(), sizeof(double) * (size_t)NWK);
+
+	return (bool)File;
+}
+
+//	Read the factored skyline matrix from a cache file written for the same model
+//	(StiffnessMatrix must be allocated)
+bool CDomain::ReadFactorCache(const string& FileName)
+{
+	ifstream File(FileName, ios::binary);
+	if (!File)
+		return false;
+
+	char Magic[sizeof(FactorCacheMagic)];
+	unsigned long long Key;
+	Index_t neq, nwk;
+
+	File.read(Magic, sizeof(Magic));
+	File.read((char*)&Key, sizeof(Key));
+	File.read((char*)&neq, sizeof(neq));
+	File.read((char*)&nwk, sizeof(nwk));
+
+	if (!File || !equal(Magic, Magic + sizeof(Magic), FactorCacheMagic) || Key != ModelKey ||
+		neq != NEQ || nwk != NWK)
+		return false;
+
+//	The equation numbers and the skyline must be those of this run
+	Index_t bcode[CNode::NDF];
+	for (unsigned int np = 0; np < NUMNP; np++)
+	{
+		File.read((char*)bcode, sizeof(bcode));
+		if (!File || !equal(bcode, bcode + CNode::NDF, NodeList[np].bcode))
+			return false;
+	}
+
+	vector<Index_t> ColumnHeights(NEQ);
+	File.read((char*)ColumnHeights.data(), sizeof(Index_t) * NEQ);
+	if (!File || !equal(ColumnHeights.begin(), ColumnHeights.end(), StiffnessMatrix->GetColumnHeights()))
+		return false;
+
+	File.read((char*)StiffnessMatrix->GetData(), sizeof(double) * (size_t)NWK);
+
+	return (bool)File;
+}
+
 //	Assemble the banded gloabl stiffness matrix
 void CDomain::AssembleStiffnessMatrix()
 {
-//	Loop over for all element groups
-	for (unsigned int EleGrp = 0; EleGrp < NUMEG; EleGrp++)
+//	An out-of-core matrix is assembled by blocks of columns fitting the memory budget,
+//	each block in one pass over the elements touching it
+	Index_t c0 = 1, c1 = NEQ + 1;
+	const bool OutOfCore = StiffnessMatrix && StiffnessMatrix->IsOutOfCore();
+
+	do
 	{
-        CElementGroup& ElementGrp = EleGrpList[EleGrp];
-        unsigned int NUME = ElementGrp.GetNUME();
+		if (OutOfCore)
+		{
+			for (c1 = c0 + 1; c1 <= NEQ && StiffnessMatrix->ColumnsSize(c0, c1 + 1) <= OutOfCoreBudget; c1++)
+				;
+			StiffnessMatrix->LoadColumns(c0, c1, false);
+		}
 
-		unsigned int size = ElementGrp.GetElement(0).SizeOfStiffnessMatrix();
-		double* Matrix = new double[size];
+//		Loop over for all element groups
+		for (unsigned int EleGrp = 0; EleGrp < NUMEG; EleGrp++)
+		{
+			CElementGroup& ElementGrp = EleGrpList[EleGrp];
+			unsigned int NUME = ElementGrp.GetNUME();
 
-//		Loop over for all elements in group EleGrp
-		for (unsigned int Ele = 0; Ele < NUME; Ele++)
-			ElementGrp.GetElement(Ele).assembly(Matrix, StiffnessMatrix, CSRStiffnessMatrix);
+			unsigned int size = ElementGrp.GetElement(0).SizeOfStiffnessMatrix();
+			double* Matrix = new double[size];
 
-		delete[] Matrix;
-		Matrix = nullptr;
-	}
+//			Loop over for all elements in group EleGrp
+			for (unsigned int Ele = 0; Ele < NUME; Ele++)
+				ElementGrp.GetElement(Ele).assembly(Matrix, StiffnessMatrix, CSRStiffnessMatrix);
+
+			delete[] Matrix;
+			Matrix = nullptr;
+		}
+
+		if (OutOfCore)
+			StiffnessMatrix->StoreColumns(c0, c1);
+
+		c0 = c1;
+	} while (c0 <= NEQ);
 
 #ifdef _DEBUG_
 	COutputter::Instance()->PrintStiffnessMatrix();
@@ -431,15 +1026,11 @@ bool CDomain::AssembleForce(unsigned int LoadCase)
 	//	Loop over for all concentrated loads in load case LoadCase
 	for (unsigned int lnum = 0; lnum < LoadData->nloads; lnum++)
 	{
-		unsigned int dof = NodeList[LoadData->node[lnum] - 1].bcode[LoadData->dof[lnum] - 1];
+		Index_t dof = NodeList[LoadData->node[lnum] - 1].bcode[LoadData->dof[lnum] - 1];
         
         if(dof) // The DOF is activated
 		{
-			#ifdef MKL
-				Force[dof - 1 + (NEQ*NLCASE*(LoadCase-1))] += LoadData->load[lnum];
-			#else
-				Force[dof - 1] += LoadData->load[lnum];
-			#endif
+			Force[dof - 1 + (size_t)NEQ*(LoadCase-1)] += LoadData->load[lnum];
 		}
             
 	}
@@ -447,28 +1038,51 @@ bool CDomain::AssembleForce(unsigned int LoadCase)
 	return true;
 }
 
+//	Displacements of load case lcase, with those of the condensed DOFs recovered
+double* CDomain::GetDisplacement(unsigned int lcase)
+{
+	double* Displacement = Force + (size_t)NEQ * lcase;
+	if (!NCEQ)
+		return Displacement;
+
+	FullDisplacement.assign(NEQ + NCEQ, 0.0);
+	copy(Displacement, Displacement + NEQ, FullDisplacement.begin());
+
+	for (unsigned int EleGrp = 0; EleGrp < NUMEG; EleGrp++)
+	{
+		CElementGroup& ElementGrp = EleGrpList[EleGrp];
+		for (unsigned int Ele = 0; Ele < ElementGrp.GetNUME(); Ele++)
+			if (ElementGrp.GetElement(Ele).GetNumCondensed())
+				ElementGrp.GetElement(Ele).RecoverCondensed(FullDisplacement.data());
+	}
+
+	return FullDisplacement.data();
+}
+
 //	Allocate storage for matrices Force, ColumnHeights, DiagonalAddress and StiffnessMatrix
 //	and calculate the column heights and address of diagonal elements
 void CDomain::AllocateMatrices()
 {
-//	Allocate for global force/displacement vector
-#ifdef MKL
-	Force = new double[NEQ * NLCASE];
-	clear(Force, NEQ * NLCASE);
-#else
-	Force = new double[NEQ];
-	clear(Force, NEQ);
-#endif
+//	Allocate for global force/displacement vectors of all load cases
+	Force = new double[(size_t)NEQ * NLCASE];
+	clear(Force, (size_t)NEQ * NLCASE);
 
 //  Create the banded stiffness matrix
-#ifdef MKL
-	GetCSRStiffnessMatrix().allocate();
-#else
-	StiffnessMatrix->Allocate();
-#endif
+	if (Substructures)
+		NWK = Substructures->GetInterfaceMatrix().size();
+	else if (CSRStiffnessMatrix)
+	{
+		CSRStiffnessMatrix->allocate();
+		NWK = CSRStiffnessMatrix->elementCount;
+	}
+	else if (OutOfCoreBudget)
+		StiffnessMatrix->AllocateOutOfCore(OutOfCoreFile, OutOfCoreBudget);
+	else if (StiffnessMatrix)
+		StiffnessMatrix->Allocate();
 
 #ifdef _VIB_
-	MassMatrix->Allocate();
+	if (MassMatrix)
+		MassMatrix->Allocate();
 #endif
 	
 	COutputter* Output = COutputter::Instance();
@@ -488,15 +1102,15 @@ void CDomain::CalculateCSRColumns()
         for (unsigned int Ele = 0; Ele < NUME; Ele++)
         {
             auto& element = ElementGrp.GetElement(Ele);
-            unsigned LMSize = element.GetLMSize();
-            unsigned* LM = element.GetLocationMatrix();
+            unsigned LMSize = element.GetLMSize() - element.GetNumCondensed();
+            Index_t* LM = element.GetLocationMatrix();
             for (unsigned i=0; i<LMSize; ++i)
             {
-                unsigned index1 = LM[i];
+                Index_t index1 = LM[i];
                 if (!index1) continue;
                 for (unsigned j=i; j<LMSize; ++j)
                 {
-                    unsigned index2 = LM[j];
+                    Index_t index2 = LM[j];
                     if (!index2) continue;
                     if (index1 < index2) {
                         matrix.markPosition(index1, index2);
@@ -511,6 +1125,77 @@ void CDomain::CalculateCSRColumns()
     }
 }
 
+//	Collect the equation numbers of the active DOFs of each node
+void CDomain::GetNodalEquations(vector<int>& BlockStart, vector<int>& BlockIndex)
+{
+	BlockStart.assign(1, 0);
+	BlockIndex.clear();
+
+	for (unsigned int np = 0; np < NUMNP; np++)
+	{
+		if (CondensedNode[np])
+			continue;
+
+		for (unsigned int dof = 0; dof < CNode::NDF; dof++)
+			if (NodeList[np].bcode[dof])
+				BlockIndex.push_back(NodeList[np].bcode[dof] - 1);
+
+		if (BlockIndex.size() > (size_t)BlockStart.back())
+			BlockStart.push_back(BlockIndex.size());
+	}
+}
+
+//	Rigid body modes of the nodes on the active DOFs (NEQ x NumModes, row major)
+unsigned int CDomain::GetRigidBodyModes(vector<double>& Modes)
+{
+//	Rotations are taken about the centroid of the nodes
+	double Center[3] = {0.0, 0.0, 0.0};
+	for (unsigned int np = 0; np < NUMNP; np++)
+		for (unsigned int i = 0; i < 3; i++)
+			Center[i] += NodeList[np].XYZ[i] / NUMNP;
+
+	const unsigned int NumModes = 6;
+	vector<double> All((size_t)NEQ * NumModes, 0.0);
+
+	for (unsigned int np = 0; np < NUMNP; np++)
+	{
+		if (CondensedNode[np])
+			continue;
+
+		CNode& Node = NodeList[np];
+		const double x = Node.XYZ[0] - Center[0];
+		const double y = Node.XYZ[1] - Center[1];
+		const double z = Node.XYZ[2] - Center[2];
+
+//		Displacements of the node in the translations along x, y, z and the rotations about x, y, z
+		const double u[6][6] = {{1, 0, 0, 0, 0, 0}, {0, 1, 0, 0, 0, 0}, {0, 0, 1, 0, 0, 0},
+		                        {0, -z, y, 1, 0, 0}, {z, 0, -x, 0, 1, 0}, {-y, x, 0, 0, 0, 1}};
+
+		for (unsigned int dof = 0; dof < CNode::NDF; dof++)
+			if (Node.bcode[dof])
+				for (unsigned int mode = 0; mode < NumModes; mode++)
+					All[(Node.bcode[dof] - 1) * NumModes + mode] = u[mode][dof];
+	}
+
+//	Drop the modes vanishing on all active DOFs (e.g. the rotations of a 1D model)
+	vector<unsigned int> Kept;
+	for (unsigned int mode = 0; mode < NumModes; mode++)
+	{
+		bool Zero = true;
+		for (Index_t eq = 0; eq < NEQ && Zero; eq++)
+			Zero = All[eq * NumModes + mode] == 0.0;
+		if (!Zero)
+			Kept.push_back(mode);
+	}
+
+	Modes.resize((size_t)NEQ * Kept.size());
+	for (Index_t eq = 0; eq < NEQ; eq++)
+		for (unsigned int k = 0; k < Kept.size(); k++)
+			Modes[eq * Kept.size() + k] = All[eq * NumModes + Kept[k]];
+
+	return Kept.size();
+}
+
 #ifdef _VIB_
 
 void CDomain::AssembleMassMatrix()
@@ -526,7 +1211,10 @@ void CDomain::AssembleMassMatrix()
 
 //		Loop over for all elements in group EleGrp
 		for (unsigned int Ele = 0; Ele < NUME; Ele++)
-			ElementGrp.GetElement(Ele).assembly_mass(Matrix, MassMatrix);
+			if (MassMatrix)
+				ElementGrp.GetElement(Ele).assembly_mass(Matrix, MassMatrix);
+			else
+				ElementGrp.GetElement(Ele).assembly_lumped_mass(Matrix, LumpedMass, MassType);
 
 		delete[] Matrix;
 		Matrix = nullptr;
@@ -538,115 +1226,64 @@ void CDomain::AssembleMassMatrix()
 */
 }
 
-bool CDomain::VibSolver(unsigned int NVibModes){
-    unsigned int numEq = GetNEQ();
-    //an inadvanced way to get the origin vectors
-	double* vector_o = new double[numEq*NVibModes];
-	for (unsigned int i=0; i<numEq; ++i){
-		for (unsigned j=0; j<NVibModes; ++j){
-			if (j==0 || i==j-1) {
-				vector_o[j*numEq+i]=1.0;
-			}
-			else {
-				vector_o[j*numEq+i]=0.0;
-			}
-		}
-	}
-    double* K_reduced = new double[NVibModes*(NVibModes+1)/2];
-
-	double* vector_oY= new double[numEq*NVibModes];
-	double* M_reduced = new double[NVibModes*(NVibModes+1)/2];
-	CLDLTSolver* KSolver= new CLDLTSolver(*StiffnessMatrix);
-	CLDLTSolver* MSolver= new CLDLTSolver(*MassMatrix);
-	MSolver->Multiple(vector_o,vector_oY,numEq,NVibModes);
-	//KSolver->LDLT();
-	double* vec_x_n = new double[NVibModes*numEq];
-	double* vec_y_n = new double[NVibModes*numEq];
-	double* lambdas_this = new double[NVibModes];
-	double* lambdas_n = new double[NVibModes];
-	double* eig_vecs = new double[NVibModes*NVibModes];
-	double l_diffs = 1.0;
-	double est_oy = 0.0;
-	double est_yn = 0.0;
-    while (l_diffs > 1.19e-7){
-		for (unsigned int i=0; i<NVibModes; ++i){
-			lambdas_this[i] = lambdas_n[i];
-		}
-		for (unsigned int i=0; i<NVibModes*numEq; ++i){
-			vec_x_n[i] = vector_oY[i];
-		}
-		for (unsigned int i=0; i<NVibModes; ++i){
-			KSolver->BackSubstitution(vec_x_n+i*numEq);
-		}
-		MSolver->Multiple(vec_x_n,vec_y_n,numEq,NVibModes);
-		/*
-		for (unsigned int i = 0; i < NVibModes; ++i) {
-			est_oy += vector_oY[i*numEq] * vector_oY[i*numEq];
-			est_yn += vec_y_n[i*numEq] * vec_y_n[i*numEq];
-		}
-		double ests = sqrt(est_oy / est_yn);
-		for (unsigned int i = 0; i < NVibModes * numEq; ++i) {
-			vector_oY[i] *= ests;
-			vec_x_n[i] *= ests;
-			vec_y_n[i] *= ests;
-		}
-		est_oy = 0.0;
-		est_yn = 0.0;
-		*/
-		int ord=NVibModes;
-		for (unsigned int i=0; i<NVibModes; ++i){
-			for (unsigned int j=i; j<NVibModes; ++j){
-				K_reduced[i+j*(j+1)/2] = 0.0;
-				M_reduced[i+j*(j+1)/2] = 0.0;
-				for (unsigned int k=0; k<numEq; ++k){
-					K_reduced[i+j*(j+1)/2] += vec_x_n[i*numEq+k] * vector_oY[j*numEq+k];
-					M_reduced[i+j*(j+1)/2] += vec_x_n[i*numEq+k] * vec_y_n[j*numEq+k];
-				}
-			}
-		}
-		//LAPACKE_dpotrf(LAPACK_COL_MAJOR, 'U', ord,M_reduced, ord);
-		if (LAPACKE_dspgvd(LAPACK_COL_MAJOR, 1,'V','U',ord,K_reduced,M_reduced,lambdas_n,eig_vecs,ord))
-			return false;
-		double* vec_x_n2 = new double[NVibModes*numEq];
-		for (unsigned int i = 0; i < NVibModes*numEq; ++i) {
-			vec_x_n2[i] = vec_x_n[i];
-		}
-		for (unsigned int i=0; i<numEq; ++i){
-			for (unsigned int j=0; j<NVibModes; ++j){
-				vec_x_n[i+j*numEq] = 0.0;
-				for (unsigned int k=0; k<NVibModes; ++k){
-					vec_x_n[i+j*numEq] += vec_x_n2[i+k*numEq] * eig_vecs[k+j*NVibModes];
-				}
-			}
-		}
-	    for (unsigned int i=0; i<NVibModes*numEq; ++i){
-			vector_o[i] = vec_x_n[i];
-		}
-		MSolver->Multiple(vec_x_n,vec_y_n,numEq,NVibModes);
-		l_diffs = 0.0;
-		for (unsigned int i = 0; i < NVibModes; ++i) {
-			l_diffs += abs(lambdas_n[i] - lambdas_this[i]);
-		}
-	}
-	VibDisp = new double[NVibModes*numEq];
-	for (unsigned int i=0; i<NVibModes*numEq; ++i){
-		VibDisp[i] = vector_o[i];
+//	Lowest NVibModes eigenpairs of K x = lambda M x by the block Lanczos solver in shift-invert
+//	mode, applying K^-1 with the factor of KSolver, or with the factor of a copy of K if K is
+//	not factorized in double precision (KSolver null)
+bool CDomain::VibSolver(unsigned int NVibModes, CLDLTSolver* KSolver)
+{
+	CSkylineMatrix<double>* Copy = nullptr;
+	if (!KSolver)
+	{
+		Copy = new CSkylineMatrix<double>(NEQ);
+		copy(StiffnessMatrix->GetColumnHeights(), StiffnessMatrix->GetColumnHeights() + NEQ,
+		     Copy->GetColumnHeights());
+		copy(StiffnessMatrix->GetDiagonalAddress(), StiffnessMatrix->GetDiagonalAddress() + NEQ + 1,
+		     Copy->GetDiagonalAddress());
+		Copy->Allocate();
+		copy(StiffnessMatrix->GetData(), StiffnessMatrix->GetData() + Copy->size(), Copy->GetData());
+
+		KSolver = new CLDLTSolver(*Copy);
+		KSolver->LDLT();
 	}
+
+	CLanczosSolver Lanczos = MassMatrix ? CLanczosSolver(*KSolver, *MassMatrix)
+	                                    : CLanczosSolver(*KSolver, LumpedMass);
+	Lanczos.SetNumThreads(0);
+
+	VibDisp = new double[(size_t)NEQ * NVibModes];
 	EigenValues = new double[NVibModes];
-	for (unsigned int i=0; i<NVibModes; ++i){
-		EigenValues[i] = lambdas_n[i];
-	}
-	delete vector_o;
-	delete vector_oY;
-	delete vec_x_n;
-	delete vec_y_n;
-	delete lambdas_n;
-	delete lambdas_this;
-	delete K_reduced;
-	delete M_reduced;
-	delete eig_vecs;
-	delete KSolver;
-	delete MSolver;
+
+	const bool Success = Lanczos.Solve(NVibModes, EigenValues, VibDisp);
+
+	if (Copy)
+	{
+		delete KSolver;
+		delete Copy;
+	}
+
+	return Success;
+}
+
+//	Eigenvalues lambda = (2*pi*f)^2 below the cutoff frequency f, which replace the number of
+//	modes read from the input file
+bool CDomain::SliceSpectrum(double CutoffFrequency, unsigned int NumWindows, unsigned int NumThreads)
+{
+	const double Pi = 3.14159265358979323846;
+	const double Cutoff = pow(2.0 * Pi * CutoffFrequency, 2);
+
+	CSpectrumSlicer Slicer =
+		MassMatrix ? CSpectrumSlicer(*StiffnessMatrix, *MassMatrix, NumWindows, NumThreads)
+		           : CSpectrumSlicer(*StiffnessMatrix, LumpedMass, NumWindows, NumThreads);
+	vector<double> Lambda, Modes;
+	if (!Slicer.Solve(Cutoff, Lambda, Modes))
+		return false;
+
+	numEig = Lambda.size();
+	EigenValues = new double[numEig];
+	VibDisp = new double[(size_t)NEQ * numEig];
+	copy(Lambda.begin(), Lambda.end(), EigenValues);
+	copy(Modes.begin(), Modes.end(), VibDisp);
+
 	return true;
 }
 
@@ -654,4 +1291,175 @@ bool CDomain::ReadVibNum() {
 	Input >> numEig;
 	return true;
 }
+
+//	Dynamics data file:
+//	    NSTEPS  DT  ALPHA      (ALPHA in [-1/3, 0], 0 for the Newmark average acceleration rule)
+//	    ETAM  ETAK             (Rayleigh damping coefficients)
+//	    LL  NP  t_1 f_1 ... t_NP f_NP    for each load case LL (NP = 0 : constant loads)
+//	    NHIST  followed by NHIST pairs NODE DOF
+bool CDomain::ReadDynamics(const string& FileName)
+{
+	ifstream Dynamics(FileName.c_str());
+	if (!Dynamics)
+	{
+		cerr << "*** Error *** File " << FileName << " does not exist !" << endl;
+		return false;
+	}
+
+	Dynamics >> NumSteps >> TimeStep >> HHTAlpha >> DampingM >> DampingK;
+
+	if (!Dynamics || TimeStep <= 0.0 || HHTAlpha < -1.0 / 3.0 || HHTAlpha > 0.0)
+	{
+		cerr << "*** Error *** The time step must be positive and alpha in [-1/3, 0] !" << endl;
+		return false;
+	}
+
+	for (unsigned int lcase = 0; lcase < NLCASE; lcase++)
+		if (!LoadCases[lcase].ReadTimeFunction(Dynamics, lcase))
+			return false;
+
+	unsigned int NHIST;
+	Dynamics >> NHIST;
+	HistoryNode.resize(NHIST);
+	HistoryDOF.resize(NHIST);
+
+	for (unsigned int i = 0; i < NHIST; i++)
+	{
+		Dynamics >> HistoryNode[i] >> HistoryDOF[i];
+
+		if (HistoryNode[i] < 1 || HistoryNode[i] > NUMNP || HistoryDOF[i] < 1 || HistoryDOF[i] > CNode::NDF)
+		{
+			cerr << "*** Error *** History " << i + 1 << " : node " << HistoryNode[i] << ", DOF "
+				 << HistoryDOF[i] << " does not exist !" << endl;
+			return false;
+		}
+	}
+
+	return !Dynamics.fail();
+}
+
+//	The loads at time t are the sum of the load cases multiplied by their time functions
+void CDomain::TransientLoads(double t, vector<double>& F)
+{
+	F.assign(NEQ, 0.0);
+	for (unsigned int lcase = 0; lcase < NLCASE; lcase++)
+	{
+		const CLoadCaseData& LoadData = LoadCases[lcase];
+		const double f = LoadData.TimeFunction(t);
+
+		for (unsigned int lnum = 0; lnum < LoadData.nloads; lnum++)
+			if (Index_t dof = NodeList[LoadData.node[lnum] - 1].bcode[LoadData.dof[lnum] - 1])
+				F[dof - 1] += f * LoadData.load[lnum];
+	}
+}
+
+//	The history file starts with a header line naming the node and DOF of each column
+bool CDomain::OpenHistory(ofstream& History, const string& HistoryFile)
+{
+	History.open(HistoryFile.c_str());
+	if (!History)
+	{
+		cerr << "*** Error *** Cannot write the history file " << HistoryFile << endl;
+		return false;
+	}
+
+	History << "#        TIME";
+	for (size_t i = 0; i < HistoryNode.size(); i++)
+		History << setw(9) << "N" << setw(5) << HistoryNode[i] << "-D" << HistoryDOF[i];
+	History << endl << setiosflags(ios::scientific) << setprecision(6);
+
+	return true;
+}
+
+//	Each line of the history file holds the time and the displacements of the history DOFs
+void CDomain::WriteHistory(ofstream& History, double t, const double* U)
+{
+	History << setw(14) << t;
+	for (size_t i = 0; i < HistoryNode.size(); i++)
+	{
+		const Index_t dof = NodeList[HistoryNode[i] - 1].bcode[HistoryDOF[i] - 1];
+		History << setw(18) << (dof ? U[dof - 1] : 0.0);
+	}
+	History << endl;
+}
+
+bool CDomain::TransientSolver(const string& HistoryFile, unsigned int NumThreads)
+{
+	ofstream History;
+	if (!OpenHistory(History, HistoryFile))
+		return false;
+
+	CNewmarkSolver* Newmark;
+	if (MassMatrix)
+		Newmark = new CNewmarkSolver(*StiffnessMatrix, *MassMatrix, TimeStep, HHTAlpha, DampingM,
+									 DampingK, NumThreads);
+	else
+		Newmark = new CNewmarkSolver(*StiffnessMatrix, LumpedMass, TimeStep, HHTAlpha, DampingM,
+									 DampingK, NumThreads);
+
+	vector<double> Force, NextForce;
+	TransientLoads(0.0, Force);
+	Newmark->Initialize(Force.data());
+	WriteHistory(History, Newmark->GetTime(), Newmark->GetDisplacement());
+
+	for (unsigned int step = 1; step <= NumSteps; step++)
+	{
+		TransientLoads(step * TimeStep, NextForce);
+		Newmark->Step(Force.data(), NextForce.data());
+		WriteHistory(History, Newmark->GetTime(), Newmark->GetDisplacement());
+
+		Force.swap(NextForce);
+	}
+
+	delete Newmark;
+
+	return !History.fail();
+}
+
+//	The step of the dynamics data file is reduced to 0.9 times the stable time step if it is
+//	longer, keeping the end time
+bool CDomain::ExplicitSolver(const string& HistoryFile, unsigned int NumThreads)
+{
+	if (!LumpedMass)
+	{
+		cerr << "*** Error *** The explicit solver needs a lumped mass matrix (-mass rowsum or hrz)" << endl;
+		return false;
+	}
+
+	for (Index_t i = 0; i < NEQ; i++)
+		if (LumpedMass[i] <= 0.0)
+		{
+			cerr << "*** Warning *** Equation " << i + 1 << " has no mass, and gets no acceleration" << endl;
+			break;
+		}
+
+	ofstream History;
+	if (!OpenHistory(History, HistoryFile))
+		return false;
+
+	CCentralDifferenceSolver Explicit(EleGrpList, NUMEG, NEQ, LumpedMass, MassType, DampingM, DampingK,
+									  NumThreads);
+
+	StableTimeStep = Explicit.StableTimeStep();
+	if (StableTimeStep > 0.0 && TimeStep > 0.9 * StableTimeStep)
+	{
+		const double EndTime = NumSteps * TimeStep;
+		NumSteps = (unsigned int)ceil(EndTime / (0.9 * StableTimeStep));
+		TimeStep = EndTime / NumSteps;
+	}
+
+	vector<double> Force;
+	TransientLoads(0.0, Force);
+	Explicit.Initialize(TimeStep, Force.data());
+	WriteHistory(History, Explicit.GetTime(), Explicit.GetDisplacement());
+
+	for (unsigned int step = 1; step <= NumSteps; step++)
+	{
+		TransientLoads(step * TimeStep, Force);
+		Explicit.Step(Force.data());
+		WriteHistory(History, Explicit.GetTime(), Explicit.GetDisplacement());
+	}
+
+	return !History.fail();
+}
 #endif
\ No newline at end of file
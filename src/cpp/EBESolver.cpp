@@ -0,0 +1,88 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#include "EBESolver.h"
+
+using namespace std;
+
+CEBESolver::CEBESolver(CElementGroup* EleGrpList, unsigned int NUMEG, Index_t NEQ,
+                       bool _CacheMatrices, double _Tolerance, unsigned int _MaxIterations)
+    : CPCGSolver(NEQ, nullptr, _Tolerance, _MaxIterations), CacheMatrices(_CacheMatrices)
+{
+    for (unsigned int EleGrp = 0; EleGrp < NUMEG; EleGrp++)
+        EleGrpList[EleGrp].AppendElements(Elements);
+
+    if (CacheMatrices)
+    {
+        MatrixStart.assign(Elements.size() + 1, 0);
+        for (size_t e = 0; e < Elements.size(); e++)
+            MatrixStart[e + 1] = MatrixStart[e] + Elements[e]->SizeOfStiffnessMatrix();
+        Matrices.resize(MatrixStart.back());
+    }
+
+    // Diagonal of K, and the element matrices to be cached
+    vector<double> Diagonal(N, 0.0), Matrix;
+    for (size_t e = 0; e < Elements.size(); e++)
+    {
+        ElementMatrix(e, Matrix);
+        if (CacheMatrices)
+            copy(Matrix.begin(), Matrix.end(), Matrices.begin() + MatrixStart[e]);
+
+        const Index_t* LM = Elements[e]->GetLocationMatrix();
+        const unsigned int ND = Elements[e]->GetLMSize() - Elements[e]->GetNumCondensed();
+        for (unsigned int j = 0; j < ND; j++)
+            if (LM[j])
+                Diagonal[LM[j] - 1] += Matrix[(j + 1) * j / 2];
+    }
+
+    M = new CJacobiPreconditioner(Diagonal);
+}
+
+CEBESolver::~CEBESolver() { delete M; }
+
+void CEBESolver::ElementMatrix(size_t e, vector<double>& Matrix) const
+{
+    Matrix.resize(Elements[e]->SizeOfStiffnessMatrix());
+    Elements[e]->CondensedStiffness(Matrix.data());
+}
+
+//  q = sum_e Ke * p_e. The DOFs of each element are gathered, so that the fixed DOFs (taken
+//  as zero) need no test
+void CEBESolver::Multiply(const double* p, double* q)
+{
+    for (Index_t i = 0; i < N; i++)
+        q[i] = 0.0;
+
+    vector<double> Matrix, pe, qe;
+    for (size_t e = 0; e < Elements.size(); e++)
+    {
+        const double* Ke;
+        if (CacheMatrices)
+            Ke = &Matrices[MatrixStart[e]];
+        else
+        {
+            ElementMatrix(e, Matrix);
+            Ke = Matrix.data();
+        }
+
+        CElement& Element = *Elements[e];
+        const Index_t* LM = Element.GetLocationMatrix();
+        const unsigned int ND = Element.GetLMSize() - Element.GetNumCondensed();
+
+        pe.resize(ND);
+        qe.resize(ND);
+        Element.GatherDOFs(p, pe.data());
+        Element.MatrixProduct(Ke, pe.data(), qe.data());
+
+        for (unsigned int j = 0; j < ND; j++)
+            if (LM[j])
+                q[LM[j] - 1] += qe[j];
+    }
+}
@@ -10,7 +10,11 @@
 
 #include <algorithm>
 #include <climits>
+#include <limits>
 #include "Element.h"
+#include "Eigen/Dense"
+
+using namespace Eigen;
 
 //! Virtual deconstructor
 CElement::~CElement()
@@ -26,22 +30,22 @@ CElement::~CElement()
 }
 
 //  Calculate the column height, used with the skyline storage scheme
-void CElement::CalculateColumnHeight(unsigned int* ColumnHeight)
+void CElement::CalculateColumnHeight(Index_t* ColumnHeight)
 {
 //  Look for the row number of the first non-zero element
-    unsigned int nfirstrow = INT_MAX;
+    Index_t nfirstrow = numeric_limits<Index_t>::max();
     for (unsigned int i = 0; i < ND; i++)
         if (LocationMatrix[i] && LocationMatrix[i] < nfirstrow)
             nfirstrow = LocationMatrix[i];
 
-//	Calculate the column height contributed by this element
-	for (unsigned int i = 0; i < ND; i++)
+//	Calculate the column height contributed by this element (the condensed DOFs are not assembled)
+	for (unsigned int i = 0; i < ND - NumCondensed; i++)
 	{
-		unsigned int column = LocationMatrix[i];
+		Index_t column = LocationMatrix[i];
 		if (!column)
 			continue;
 
-		const unsigned int Height = column - nfirstrow;
+		const Index_t Height = column - nfirstrow;
 		if (ColumnHeight[column-1] < Height) ColumnHeight[column-1] = Height;
 	}
 }
@@ -51,13 +55,24 @@ void CElement::assembly(double* Matrix,
 						CSkylineMatrix<double>* StiffnessMatrixPtr,
 						CSRMatrix<double>* CSRStiffnessMatrixPtr)
 {
+//	Only the columns held in memory are assembled into an out-of-core skyline matrix
+	if (StiffnessMatrixPtr && StiffnessMatrixPtr->IsOutOfCore())
+	{
+		bool InWindow = false;
+		for (unsigned int j = 0; j < ND && !InWindow; j++)
+			InWindow = LocationMatrix[j] && StiffnessMatrixPtr->HasColumn(LocationMatrix[j]);
+
+		if (!InWindow)
+			return;
+	}
+
 //	Calculate element stiffness matrix
-	ElementStiffness(Matrix);
+	CondensedStiffness(Matrix);
 	
 //	Assemble global stiffness matrix
-	for (unsigned int j = 0; j < ND; j++)
+	for (unsigned int j = 0; j < ND - NumCondensed; j++)
 	{
-		unsigned int Lj = LocationMatrix[j];	// Global equation number corresponding to jth DOF of the element
+		Index_t Lj = LocationMatrix[j];	// Global equation number corresponding to jth DOF of the element
 		if (!Lj) 
 			continue;
 
@@ -66,25 +81,140 @@ void CElement::assembly(double* Matrix,
 
 		for (unsigned int i = 0; i <= j; i++)
 		{
-			unsigned int Li = LocationMatrix[i];	// Global equation number corresponding to ith DOF of the element
+			Index_t Li = LocationMatrix[i];	// Global equation number corresponding to ith DOF of the element
 
 			if (!Li)
 				continue;
 
+//			Entry (Li, Lj) is stored in column max(Li, Lj)
+			if (StiffnessMatrixPtr && !StiffnessMatrixPtr->HasColumn(Li > Lj ? Li : Lj))
+				continue;
+
 			//  the reason not to merge two stiffness matrix into one by using virtual operator()
 			// is that virtual operator may slow down this process, which may happen thousands of
 			// millions of times here.
-			#ifdef MKL
-			(*CSRStiffnessMatrixPtr)(Li, Lj) += Matrix[DiagjElement + j - i - 1];
-            #else
-			(*StiffnessMatrixPtr)(Li, Lj) += Matrix[DiagjElement + j - i - 1];
-			#endif
+			if (CSRStiffnessMatrixPtr)
+				(*CSRStiffnessMatrixPtr)(Li, Lj) += Matrix[DiagjElement + j - i - 1];
+			else
+				(*StiffnessMatrixPtr)(Li, Lj) += Matrix[DiagjElement + j - i - 1];
 		}
 	}
 
 	return;
 }
 
+//	Index of entry (i, j), i <= j, in the element stiffness matrix stored column by column
+//	starting from the diagonal element
+static inline unsigned int PackedIndex(unsigned int i, unsigned int j)
+{
+	return (j+1)*j/2 + j - i;
+}
+
+//	Split the element stiffness matrix into the retained DOFs (the first NB) and the active
+//	condensed DOFs, factorize K_ii and return K_ii^-1 * K_ib
+static MatrixXd CondensedSolution(const double* Matrix, const Index_t* LocationMatrix,
+								  unsigned int NB, unsigned int ND, MatrixXd& Kib)
+{
+	vector<unsigned int> Internal;
+	for (unsigned int k = NB; k < ND; k++)
+		if (LocationMatrix[k])
+			Internal.push_back(k);
+
+	const unsigned int NI = Internal.size();
+	MatrixXd Kii(NI, NI);
+	Kib.resize(NI, NB);
+
+	for (unsigned int a = 0; a < NI; a++)
+	{
+		for (unsigned int b = 0; b <= a; b++)
+			Kii(a, b) = Kii(b, a) = Matrix[PackedIndex(Internal[b], Internal[a])];
+
+		for (unsigned int j = 0; j < NB; j++)
+			Kib(a, j) = Matrix[PackedIndex(j, Internal[a])];
+	}
+
+	LLT<MatrixXd> Factor(Kii);
+	if (Factor.info() != Success)
+	{
+		cerr << "*** Error *** The stiffness of the internal DOFs of an element is not positive definite." << endl;
+		exit(4);
+	}
+
+	return Factor.solve(Kib);
+}
+
+//	Static condensation of the trailing NumCondensed DOFs of the element
+void CElement::Condense(double* Matrix)
+{
+	const unsigned int NB = ND - NumCondensed;
+
+	MatrixXd Kib;
+	const MatrixXd X = CondensedSolution(Matrix, LocationMatrix, NB, ND, Kib);
+
+	for (unsigned int j = 0; j < NB; j++)
+		for (unsigned int i = 0; i <= j; i++)
+			Matrix[PackedIndex(i, j)] -= Kib.col(i).dot(X.col(j));
+}
+
+void CElement::CondensedStiffness(double* Matrix)
+{
+	ElementStiffness(Matrix);
+
+	if (NumCondensed)
+		Condense(Matrix);
+}
+
+void CElement::GatherDOFs(const double* Global, double* Local)
+{
+	for (unsigned int j = 0; j < ND - NumCondensed; j++)
+		Local[j] = LocationMatrix[j] ? Global[LocationMatrix[j] - 1] : 0.0;
+}
+
+//	The upper triangle is stored column by column from the diagonal, so each column gives a dot
+//	product for its diagonal entry and an update of the entries above it
+void CElement::MatrixProduct(const double* Matrix, const double* x, double* y)
+{
+	const unsigned int NB = ND - NumCondensed;
+
+	for (unsigned int j = 0; j < NB; j++)
+		y[j] = 0.0;
+
+	for (unsigned int j = 0; j < NB; j++)
+	{
+		const double* Column = Matrix + PackedIndex(0, j);	// Column[-i] = K(i, j)
+		const double xj = x[j];
+		double sum = Column[-(int)j] * xj;
+		for (unsigned int i = 0; i < j; i++)
+		{
+			sum += Column[-(int)i] * x[i];
+			y[i] += Column[-(int)i] * xj;
+		}
+		y[j] += sum;
+	}
+}
+
+//	Displacements of the condensed DOFs, u_i = -K_ii^-1 * K_ib * u_b (no load acts on them)
+void CElement::RecoverCondensed(double* Displacement)
+{
+	const unsigned int NB = ND - NumCondensed;
+
+	vector<double> Matrix(SizeOfStiffnessMatrix());
+	ElementStiffness(Matrix.data());
+
+	MatrixXd Kib;
+	const MatrixXd X = CondensedSolution(Matrix.data(), LocationMatrix, NB, ND, Kib);
+
+	VectorXd ub(NB);
+	for (unsigned int j = 0; j < NB; j++)
+		ub(j) = LocationMatrix[j] ? Displacement[LocationMatrix[j] - 1] : 0.0;
+
+	const VectorXd ui = -X * ub;
+
+	for (unsigned int k = NB, a = 0; k < ND; k++)
+		if (LocationMatrix[k])
+			Displacement[LocationMatrix[k] - 1] = ui(a++);
+}
+
 #ifdef _VIB_
 void CElement::assembly_mass(double* Matrix, CSkylineMatrix<double>* MassMatrixPtr){
     ElementMass(Matrix);
@@ -92,7 +222,7 @@ void CElement::assembly_mass(double* Matrix, CSkylineMatrix<double>* MassMatrixP
     //	Assemble global stiffness matrix
 	for (unsigned int j = 0; j < ND; j++)
 	{
-		unsigned int Lj = LocationMatrix[j];	// Global equation number corresponding to jth DOF of the element
+		Index_t Lj = LocationMatrix[j];	// Global equation number corresponding to jth DOF of the element
 		if (!Lj) 
 			continue;
 
@@ -101,7 +231,7 @@ void CElement::assembly_mass(double* Matrix, CSkylineMatrix<double>* MassMatrixP
 
 		for (unsigned int i = 0; i <= j; i++)
 		{
-			unsigned int Li = LocationMatrix[i];	// Global equation number corresponding to ith DOF of the element
+			Index_t Li = LocationMatrix[i];	// Global equation number corresponding to ith DOF of the element
 
 			if (!Li)
 				continue;
@@ -112,4 +242,68 @@ void CElement::assembly_mass(double* Matrix, CSkylineMatrix<double>* MassMatrixP
 	}
 
 }
+
+//	The element DOFs are numbered node by node, DOF k being the DOF k % (ND/NEN) of its node,
+//	i.e. a translation along x, y or z for k % (ND/NEN) < 3 and a rotation otherwise.
+//	HRZ scales the diagonal of each translation so that it sums up to the mass the element moves
+//	in a unit rigid translation, r^T M r, and the diagonal of the rotations by the mean factor of
+//	the translations. The row sums suit the elements without rotational DOFs, whose rotational
+//	rows may sum up to zero or negative masses
+void CElement::LumpMass(const double* Matrix, double* Mass, MassTypes Type)
+{
+	const unsigned int NDN = ND / NEN;	// DOFs per node
+
+	if (Type == MassTypes::RowSum)
+	{
+		for (unsigned int i = 0; i < ND; i++)
+		{
+			Mass[i] = 0.0;
+			for (unsigned int j = 0; j < ND; j++)
+				Mass[i] += Matrix[PackedIndex(min(i, j), max(i, j))];
+		}
+
+		return;
+	}
+
+	double FactorSum = 0.0;
+	unsigned int Translations = 0;
+
+	for (unsigned int D = 0; D < min(NDN, 3u); D++)
+	{
+		double Total = 0.0, Diagonal = 0.0;
+		for (unsigned int i = D; i < ND; i += NDN)
+		{
+			Diagonal += Matrix[PackedIndex(i, i)];
+			for (unsigned int j = D; j < ND; j += NDN)
+				Total += Matrix[PackedIndex(min(i, j), max(i, j))];
+		}
+
+		const double Factor = Diagonal > 0.0 ? Total / Diagonal : 0.0;
+		for (unsigned int i = D; i < ND; i += NDN)
+			Mass[i] = Factor * Matrix[PackedIndex(i, i)];
+
+		if (Diagonal > 0.0)
+		{
+			FactorSum += Factor;
+			Translations++;
+		}
+	}
+
+	const double RotationFactor = Translations ? FactorSum / Translations : 1.0;
+	for (unsigned int D = 3; D < NDN; D++)
+		for (unsigned int i = D; i < ND; i += NDN)
+			Mass[i] = RotationFactor * Matrix[PackedIndex(i, i)];
+}
+
+void CElement::assembly_lumped_mass(double* Matrix, double* LumpedMass, MassTypes Type)
+{
+	ElementMass(Matrix);
+
+	vector<double> Mass(ND);
+	LumpMass(Matrix, Mass.data(), Type);
+
+	for (unsigned int i = 0; i < ND; i++)
+		if (LocationMatrix[i])
+			LumpedMass[LocationMatrix[i] - 1] += Mass[i];
+}
 #endif
\ No newline at end of file
@@ -46,6 +46,12 @@ CElement& CElementGroup::GetElement(unsigned int index)
     return *(CElement*)((std::size_t)(ElementList_) + index*ElementSize_);
 }
 
+void CElementGroup::AppendElements(std::vector<CElement*>& Elements)
+{
+    for (unsigned int Ele = 0; Ele < NUME_; Ele++)
+        Elements.push_back(&GetElement(Ele));
+}
+
 CMaterial& CElementGroup::GetMaterial(unsigned int index)
 {
     return *(CMaterial*)((std::size_t)(MaterialList_) + index*MaterialSize_);
@@ -23,7 +23,7 @@ C5Q::C5Q()
     nodes = new CNode*[NEN];
 
     ND = 10;
-    LocationMatrix = new unsigned int[ND];
+    LocationMatrix = new Index_t[ND];
 
     ElementMaterial = nullptr;
 }
@@ -267,3 +267,8 @@ void C5Q::ElementStiffness(double* Matrix)
 //	Calculate element stress
 void C5Q::ElementStress(double* Q4stress, double* Displacement) {}
 void C5Q::ElementGauss(double* Coordinate) {}
+
+#ifdef _VIB_
+//	Calculate element mass matrix
+void C5Q::ElementMass(double* mass) { clear(mass, SizeOfStiffnessMatrix()); }
+#endif
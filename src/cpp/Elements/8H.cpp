@@ -23,7 +23,7 @@ CHex::CHex()
 	nodes = new CNode*[NEN];
     
     ND = 24; // number of degree of freedom of each element
-    LocationMatrix = new unsigned int[ND];
+    LocationMatrix = new Index_t[ND];
 
 	ElementMaterial = nullptr;
 }
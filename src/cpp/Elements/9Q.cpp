@@ -14,7 +14,7 @@ C9Q::C9Q()
     nodes = new CNode*[NEN];
 
     ND = 27; // 12 DOF in total
-    LocationMatrix = new unsigned int[ND];
+    LocationMatrix = new Index_t[ND];
 
     ElementMaterial = NULL;
 }
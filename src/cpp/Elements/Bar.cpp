@@ -23,7 +23,7 @@ CBar::CBar()
 	nodes = new CNode*[NEN];
 	
 	ND = 6;
-    LocationMatrix = new unsigned int[ND];
+    LocationMatrix = new Index_t[ND];
 
 	ElementMaterial = NULL;
 }
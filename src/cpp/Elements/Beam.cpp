@@ -23,7 +23,7 @@ CBeam::CBeam()
     nodes = new CNode*[NEN];
 
     ND = 12;
-    LocationMatrix = new unsigned int[ND];
+    LocationMatrix = new Index_t[ND];
 
     ElementMaterial = nullptr;
 }
@@ -23,7 +23,7 @@ CFrustum::CFrustum()
 	nodes = new CNode*[NEN];
 
 	ND = 12;
-	LocationMatrix = new unsigned int[ND];
+	LocationMatrix = new Index_t[ND];
 
 	ElementMaterial = NULL;
 }
@@ -146,3 +146,11 @@ void CFrustum::ElementStress(double* stress, double* Displacement)
 {
 
 }
+
+#ifdef _VIB_
+//	Calculate element mass matrix
+void CFrustum::ElementMass(double* mass)
+{
+	clear(mass, SizeOfStiffnessMatrix());
+}
+#endif
@@ -23,7 +23,7 @@ CInfEle::CInfEle()
     nodes = new CNode*[NEN];
 
     ND = 8;
-    LocationMatrix = new unsigned int[ND];
+    LocationMatrix = new Index_t[ND];
 
     ElementMaterial = nullptr;
 }
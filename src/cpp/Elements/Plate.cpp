@@ -13,7 +13,7 @@ CPlate::CPlate()
     nodes = new CNode*[NEN];
 
     ND = 24;
-    LocationMatrix = new unsigned int[24];
+    LocationMatrix = new Index_t[24];
 
     ElementMaterial = nullptr;
 }
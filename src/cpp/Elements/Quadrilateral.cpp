@@ -23,7 +23,7 @@ CQuadrilateral::CQuadrilateral()
     nodes = new CNode*[NEN];
 
     ND = 12; // 12 DOF in total
-    LocationMatrix = new unsigned int[ND];
+    LocationMatrix = new Index_t[ND];
 
     ElementMaterial = NULL;
 }
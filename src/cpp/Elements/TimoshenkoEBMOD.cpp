@@ -24,7 +24,7 @@ CTimoshenkoEBMOD::CTimoshenkoEBMOD()
     nodes = new CNode*[NEN];
 
     ND = 12;
-    LocationMatrix = new unsigned int[ND];
+    LocationMatrix = new Index_t[ND];
 
     ElementMaterial = NULL;
 }
@@ -24,7 +24,7 @@ CTimoshenkoSRINT::CTimoshenkoSRINT()
     nodes = new CNode*[NEN];
 
     ND = 12;
-    LocationMatrix = new unsigned int[ND];
+    LocationMatrix = new Index_t[ND];
 
     ElementMaterial = NULL;
 }
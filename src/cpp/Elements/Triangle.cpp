@@ -23,7 +23,7 @@ CTriangle::CTriangle()
     nodes = new CNode*[NEN];
 
     ND = 9;
-    LocationMatrix = new unsigned int[ND];
+    LocationMatrix = new Index_t[ND];
 
     ElementMaterial = NULL;
 }
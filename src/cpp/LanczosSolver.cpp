@@ -0,0 +1,331 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#include "LanczosSolver.h"
+#include "Eigen/Dense"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+using namespace std;
+using namespace Eigen;
+
+void CLanczosSolver::MultiplyMass(const double* W, double* MW, unsigned int Width)
+{
+    if (M)
+    {
+        M->Multiply(W, MW, Width, NumThreads);
+        return;
+    }
+
+    for (unsigned int j = 0; j < Width; j++)
+        for (Index_t i = 0; i < N; i++)
+            MW[(size_t)j * N + i] = LumpedM[i] * W[(size_t)j * N + i];
+}
+
+void CLanczosSolver::Apply(double* W, unsigned int Width)
+{
+    if (Width == 1)
+        Solver.BackSubstitution(W);
+    else
+        Solver.BackSubstitution(W, Width);
+
+    Applications += Width;
+}
+
+//  Classical Gram-Schmidt in the M inner product, repeated once to recover the orthogonality
+//  lost to round-off
+void CLanczosSolver::Orthogonalize(double* W, unsigned int Width, unsigned int Basis, vector<double>& C)
+{
+    C.assign((size_t)Basis * Width, 0.0);
+    if (Basis == 0)
+        return;
+
+    Map<MatrixXd> Wm(W, N, Width);
+    Map<MatrixXd> Cm(C.data(), Basis, Width);
+    Map<const MatrixXd> Qm(Q.data(), N, Basis);
+    Map<const MatrixXd> MQm(MQ.data(), N, Basis);
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        const MatrixXd Cp = MQm.transpose() * Wm;
+        Wm.noalias() -= Qm * Cp;
+        Cm += Cp;
+    }
+}
+
+//  Two passes of W = W_new * Lambda^(1/2) * V^T from the eigenvalue decomposition of the Gram
+//  matrix W^T M W = V Lambda V^T, the second one correcting the round-off of the first
+unsigned int CLanczosSolver::Orthonormalize(double* W, double* MW, unsigned int Width, double Scale,
+                                            vector<double>& R)
+{
+    Map<MatrixXd> Wm(W, N, Width);
+    Map<MatrixXd> MWm(MW, N, Width);
+
+    MatrixXd Rm = MatrixXd::Identity(Width, Width);
+    unsigned int Kept = Width;
+
+    for (int pass = 0; pass < 2 && Kept; pass++)
+    {
+        MatrixXd G = Wm.leftCols(Kept).transpose() * MWm.leftCols(Kept);
+        G = 0.5 * (G + G.transpose()).eval();
+
+        SelfAdjointEigenSolver<MatrixXd> Eig(G);
+
+        // Largest eigenvalues first; the others are round-off of vectors in the span of Q
+        const double Drop = 1.0e-24 * (pass == 0 ? Scale : 1.0);
+        unsigned int k = 0;
+        while (k < Kept && Eig.eigenvalues()(Kept - 1 - k) > Drop)
+            k++;
+
+        MatrixXd V(Kept, k);
+        VectorXd Sqrt(k);
+        for (unsigned int c = 0; c < k; c++)
+        {
+            V.col(c) = Eig.eigenvectors().col(Kept - 1 - c);
+            Sqrt(c) = sqrt(Eig.eigenvalues()(Kept - 1 - c));
+        }
+
+        const MatrixXd T = V * Sqrt.cwiseInverse().asDiagonal();
+        const MatrixXd Wk = Wm.leftCols(Kept) * T;
+        const MatrixXd MWk = MWm.leftCols(Kept) * T;
+        Wm.leftCols(k) = Wk;
+        MWm.leftCols(k) = MWk;
+
+        Rm = (Sqrt.asDiagonal() * V.transpose() * Rm).eval();
+        Kept = k;
+    }
+
+    R.assign(Rm.data(), Rm.data() + (size_t)Kept * Width);
+    return Kept;
+}
+
+//  Random vectors multiplied by OP, so that they lie in the range of OP even if M is singular
+unsigned int CLanczosSolver::RandomBlock(unsigned int Basis, unsigned int Width, unsigned int Seed)
+{
+    mt19937 Generator(Seed);
+    uniform_real_distribution<double> Uniform(-1.0, 1.0);
+
+    vector<double> X((size_t)N * Width), W((size_t)N * Width), MW((size_t)N * Width);
+    for (double& x : X)
+        x = Uniform(Generator);
+
+    MultiplyMass(X.data(), W.data(), Width);
+    Apply(W.data(), Width);
+
+    vector<double> C, R;
+    Orthogonalize(W.data(), Width, Basis, C);
+    MultiplyMass(W.data(), MW.data(), Width);
+
+    double Scale = 0.0;
+    for (unsigned int j = 0; j < Width; j++)
+    {
+        double s = 0.0;
+        for (unsigned int i = 0; i < Basis; i++)
+            s += C[(size_t)j * Basis + i] * C[(size_t)j * Basis + i];
+        for (Index_t k = 0; k < N; k++)
+            s += W[(size_t)j * N + k] * MW[(size_t)j * N + k];
+        Scale = max(Scale, s);
+    }
+
+    const unsigned int Kept = min(Orthonormalize(W.data(), MW.data(), Width, Scale, R), Columns - Basis);
+    copy(W.begin(), W.begin() + (size_t)Kept * N, Q.begin() + (size_t)Basis * N);
+    copy(MW.begin(), MW.begin() + (size_t)Kept * N, MQ.begin() + (size_t)Basis * N);
+
+    return Kept;
+}
+
+//  The basis holds the columns 0:Basis-1, which have been expanded, followed by the block of
+//  Width columns expanded next. H is the projection Q^T M OP Q of the operator on the basis,
+//  including the coupling of the next block, so that OP Q = Q H + (the next block) * coupling.
+bool CLanczosSolver::Solve(unsigned int NumModes, double* EigenValues, double* EigenVectors,
+                           unsigned int MaxRestarts)
+{
+    N = Solver.dim();
+    Applications = 0;
+    Restarts = 0;
+
+    if (NumModes == 0)
+        return true;
+
+    if (NumModes > N)
+    {
+        cerr << "*** Error *** " << NumModes << " modes are asked for " << N << " equations" << endl;
+        return false;
+    }
+
+    const unsigned int p = (unsigned int)min<Index_t>(BlockSize ? BlockSize : min(NumModes, 8u), N);
+
+    // Basis kept between restarts, with room for the next block
+    const unsigned int MaxBasis = (unsigned int)min<Index_t>(N, max(2 * NumModes, NumModes + 4 * p));
+    Columns = (unsigned int)min<Index_t>(N, MaxBasis + p);
+
+    Q.assign((size_t)N * Columns, 0.0);
+    MQ.assign((size_t)N * Columns, 0.0);
+    MatrixXd H = MatrixXd::Zero(Columns, Columns);
+
+    unsigned int Seed = 1;
+    unsigned int NextCheck = 0;
+    unsigned int Basis = 0;
+    unsigned int Width = RandomBlock(0, p, Seed);
+
+    vector<double> W, MW, C, R;
+    SelfAdjointEigenSolver<MatrixXd> Ritz;
+    vector<unsigned int> Wanted;
+
+    while (true)
+    {
+        const unsigned int Block = Basis;
+        const unsigned int Current = Basis + Width;
+
+        // W = OP * Q_block, M-orthogonalized to the whole basis
+        W.assign(MQ.begin() + (size_t)Block * N, MQ.begin() + (size_t)Current * N);
+        Apply(W.data(), Width);
+
+        Orthogonalize(W.data(), Width, Current, C);
+        MW.resize((size_t)N * Width);
+        MultiplyMass(W.data(), MW.data(), Width);
+
+        double Scale = 0.0;
+        for (unsigned int j = 0; j < Width; j++)
+        {
+            double s = 0.0;
+            for (unsigned int i = 0; i < Current; i++)
+                s += C[(size_t)j * Current + i] * C[(size_t)j * Current + i];
+            for (Index_t k = 0; k < N; k++)
+                s += W[(size_t)j * N + k] * MW[(size_t)j * N + k];
+            Scale = max(Scale, s);
+        }
+
+        unsigned int Next = min(Orthonormalize(W.data(), MW.data(), Width, Scale, R), Columns - Current);
+        copy(W.begin(), W.begin() + (size_t)Next * N, Q.begin() + (size_t)Current * N);
+        copy(MW.begin(), MW.begin() + (size_t)Next * N, MQ.begin() + (size_t)Current * N);
+
+        for (unsigned int j = 0; j < Width; j++)
+        {
+            for (unsigned int i = 0; i < Current; i++)
+                H(i, Block + j) = H(Block + j, i) = C[(size_t)j * Current + i];
+            for (unsigned int i = 0; i < Next; i++)
+                H(Current + i, Block + j) = H(Block + j, Current + i) = R[(size_t)j * Next + i];
+        }
+
+        for (unsigned int i = 0; i < Width; i++)
+            for (unsigned int j = 0; j < i; j++)
+                H(Block + i, Block + j) = H(Block + j, Block + i) =
+                    0.5 * (C[(size_t)j * Current + Block + i] + C[(size_t)i * Current + Block + j]);
+
+        // The basis is restarted once there is no room left for the block after the next one
+        bool Restart = Current + Next + p > Columns && Columns < N;
+
+        // Ritz values of the basis, calculated every NumModes/2 columns and before a restart;
+        // the residual of Ritz vector Q*y is (next block)*coupling*y
+        if (Current >= NumModes && (Current >= NextCheck || Restart || Next == 0))
+        {
+            NextCheck = Current + max(p, NumModes / 2);
+
+            Ritz.compute(H.topLeftCorner(Current, Current));
+            const VectorXd& Theta = Ritz.eigenvalues();
+
+            Wanted.resize(Current);
+            for (unsigned int i = 0; i < Current; i++)
+                Wanted[i] = i;
+            sort(Wanted.begin(), Wanted.end(),
+                 [&Theta](unsigned int a, unsigned int b) { return fabs(Theta(a)) > fabs(Theta(b)); });
+            Wanted.resize(NumModes);
+
+            const MatrixXd Coupling = H.block(Current, 0, Next, Current) * Ritz.eigenvectors();
+
+            bool Converged = true;
+            for (unsigned int i : Wanted)
+                if (Coupling.col(i).norm() > Tolerance * fabs(Theta(i)))
+                    Converged = false;
+
+            if (Converged)
+            {
+                sort(Wanted.begin(), Wanted.end(),
+                     [&Theta, this](unsigned int a, unsigned int b)
+                     { return Shift + 1.0 / Theta(a) < Shift + 1.0 / Theta(b); });
+
+                Map<const MatrixXd> Qm(Q.data(), N, Current);
+                for (unsigned int m = 0; m < NumModes; m++)
+                {
+                    EigenValues[m] = Shift + 1.0 / Theta(Wanted[m]);
+                    Map<VectorXd>(EigenVectors + (size_t)m * N, N) = Qm * Ritz.eigenvectors().col(Wanted[m]);
+                }
+
+                return true;
+            }
+        }
+
+        // The basis spans an invariant subspace: continue from random vectors
+        if (Next == 0)
+        {
+            if (Current >= Columns)
+            {
+                cerr << "*** Error *** The Lanczos basis spans all the equations without converging" << endl;
+                return false;
+            }
+
+            Next = RandomBlock(Current, min(p, Columns - Current), ++Seed);
+            Restart = Current + Next + p > Columns && Columns < N;
+        }
+
+        Basis = Current;
+        Width = Next;
+
+        // Thick restart from the wanted Ritz vectors and the next block
+        if (Restart)
+        {
+            if (++Restarts > MaxRestarts)
+            {
+                cerr << "*** Error *** The Lanczos eigensolver did not converge in " << MaxRestarts
+                     << " restarts" << endl;
+                return false;
+            }
+
+            const unsigned int Kept = min(NumModes + (MaxBasis - NumModes) / 2, Basis);
+
+            vector<unsigned int> Order(Basis);
+            for (unsigned int i = 0; i < Basis; i++)
+                Order[i] = i;
+            const VectorXd& Theta = Ritz.eigenvalues();
+            sort(Order.begin(), Order.end(),
+                 [&Theta](unsigned int a, unsigned int b) { return fabs(Theta(a)) > fabs(Theta(b)); });
+
+            MatrixXd Y(Basis, Kept);
+            for (unsigned int k = 0; k < Kept; k++)
+                Y.col(k) = Ritz.eigenvectors().col(Order[k]);
+
+            Map<MatrixXd> Qm(Q.data(), N, Columns);
+            Map<MatrixXd> MQm(MQ.data(), N, Columns);
+            const MatrixXd X = Qm.leftCols(Basis) * Y;
+            const MatrixXd MX = MQm.leftCols(Basis) * Y;
+            Qm.leftCols(Kept) = X;
+            MQm.leftCols(Kept) = MX;
+            for (unsigned int c = 0; c < Width; c++)
+            {
+                Qm.col(Kept + c) = Qm.col(Basis + c);
+                MQm.col(Kept + c) = MQm.col(Basis + c);
+            }
+
+            const MatrixXd Coupling = H.block(Basis, 0, Width, Basis) * Y;
+            H.setZero();
+            for (unsigned int k = 0; k < Kept; k++)
+                H(k, k) = Theta(Order[k]);
+            H.block(Kept, 0, Width, Kept) = Coupling;
+            H.block(0, Kept, Kept, Width) = Coupling.transpose();
+
+            Basis = Kept;
+            NextCheck = 0;
+        }
+    }
+}
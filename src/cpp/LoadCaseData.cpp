@@ -20,6 +20,8 @@ CLoadCaseData :: ~CLoadCaseData()
 	delete [] node;
 	delete [] dof;
 	delete [] load;
+	delete [] time;
+	delete [] factor;
 }
 
 void CLoadCaseData :: Allocate(unsigned int num)
@@ -64,3 +66,63 @@ void CLoadCaseData::Write(COutputter& output, unsigned int lcase)
 		output << setw(7) << node[i] << setw(13) << dof[i]  << setw(19) << load[i] << endl;
 	}
 }
+
+//	Read the time function: load case number (LL), number of points (NP) and the NP pairs of
+//	time and factor
+bool CLoadCaseData::ReadTimeFunction(ifstream& Input, unsigned int lcase)
+{
+	unsigned int LL, NP;
+
+	Input >> LL >> NP;
+
+	if (LL != lcase + 1)
+	{
+		cerr << "*** Error *** Time functions must be inputted in the order of the load cases !" << endl
+			 << "   Expected load case : " << lcase + 1 << endl
+			 << "   Provided load case : " << LL << endl;
+
+		return false;
+	}
+
+	delete [] time;
+	delete [] factor;
+
+	npoints = NP;
+	time = new double[npoints];
+	factor = new double[npoints];
+
+	for (unsigned int i = 0; i < NP; i++)
+	{
+		Input >> time[i] >> factor[i];
+
+		if (i && time[i] < time[i - 1])
+		{
+			cerr << "*** Error *** The times of the time function of load case " << LL
+				 << " must increase !" << endl;
+
+			return false;
+		}
+	}
+
+	return !Input.fail();
+}
+
+//	Factor of the loads at time t
+double CLoadCaseData::TimeFunction(double t) const
+{
+	if (npoints == 0)
+		return 1.0;
+
+	if (t <= time[0])
+		return factor[0];
+
+	for (unsigned int i = 1; i < npoints; i++)
+		if (t <= time[i])
+		{
+			const double dt = time[i] - time[i - 1];
+			return dt > 0.0 ? factor[i - 1] + (factor[i] - factor[i - 1]) * (t - time[i - 1]) / dt
+			                : factor[i];
+		}
+
+	return factor[npoints - 1];
+}
@@ -0,0 +1,157 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#include "NewmarkSolver.h"
+
+#include <algorithm>
+
+using namespace std;
+
+CNewmarkSolver::CNewmarkSolver(CSkylineMatrix<double>& _K, CSkylineMatrix<double>& _M, double _TimeStep,
+                               double _Alpha, double _DampingM, double _DampingK, unsigned int _NumThreads)
+    : K(_K), M(&_M), LumpedM(nullptr), TimeStep(_TimeStep), Alpha(_Alpha), DampingM(_DampingM),
+      DampingK(_DampingK), NumThreads(_NumThreads), N(_K.dim()), Effective(nullptr),
+      EffectiveSolver(nullptr), Time(0.0)
+{
+    Beta = 0.25 * (1.0 - Alpha) * (1.0 - Alpha);
+    Gamma = 0.5 - Alpha;
+}
+
+CNewmarkSolver::CNewmarkSolver(CSkylineMatrix<double>& _K, const double* _LumpedM, double _TimeStep,
+                               double _Alpha, double _DampingM, double _DampingK, unsigned int _NumThreads)
+    : K(_K), M(nullptr), LumpedM(_LumpedM), TimeStep(_TimeStep), Alpha(_Alpha), DampingM(_DampingM),
+      DampingK(_DampingK), NumThreads(_NumThreads), N(_K.dim()), Effective(nullptr),
+      EffectiveSolver(nullptr), Time(0.0)
+{
+    Beta = 0.25 * (1.0 - Alpha) * (1.0 - Alpha);
+    Gamma = 0.5 - Alpha;
+}
+
+CNewmarkSolver::~CNewmarkSolver()
+{
+    delete EffectiveSolver;
+    delete Effective;
+}
+
+void CNewmarkSolver::MultiplyMass(const double* x, double* y)
+{
+    if (M)
+        M->Multiply(x, y, 1, NumThreads);
+    else
+        for (Index_t i = 0; i < N; i++)
+            y[i] = LumpedM[i] * x[i];
+}
+
+void CNewmarkSolver::Factorize()
+{
+    const double dt = TimeStep;
+    const double FactorM = 1.0 / (Beta * dt * dt) + (1.0 + Alpha) * Gamma / (Beta * dt) * DampingM;
+    const double FactorK = (1.0 + Alpha) * (1.0 + Gamma / (Beta * dt) * DampingK);
+
+    Effective = new CSkylineMatrix<double>(N);
+    copy(K.GetColumnHeights(), K.GetColumnHeights() + N, Effective->GetColumnHeights());
+    copy(K.GetDiagonalAddress(), K.GetDiagonalAddress() + N + 1, Effective->GetDiagonalAddress());
+    Effective->Allocate();
+
+    const double* k = K.GetData();
+    double* e = Effective->GetData();
+    for (Index_t i = 0; i < Effective->size(); i++)
+        e[i] = FactorK * k[i];
+
+    if (M)
+    {
+        const double* m = M->GetData();
+        for (Index_t i = 0; i < Effective->size(); i++)
+            e[i] += FactorM * m[i];
+    }
+    else
+        for (Index_t j = 1; j <= N; j++)
+            (*Effective)(j, j) += FactorM * LumpedM[j - 1];
+
+    EffectiveSolver = new CLDLTSolver(*Effective);
+    if (NumThreads != 1)
+        EffectiveSolver->ParallelLDLT(NumThreads);
+    else
+        EffectiveSolver->LDLT();
+}
+
+//  The initial accelerations solve M a = F; the DOFs without lumped mass get none
+void CNewmarkSolver::Initialize(const double* Force)
+{
+    Time = 0.0;
+    U.assign(N, 0.0);
+    V.assign(N, 0.0);
+    A.assign(Force, Force + N);
+    R.resize(N);
+    W.resize(N);
+    X.resize(N);
+
+    if (!EffectiveSolver)
+        Factorize();
+
+    if (none_of(A.begin(), A.end(), [](double f) { return f != 0.0; }))
+        return;
+
+    if (M)
+    {
+        CSkylineMatrix<double> Mass(N);
+        copy(M->GetColumnHeights(), M->GetColumnHeights() + N, Mass.GetColumnHeights());
+        copy(M->GetDiagonalAddress(), M->GetDiagonalAddress() + N + 1, Mass.GetDiagonalAddress());
+        Mass.Allocate();
+        copy(M->GetData(), M->GetData() + M->size(), Mass.GetData());
+
+        CLDLTSolver MassSolver(Mass);
+        MassSolver.LDLT();
+        MassSolver.BackSubstitution(A.data());
+    }
+    else
+        for (Index_t i = 0; i < N; i++)
+            A[i] = LumpedM[i] > 0.0 ? A[i] / LumpedM[i] : 0.0;
+}
+
+//  Solve K_eff du = R for the increment du of the displacements, with
+//      R = F_alpha - K (u + DampingK w) + M (v/(beta dt) + (1/(2 beta) - 1) a - DampingM w),
+//      w = ((1 + alpha)(1 - gamma/beta) - alpha) v + (1 + alpha) dt (1 - gamma/(2 beta)) a
+//  the damping forces being C w
+void CNewmarkSolver::Step(const double* Force, const double* NextForce)
+{
+    const double dt = TimeStep;
+    const double a0 = 1.0 / (Beta * dt * dt);
+    const double a2 = 1.0 / (Beta * dt);
+    const double a3 = 0.5 / Beta - 1.0;
+    const double cv = (1.0 + Alpha) * (1.0 - Gamma / Beta) - Alpha;
+    const double ca = (1.0 + Alpha) * dt * (1.0 - 0.5 * Gamma / Beta);
+
+    // W = u + DampingK w, and X = v/(beta dt) + (1/(2 beta) - 1) a - DampingM w
+    for (Index_t i = 0; i < N; i++)
+    {
+        const double w = cv * V[i] + ca * A[i];
+        W[i] = U[i] + DampingK * w;
+        X[i] = a2 * V[i] + a3 * A[i] - DampingM * w;
+    }
+
+    K.Multiply(W.data(), R.data(), 1, NumThreads);
+    MultiplyMass(X.data(), W.data());
+
+    for (Index_t i = 0; i < N; i++)
+        R[i] = (1.0 + Alpha) * NextForce[i] - Alpha * Force[i] - R[i] + W[i];
+
+    EffectiveSolver->BackSubstitution(R.data());
+
+    for (Index_t i = 0; i < N; i++)
+    {
+        const double NextA = a0 * R[i] - a2 * V[i] - a3 * A[i];
+        V[i] += dt * ((1.0 - Gamma) * A[i] + Gamma * NextA);
+        U[i] += R[i];
+        A[i] = NextA;
+    }
+
+    Time += dt;
+}
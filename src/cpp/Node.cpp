@@ -86,18 +86,24 @@ bool CNode::Read(ifstream& Input, unsigned int np)
 	// Rewrite the flag marking whether the rotation DOF are manually input
 	RotationDOFManuallyInputFlag = (tabBlockNum == 9);
 	// Save the nodal infos to bcode[0:5] and XYZ[]
+	//     The codes are read as int, whatever the width of Index_t
+	int code[NDF];
 	if (tabBlockNum == 9)
 	{
 		sscanf(NodeInfo.c_str(), "%d%d%d%d%d%d%lf%lf%lf",
-			bcode, bcode+1, bcode+2,
-			bcode+3, bcode+4, bcode+5,
+			code, code+1, code+2,
+			code+3, code+4, code+5,
 			XYZ, XYZ+1, XYZ+2);
+		for (unsigned int dof = 0; dof < 6; dof++)
+			bcode[dof] = code[dof];
 	}
 	else if (tabBlockNum == 6)
 	{
 		sscanf(NodeInfo.c_str(), "%d%d%d%lf%lf%lf",
-			bcode, bcode+1, bcode+2,
+			code, code+1, code+2,
 			XYZ, XYZ+1, XYZ+2);
+		for (unsigned int dof = 0; dof < 3; dof++)
+			bcode[dof] = code[dof];
 	}
 	else
 	{
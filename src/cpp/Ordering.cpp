@@ -0,0 +1,505 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#include "Ordering.h"
+
+#include <algorithm>
+#include <queue>
+#include <set>
+#include <utility>
+
+using namespace std;
+
+//  Rooted level structure of the component of root
+int CGraphOrdering::LevelStructure(int root, const vector<bool>& Numbered, vector<int>& Level,
+                                   vector<int>& Visit) const
+{
+    Visit.clear();
+    Visit.push_back(root);
+    Level[root] = 0;
+
+    int depth = 0;
+    for (size_t head = 0; head < Visit.size(); head++)
+    {
+        const int i = Visit[head];
+        depth = Level[i];
+        for (int p = Start[i]; p < Start[i + 1]; p++)
+        {
+            const int j = Index[p];
+            if (!Numbered[j] && Level[j] < 0)
+            {
+                Level[j] = Level[i] + 1;
+                Visit.push_back(j);
+            }
+        }
+    }
+
+    return depth + 1;
+}
+
+//  Pseudo-peripheral vertices
+void CGraphOrdering::PseudoPeripheral(int& Root, int& End, const vector<bool>& Numbered) const
+{
+    vector<int> Level(N, -1), Visit;
+
+    int depth = LevelStructure(Root, Numbered, Level, Visit);
+
+    while (true)
+    {
+        // Vertex of minimum degree in the last level
+        End = Visit.back();
+        for (auto it = Visit.rbegin(); it != Visit.rend() && Level[*it] == depth - 1; ++it)
+            if (Degree(*it) <= Degree(End))
+                End = *it;
+
+        for (int i : Visit)
+            Level[i] = -1;
+
+        const int new_depth = LevelStructure(End, Numbered, Level, Visit);
+        if (new_depth <= depth)
+            break;
+
+        Root = End;
+        depth = new_depth;
+    }
+
+    for (int i : Visit)
+        Level[i] = -1;
+}
+
+//  Reverse Cuthill-McKee
+void CGraphOrdering::RCM(vector<int>& Order) const
+{
+    Order.clear();
+    Order.reserve(N);
+
+    vector<bool> Numbered(N, false);
+    vector<int> Neighbours;
+
+    for (int first = 0; first < N; first++)
+    {
+        if (Numbered[first])
+            continue;
+
+        // Start from a pseudo-peripheral vertex of the component of first
+        int Root = first, End;
+        PseudoPeripheral(Root, End, Numbered);
+
+        size_t head = Order.size();
+        Order.push_back(Root);
+        Numbered[Root] = true;
+
+        // Cuthill-McKee: number the unnumbered neighbours by increasing degree
+        for (; head < Order.size(); head++)
+        {
+            const int i = Order[head];
+
+            Neighbours.clear();
+            for (int p = Start[i]; p < Start[i + 1]; p++)
+                if (!Numbered[Index[p]])
+                {
+                    Neighbours.push_back(Index[p]);
+                    Numbered[Index[p]] = true;
+                }
+
+            stable_sort(Neighbours.begin(), Neighbours.end(),
+                        [this](int a, int b) { return Degree(a) < Degree(b); });
+
+            Order.insert(Order.end(), Neighbours.begin(), Neighbours.end());
+        }
+    }
+
+    reverse(Order.begin(), Order.end());
+}
+
+//  Sloan (1989): number the vertices by decreasing priority, where the priority grows
+//  with the distance to the end vertex and falls with the growth of the front
+void CGraphOrdering::Sloan(vector<int>& Order, int W1, int W2) const
+{
+    enum Status
+    {
+        Inactive,
+        Preactive,
+        Active,
+        Postactive
+    };
+
+    Order.clear();
+    Order.reserve(N);
+
+    vector<bool> Numbered(N, false);
+    vector<int> Level(N, -1), Visit, Priority(N);
+    vector<Status> State(N, Inactive);
+
+    // Queue of (priority, -vertex), so ties go to the smaller vertex. An entry is
+    // outdated if the priority of its vertex has changed since it was pushed
+    priority_queue<pair<int, int>> Queue;
+
+    for (int first = 0; first < N; first++)
+    {
+        if (Numbered[first])
+            continue;
+
+        int Root = first, End;
+        PseudoPeripheral(Root, End, Numbered);
+
+        LevelStructure(End, Numbered, Level, Visit);
+        for (int i : Visit)
+            Priority[i] = W1 * Level[i] - W2 * (Degree(i) + 1);
+
+        State[Root] = Preactive;
+        Queue.push(make_pair(Priority[Root], -Root));
+
+        while (!Queue.empty())
+        {
+            const int i = -Queue.top().second;
+            const int pi = Queue.top().first;
+            Queue.pop();
+
+            if (Numbered[i] || pi != Priority[i])
+                continue;
+
+            if (State[i] == Preactive)
+            {
+                for (int p = Start[i]; p < Start[i + 1]; p++)
+                {
+                    const int j = Index[p];
+                    if (Numbered[j])
+                        continue;
+
+                    Priority[j] += W2;
+                    if (State[j] == Inactive)
+                        State[j] = Preactive;
+                    Queue.push(make_pair(Priority[j], -j));
+                }
+            }
+
+            Order.push_back(i);
+            Numbered[i] = true;
+            State[i] = Postactive;
+
+            for (int p = Start[i]; p < Start[i + 1]; p++)
+            {
+                const int j = Index[p];
+                if (State[j] != Preactive)
+                    continue;
+
+                State[j] = Active;
+                Priority[j] += W2;
+                Queue.push(make_pair(Priority[j], -j));
+
+                for (int q = Start[j]; q < Start[j + 1]; q++)
+                {
+                    const int k = Index[q];
+                    if (State[k] == Postactive)
+                        continue;
+
+                    Priority[k] += W2;
+                    if (State[k] == Inactive)
+                        State[k] = Preactive;
+                    Queue.push(make_pair(Priority[k], -k));
+                }
+            }
+        }
+
+        for (int i : Visit)
+            Level[i] = -1;
+    }
+}
+
+//  Approximate minimum degree. Eliminated vertices become elements of the quotient graph:
+//  A[i] and E[i] are the variables and elements adjacent to variable i, and L[e] holds the
+//  variables of element e. The external degree of a variable is bounded from above by
+//  |A[i]| + |L[p] \ i| + sum |L[e] \ L[p]| over the other elements of i
+void CGraphOrdering::AMD(const vector<int>& Weight, vector<int>& Order) const
+{
+    Order.clear();
+    Order.reserve(N);
+
+    vector<vector<int>> A(N), E(N), L(N);
+    vector<bool> Eliminated(N, false), Absorbed(N, false);
+    vector<int> ApproxDegree(N, 0), LWeight(N, 0), Mark(N, -1), Stamp(N, -1), External(N, 0);
+
+    long long Remaining = 0;
+    set<pair<int, int>> Queue;
+    for (int i = 0; i < N; i++)
+    {
+        A[i].assign(Index.begin() + Start[i], Index.begin() + Start[i + 1]);
+        for (int j : A[i])
+            ApproxDegree[i] += Weight[j];
+
+        Remaining += Weight[i];
+        Queue.insert(make_pair(ApproxDegree[i], i));
+    }
+
+    while (!Queue.empty())
+    {
+        const int p = Queue.begin()->second;
+        Queue.erase(Queue.begin());
+
+        Order.push_back(p);
+        Eliminated[p] = true;
+        Remaining -= Weight[p];
+
+        // The new element p: variables adjacent to p, directly or through its elements,
+        // which are absorbed by p
+        vector<int>& Lp = L[p];
+        int LpWeight = 0;
+        for (int i : A[p])
+            if (!Eliminated[i] && Mark[i] != p)
+            {
+                Mark[i] = p;
+                Lp.push_back(i);
+                LpWeight += Weight[i];
+            }
+
+        for (int e : E[p])
+        {
+            if (Absorbed[e])
+                continue;
+
+            for (int i : L[e])
+                if (!Eliminated[i] && Mark[i] != p)
+                {
+                    Mark[i] = p;
+                    Lp.push_back(i);
+                    LpWeight += Weight[i];
+                }
+
+            Absorbed[e] = true;
+            vector<int>().swap(L[e]);
+        }
+
+        vector<int>().swap(A[p]);
+        vector<int>().swap(E[p]);
+        LWeight[p] = LpWeight;
+
+        // |L[e] \ L[p]| of the other elements adjacent to the variables of L[p]
+        for (int i : Lp)
+            for (int e : E[i])
+            {
+                if (Absorbed[e])
+                    continue;
+
+                if (Stamp[e] != p)
+                {
+                    Stamp[e] = p;
+                    External[e] = LWeight[e];
+                }
+                External[e] -= Weight[i];
+            }
+
+        // Update the variables of L[p]
+        for (int i : Lp)
+        {
+            int ElementDegree = 0;
+            size_t m = 0;
+            for (int e : E[i])
+            {
+                if (Absorbed[e])
+                    continue;
+
+                // Aggressive absorption of the elements contained in L[p]
+                if (External[e] == 0)
+                {
+                    Absorbed[e] = true;
+                    vector<int>().swap(L[e]);
+                    continue;
+                }
+
+                E[i][m++] = e;
+                ElementDegree += External[e];
+            }
+            E[i].resize(m);
+            E[i].push_back(p);
+
+            // The variables of L[p] are reached through p now
+            int VariableDegree = 0;
+            m = 0;
+            for (int j : A[i])
+            {
+                if (Eliminated[j] || Mark[j] == p)
+                    continue;
+
+                A[i][m++] = j;
+                VariableDegree += Weight[j];
+            }
+            A[i].resize(m);
+
+            long long d = VariableDegree + (LpWeight - Weight[i]) + ElementDegree;
+            d = min(d, (long long)ApproxDegree[i] + LpWeight - Weight[i]);
+            d = min(d, Remaining - Weight[i]);
+
+            Queue.erase(make_pair(ApproxDegree[i], i));
+            ApproxDegree[i] = int(d);
+            Queue.insert(make_pair(ApproxDegree[i], i));
+        }
+    }
+}
+
+//  Recursive bisection for nested dissection
+void CGraphOrdering::Dissect(vector<int>& Part, const vector<double>& XYZ, vector<int>& Side,
+                             vector<int>& Order, int LeafSize) const
+{
+    const size_t n = Part.size();
+
+    // Split along the longest side of the bounding box
+    int axis = 0;
+    double extent = 0.0;
+    if (n > size_t(LeafSize))
+        for (int d = 0; d < 3; d++)
+        {
+            double lo = XYZ[3 * Part[0] + d], hi = lo;
+            for (int v : Part)
+            {
+                lo = min(lo, XYZ[3 * v + d]);
+                hi = max(hi, XYZ[3 * v + d]);
+            }
+
+            if (hi - lo > extent)
+            {
+                extent = hi - lo;
+                axis = d;
+            }
+        }
+
+    if (n <= size_t(LeafSize) || extent == 0.0)
+    {
+        Order.insert(Order.end(), Part.begin(), Part.end());
+        return;
+    }
+
+    const size_t mid = n / 2;
+    nth_element(Part.begin(), Part.begin() + mid, Part.end(), [&XYZ, axis](int a, int b) {
+        return XYZ[3 * a + axis] < XYZ[3 * b + axis] ||
+               (XYZ[3 * a + axis] == XYZ[3 * b + axis] && a < b);
+    });
+
+    for (size_t k = 0; k < n; k++)
+        Side[Part[k]] = k < mid ? 0 : 1;
+
+    // The separator is the boundary of the half with fewer vertices next to the other half
+    vector<int> Boundary[2], Half[2];
+    for (int v : Part)
+    {
+        bool cut = false;
+        for (int p = Start[v]; p < Start[v + 1] && !cut; p++)
+            cut = Side[Index[p]] == 1 - Side[v];
+
+        if (cut)
+            Boundary[Side[v]].push_back(v);
+    }
+
+    const int s = Boundary[0].size() <= Boundary[1].size() ? 0 : 1;
+    for (int v : Boundary[s])
+        Side[v] = 2;
+
+    for (int v : Part)
+    {
+        if (Side[v] < 2)
+            Half[Side[v]].push_back(v);
+        Side[v] = -1;
+    }
+
+    vector<int>().swap(Part);
+
+    if (Half[0].empty() || Half[1].empty())
+    {
+        Order.insert(Order.end(), Half[0].begin(), Half[0].end());
+        Order.insert(Order.end(), Half[1].begin(), Half[1].end());
+    }
+    else
+    {
+        Dissect(Half[0], XYZ, Side, Order, LeafSize);
+        Dissect(Half[1], XYZ, Side, Order, LeafSize);
+    }
+
+    Order.insert(Order.end(), Boundary[s].begin(), Boundary[s].end());
+}
+
+//  Geometric nested dissection
+void CGraphOrdering::NestedDissection(const vector<double>& XYZ, vector<int>& Order,
+                                      int LeafSize) const
+{
+    Order.clear();
+    Order.reserve(N);
+
+    vector<int> Side(N, -1), Part(N);
+    for (int i = 0; i < N; i++)
+        Part[i] = i;
+
+    Dissect(Part, XYZ, Side, Order, LeafSize);
+}
+
+//  Elimination tree and row subtrees of the graph numbered by Order
+void CGraphOrdering::SymbolicFactorization(const vector<int>& Order, const vector<int>& Weight,
+                                           double& Fill, double& Flops) const
+{
+    vector<int> Inverse(N);
+    for (int k = 0; k < N; k++)
+        Inverse[Order[k]] = k;
+
+    // Elimination tree (Liu) with path compression
+    vector<int> Parent(N, -1), Ancestor(N, -1);
+    for (int k = 0; k < N; k++)
+    {
+        const int i = Order[k];
+        for (int p = Start[i]; p < Start[i + 1]; p++)
+        {
+            int r = Inverse[Index[p]];
+            if (r >= k)
+                continue;
+
+            while (Ancestor[r] != -1 && Ancestor[r] != k)
+            {
+                const int next = Ancestor[r];
+                Ancestor[r] = k;
+                r = next;
+            }
+
+            if (Ancestor[r] == -1)
+            {
+                Ancestor[r] = k;
+                Parent[r] = k;
+            }
+        }
+    }
+
+    // Row k of L covers the paths from its neighbours up to k in the elimination tree,
+    // Below[j] sums the weights of the rows below the diagonal in column j
+    vector<double> Below(N, 0.0);
+    vector<int> Mark(N, -1);
+    for (int k = 0; k < N; k++)
+    {
+        Mark[k] = k;
+        const int i = Order[k];
+        for (int p = Start[i]; p < Start[i + 1]; p++)
+        {
+            if (Inverse[Index[p]] > k)
+                continue;
+
+            for (int r = Inverse[Index[p]]; Mark[r] != k; r = Parent[r])
+            {
+                Mark[r] = k;
+                Below[r] += Weight[i];
+            }
+        }
+    }
+
+    // Vertex k stands for Weight equations, each coupled to those following it in k
+    Fill = Flops = 0.0;
+    for (int k = 0; k < N; k++)
+        for (int d = Weight[Order[k]]; d > 0; d--)
+        {
+            const double c = d + Below[k];
+            Fill += c;
+            Flops += c * c;
+        }
+}
@@ -11,10 +11,13 @@
 #include "Domain.h"
 #include "Outputter.h"
 #include "SkylineMatrix.h"
+#include "SolverRegistry.h"
 
 #include <iostream>
 #include <iomanip>
 #include <ctime>
+#include <algorithm>
+#include <cctype>
 
 
 using namespace std;
@@ -722,7 +725,7 @@ void COutputter::OutputNodalDisplacement(unsigned int lcase)
 {
 	CDomain* FEMData = CDomain::Instance();
 	CNode* NodeList = FEMData->GetNodeList();
-	double* Displacement = FEMData->GetDisplacement();
+	double* Displacement = FEMData->GetDisplacement(lcase);
 
 	*this << " LOAD CASE" << setw(5) << lcase + 1 << endl
 		  << endl
@@ -745,7 +748,8 @@ void COutputter::OutputElementStress()
 {
 	CDomain* FEMData = CDomain::Instance();
 
-	double* Displacement = FEMData->GetDisplacement();
+//	Stresses of the last load case
+	double* Displacement = FEMData->GetDisplacement(FEMData->GetNLCASE() - 1);
 
 	const unsigned int NUMEG = FEMData->GetNUMEG();
 
@@ -1069,16 +1073,105 @@ void COutputter::OutputTotalSystemData()
 	*this << "	TOTAL SYSTEM DATA" << endl
 		  << endl;
 
-	*this << "     NUMBER OF EQUATIONS . . . . . . . . . . . . . .(NEQ) = " << FEMData->GetNEQ()
-		  << endl
-		  << "     NUMBER OF MATRIX ELEMENTS . . . . . . . . . . .(NWK) = " << FEMData->GetNWK()
-		  << endl
-		  << "     MAXIMUM HALF BANDWIDTH  . . . . . . . . . . . .(MK ) = " << FEMData->GetMK()
-		  << endl
-		  << "     MEAN HALF BANDWIDTH . . . . . . . . . . . . . .(MM ) = "
-		  << FEMData->GetNWK() / FEMData->GetNEQ() << endl
-		  << endl
-		  << endl;
+	if (FEMData->GetSolverType() == SolverTypes::Substructure)
+	{
+		CSubstructureSolver& Substructures = FEMData->GetSubstructures();
+		*this << "     NUMBER OF EQUATIONS . . . . . . . . . . . . . .(NEQ) = " << FEMData->GetNEQ()
+			  << endl
+			  << "     NUMBER OF SUBSTRUCTURES  . . . . . . . . . . . . . . = " << Substructures.GetNumSubstructures()
+			  << endl
+			  << "     NUMBER OF DISTINCT SUBSTRUCTURES CONDENSED . . . . . = " << Substructures.GetNumCondensed()
+			  << endl
+			  << "     NUMBER OF INTERFACE EQUATIONS  . . . . . . . . . . . = " << Substructures.GetNumInterface()
+			  << endl
+			  << "     NUMBER OF INTERFACE MATRIX ELEMENTS  . . . . . . . . = " << FEMData->GetNWK()
+			  << endl
+			  << endl;
+	}
+#ifdef _VIB_
+	else if (FEMData->IsExplicit())
+		*this << "     NUMBER OF EQUATIONS . . . . . . . . . . . . . .(NEQ) = " << FEMData->GetNEQ()
+			  << endl
+			  << "     STIFFNESS MATRIX NOT ASSEMBLED (EXPLICIT ANALYSIS)" << endl
+			  << endl;
+#endif
+	else if (FEMData->GetSolverType() == SolverTypes::EBE)
+		*this << "     NUMBER OF EQUATIONS . . . . . . . . . . . . . .(NEQ) = " << FEMData->GetNEQ()
+			  << endl
+			  << "     STIFFNESS MATRIX NOT ASSEMBLED (ELEMENT-BY-ELEMENT PRODUCTS)" << endl
+			  << endl;
+	else
+		*this << "     NUMBER OF EQUATIONS . . . . . . . . . . . . . .(NEQ) = " << FEMData->GetNEQ()
+			  << endl
+			  << "     NUMBER OF MATRIX ELEMENTS . . . . . . . . . . .(NWK) = " << FEMData->GetNWK()
+			  << endl
+			  << "     MAXIMUM HALF BANDWIDTH  . . . . . . . . . . . .(MK ) = " << FEMData->GetMK()
+			  << endl
+			  << "     MEAN HALF BANDWIDTH . . . . . . . . . . . . . .(MM ) = "
+			  << FEMData->GetNWK() / FEMData->GetNEQ() << endl
+			  << endl;
+
+	if (FEMData->IsSolverChosen())
+	{
+		string Name = SolverName(FEMData->GetSolverType());
+		transform(Name.begin(), Name.end(), Name.begin(), ::toupper);
+
+		*this << "     SOLVER CHOSEN AUTOMATICALLY . . . . . . . . . . . . = " << Name << endl
+			  << "     AVAILABLE MEMORY (MB) . . . . . . . . . . . . . . . = "
+			  << (unsigned long long)(FEMData->GetAvailableMemory() / (1024 * 1024)) << endl
+			  << "     ENTRIES OF SKYLINE FACTOR . . . . . . . . . . . . . = " << (unsigned long long)FEMData->GetSkylineFill() << endl;
+		if (FEMData->GetCSREntries())
+			*this << "     PREDICTED ENTRIES OF SPARSE FACTOR  . . . . . . . . = " << FEMData->GetPredictedFill() << endl
+				  << "     ENTRIES OF CSR STIFFNESS MATRIX . . . . . . . . . . = " << (unsigned long long)FEMData->GetCSREntries() << endl;
+		*this << "     ESTIMATED MEMORY OF THE SOLVER (MB) . . . . . . . . = "
+			  << (unsigned long long)(FEMData->GetEstimatedMemory() / (1024 * 1024)) << endl
+			  << (FEMData->GetSolverType() == SolverTypes::PCG
+			      ? "     ESTIMATED OPERATIONS PER ITERATION  . . . . . . . . = "
+			      : "     ESTIMATED OPERATIONS OF THE FACTORIZATION . . . . . = ")
+			  << FEMData->GetEstimatedFlops() << endl
+			  << endl;
+	}
+
+	if (FEMData->GetNCEQ())
+		*this << "     NUMBER OF CONDENSED EQUATIONS OF INTERNAL NODES . . = " << FEMData->GetNCEQ()
+			  << endl
+			  << endl;
+
+	if (FEMData->GetOutOfCoreBudget())
+		*this << "     SKYLINE MATRIX KEPT OUT OF CORE, ENTRIES IN MEMORY  = " << FEMData->GetOutOfCoreBudget()
+			  << endl
+			  << endl;
+
+	if (FEMData->IsInputOrderKept())
+		*this << "     EQUATIONS KEPT IN INPUT ORDER (RENUMBERING DOES NOT REDUCE THE PROFILE)" << endl
+			  << "     SKYLINE PROFILE . . . . . . . . . . . . . . . . . . = " << FEMData->GetInputProfile() << endl
+			  << endl;
+	else if (FEMData->GetNodeOrdering() != OrderingTypes::Input)
+	{
+		*this << "     EQUATIONS RENUMBERED BY "
+			  << (FEMData->GetNodeOrdering() == OrderingTypes::RCM ? "REVERSE CUTHILL-MCKEE" : "SLOAN")
+			  << endl
+			  << "     SKYLINE PROFILE . . . . . . BEFORE = " << setw(12) << FEMData->GetInputProfile()
+			  << ",  AFTER = " << setw(12) << FEMData->GetOrderedProfile() << endl
+			  << "     MAXIMUM HALF BANDWIDTH  . . BEFORE = " << setw(12) << FEMData->GetInputBandwidth()
+			  << ",  AFTER = " << setw(12) << FEMData->GetOrderedBandwidth() << endl
+			  << endl;
+	}
+
+	if (FEMData->GetSolverType() == SolverTypes::Sparse)
+	{
+		const OrderingTypes Ordering = FEMData->GetSparseOrdering();
+		*this << "     FILL-REDUCING ORDERING  . . . . . . . . . . . . . . = "
+			  << (Ordering == OrderingTypes::AMD ? "APPROXIMATE MINIMUM DEGREE"
+			      : Ordering == OrderingTypes::ND ? "NESTED DISSECTION" : "NATURAL") << endl
+			  << "     PREDICTED ENTRIES OF FACTOR . . . . . . . . . . . . = "
+			  << FEMData->GetPredictedFill() << endl
+			  << "     PREDICTED FLOATING POINT OPERATIONS . . . . . . . . = "
+			  << FEMData->GetPredictedFlops() << endl
+			  << endl;
+	}
+
+	*this << endl;
 }
 
 
@@ -1092,10 +1185,10 @@ void COutputter::PrintColumnHeights()
 
 	CDomain* FEMData = CDomain::Instance();
 
-	unsigned int NEQ = FEMData->GetNEQ();
-	unsigned int* ColumnHeights = FEMData->GetStiffnessMatrix().GetColumnHeights();
+	Index_t NEQ = FEMData->GetNEQ();
+	Index_t* ColumnHeights = FEMData->GetStiffnessMatrix().GetColumnHeights();
 
-	for (unsigned int col = 0; col < NEQ; col++)
+	for (Index_t col = 0; col < NEQ; col++)
 	{
 		if (col + 1 % 10 == 0)
 		{
@@ -1116,10 +1209,10 @@ void COutputter::PrintDiagonalAddress()
 
 	CDomain* FEMData = CDomain::Instance();
 
-	unsigned int NEQ = FEMData->GetNEQ();
-	unsigned int* DiagonalAddress = FEMData->GetStiffnessMatrix().GetDiagonalAddress();
+	Index_t NEQ = FEMData->GetNEQ();
+	Index_t* DiagonalAddress = FEMData->GetStiffnessMatrix().GetDiagonalAddress();
 
-	for (unsigned int col = 0; col <= NEQ; col++)
+	for (Index_t col = 0; col <= NEQ; col++)
 	{
 		if (col + 1 % 10 == 0)
 		{
@@ -1136,21 +1229,24 @@ void COutputter::PrintDiagonalAddress()
 //	Print banded and full stiffness matrix for debuging
 void COutputter::PrintStiffnessMatrix()
 {
-#ifdef MKL
-	*this << "*** _Debug_ *** CSR stiffness matrix" << std::endl;
-	*this << CDomain::Instance()->GetCSRStiffnessMatrix() << std::endl;
-#else
-	*this << "*** _Debug_ *** Banded stiffness matrix" << endl;
-
 	CDomain* FEMData = CDomain::Instance();
 
-	unsigned int NEQ = FEMData->GetNEQ();
+	if (FEMData->GetSolverType() != SolverTypes::LDLT)
+	{
+		*this << "*** _Debug_ *** CSR stiffness matrix" << std::endl;
+		*this << FEMData->GetCSRStiffnessMatrix() << std::endl;
+		return;
+	}
+
+	*this << "*** _Debug_ *** Banded stiffness matrix" << endl;
+
+	Index_t NEQ = FEMData->GetNEQ();
 	CSkylineMatrix<double>& StiffnessMatrix = FEMData->GetStiffnessMatrix();
-	unsigned int* DiagonalAddress = StiffnessMatrix.GetDiagonalAddress();
+	Index_t* DiagonalAddress = StiffnessMatrix.GetDiagonalAddress();
 
 	*this << setiosflags(ios::scientific) << setprecision(5);
 
-	for (unsigned int i = 0; i < DiagonalAddress[NEQ] - DiagonalAddress[0]; i++)
+	for (Index_t i = 0; i < DiagonalAddress[NEQ] - DiagonalAddress[0]; i++)
 	{
 		*this << setw(14) << StiffnessMatrix(i);
 
@@ -1165,9 +1261,9 @@ void COutputter::PrintStiffnessMatrix()
 
 	*this << "*** _Debug_ *** Full stiffness matrix" << endl;
 
-	for (unsigned I = 1; I <= NEQ; I++)
+	for (Index_t I = 1; I <= NEQ; I++)
 	{
-		for (unsigned J = 1; J <= NEQ; J++)
+		for (Index_t J = 1; J <= NEQ; J++)
 		{
             int i, j;
             i = std::min(I, J);
@@ -1185,24 +1281,45 @@ void COutputter::PrintStiffnessMatrix()
 
 		*this << endl;
 	}
-#endif
+
 	*this << endl;
 }
 
 #ifdef _VIB_
 void COutputter::PrintMassMatrix()
 {
-	*this << "*** _Debug_ *** Banded mass matrix" << endl;
-
 	CDomain* FEMData = CDomain::Instance();
 
-	unsigned int NEQ = FEMData->GetNEQ();
+	Index_t NEQ = FEMData->GetNEQ();
+
+	if (double* LumpedMass = FEMData->GetLumpedMass())
+	{
+		*this << "*** _Debug_ *** Lumped mass matrix" << endl;
+
+		*this << setiosflags(ios::scientific) << setprecision(5);
+
+		for (Index_t i = 0; i < NEQ; i++)
+		{
+			*this << setw(14) << LumpedMass[i];
+
+			if ((i + 1) % 6 == 0)
+				*this << endl;
+		}
+
+		*this << endl
+			  << endl;
+
+		return;
+	}
+
+	*this << "*** _Debug_ *** Banded mass matrix" << endl;
+
 	CSkylineMatrix<double>& MassMatrix = FEMData->GetMassMatrix();
-	unsigned int* DiagonalAddress = MassMatrix.GetDiagonalAddress();
+	Index_t* DiagonalAddress = MassMatrix.GetDiagonalAddress();
 
 	*this << setiosflags(ios::scientific) << setprecision(5);
 
-	for (unsigned int i = 0; i < DiagonalAddress[NEQ] - DiagonalAddress[0]; i++)
+	for (Index_t i = 0; i < DiagonalAddress[NEQ] - DiagonalAddress[0]; i++)
 	{
 		*this << setw(14) << MassMatrix(i);
 
@@ -1217,9 +1334,9 @@ void COutputter::PrintMassMatrix()
 
 	*this << "*** _Debug_ *** Full mass matrix" << endl;
 
-	for (unsigned I = 1; I <= NEQ; I++)
+	for (Index_t I = 1; I <= NEQ; I++)
 	{
-		for (unsigned J = 1; J <= NEQ; J++)
+		for (Index_t J = 1; J <= NEQ; J++)
 		{
             int i, j;
             i = std::min(I, J);
@@ -1248,14 +1365,14 @@ void COutputter::PrintDisplacement(unsigned int loadcase)
 
 	CDomain* FEMData = CDomain::Instance();
 
-	unsigned int NEQ = FEMData->GetNEQ();
-	double* Force = FEMData->GetForce();
+	Index_t NEQ = FEMData->GetNEQ();
+	double* Force = FEMData->GetForce(loadcase);
 
 	*this << "  Load case = " << loadcase << endl;
 
 	*this << setiosflags(ios::scientific) << setprecision(5);
 
-	for (unsigned int i = 0; i < NEQ; i++)
+	for (Index_t i = 0; i < NEQ; i++)
 	{
 		if ((i + 1) % 6 == 0)
 		{
@@ -1286,7 +1403,7 @@ void COutputter::OutputVibDisps()
 	CDomain* FEMData = CDomain::Instance();
 
 	unsigned int vibn = FEMData->GetNumEig();
-	unsigned int NEQ = FEMData->GetNEQ();
+	Index_t NEQ = FEMData->GetNEQ();
 	double* lam = FEMData->GetEigenValues();
 	double* vibdisp = FEMData->GetVibDisp();
 	CNode* Nodelist = FEMData->GetNodeList();
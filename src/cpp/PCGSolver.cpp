@@ -0,0 +1,263 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#include "PCGSolver.h"
+#include "Eigen/Dense"
+
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+using namespace Eigen;
+
+//  Jacobi preconditioner
+CJacobiPreconditioner::CJacobiPreconditioner(CSRMatrix<double>& K) : InvDiagonal(K.size)
+{
+    for (CSRIndex_t row = 0; row < K.size; row++)
+        InvDiagonal[row] = 1.0 / K.values[K.rowIndexs[row] - 1];   // diagonal is the first entry of a row
+}
+
+CJacobiPreconditioner::CJacobiPreconditioner(const vector<double>& Diagonal)
+    : InvDiagonal(Diagonal.size())
+{
+    for (size_t i = 0; i < Diagonal.size(); i++)
+        InvDiagonal[i] = 1.0 / Diagonal[i];
+}
+
+void CJacobiPreconditioner::Apply(const double* r, double* z)
+{
+    for (size_t i = 0; i < InvDiagonal.size(); i++)
+        z[i] = InvDiagonal[i] * r[i];
+}
+
+//  Block Jacobi preconditioner
+CBlockJacobiPreconditioner::CBlockJacobiPreconditioner(CSRMatrix<double>& K,
+                                                       const vector<int>& _BlockStart,
+                                                       const vector<int>& _BlockIndex)
+    : BlockStart(_BlockStart), BlockIndex(_BlockIndex)
+{
+    // Equations left out of the blocks become blocks of their own
+    vector<bool> Listed(K.size, false);
+    for (int eq : BlockIndex)
+        Listed[eq] = true;
+
+    if (BlockStart.empty())
+        BlockStart.push_back(0);
+
+    for (int eq = 0; eq < K.size; eq++)
+        if (!Listed[eq])
+        {
+            BlockIndex.push_back(eq);
+            BlockStart.push_back(int(BlockIndex.size()));
+        }
+
+    const size_t NumBlocks = BlockStart.size() - 1;
+
+    InvStart.assign(NumBlocks + 1, 0);
+    for (size_t b = 0; b < NumBlocks; b++)
+    {
+        const size_t n = BlockStart[b + 1] - BlockStart[b];
+        InvStart[b + 1] = InvStart[b] + n * n;
+    }
+
+    InvBlocks.resize(InvStart[NumBlocks]);
+
+    for (size_t b = 0; b < NumBlocks; b++)
+    {
+        const int n = BlockStart[b + 1] - BlockStart[b];
+        const int* eq = &BlockIndex[BlockStart[b]];
+
+        MatrixXd B(n, n);
+        for (int i = 0; i < n; i++)
+            for (int j = 0; j < n; j++)
+                B(i, j) = K(eq[i] + 1, eq[j] + 1);
+
+        Map<MatrixXd>(&InvBlocks[InvStart[b]], n, n) = B.llt().solve(MatrixXd::Identity(n, n));
+    }
+}
+
+void CBlockJacobiPreconditioner::Apply(const double* r, double* z)
+{
+    const size_t NumBlocks = BlockStart.size() - 1;
+
+    for (size_t b = 0; b < NumBlocks; b++)
+    {
+        const int n = BlockStart[b + 1] - BlockStart[b];
+        const int* eq = &BlockIndex[BlockStart[b]];
+        const double* Inv = &InvBlocks[InvStart[b]];
+
+        for (int i = 0; i < n; i++)
+        {
+            double sum = 0.0;
+            for (int j = 0; j < n; j++)
+                sum += Inv[j * n + i] * r[eq[j]];
+            z[eq[i]] = sum;
+        }
+    }
+}
+
+//  IC(0) preconditioner
+CIC0Preconditioner::CIC0Preconditioner(CSRMatrix<double>& _K) : K(_K), U(_K.elementCount)
+{
+    Shift = 0.0;
+    while (!Factorize(Shift))
+        Shift = Shift ? 2.0 * Shift : 1.0e-3;
+
+    if (Shift)
+        cerr << "*** Warning *** IC(0) factorization shifted by " << Shift << " * diag(K)" << endl;
+}
+
+//  Right looking incomplete factorization K + alpha*diag(K) = U^T*U on the pattern of K,
+//  where the diagonal is the first entry of each row
+bool CIC0Preconditioner::Factorize(double alpha)
+{
+    const CSRIndex_t N = K.size;
+    const CSRIndex_t* rows = K.rowIndexs;
+    const CSRIndex_t* cols = K.columns;
+
+    for (CSRIndex_t p = 0; p < K.elementCount; p++)
+        U[p] = K.values[p];
+    for (CSRIndex_t k = 0; k < N; k++)
+        U[rows[k] - 1] *= 1.0 + alpha;
+
+    vector<CSRIndex_t> Position(N, -1);
+
+    for (CSRIndex_t k = 0; k < N; k++)
+    {
+        const CSRIndex_t pk0 = rows[k] - 1;
+        const CSRIndex_t pk1 = rows[k + 1] - 1;
+
+        if (U[pk0] <= DBL_MIN)
+            return false;
+
+        const double ukk = sqrt(U[pk0]);
+        U[pk0] = ukk;
+        for (CSRIndex_t p = pk0 + 1; p < pk1; p++)
+            U[p] /= ukk;
+
+        // U(j,l) -= U(k,j)*U(k,l) for the entries (j,l) in the pattern
+        for (CSRIndex_t p = pk0 + 1; p < pk1; p++)
+        {
+            const CSRIndex_t j = cols[p] - 1;
+            for (CSRIndex_t q = rows[j] - 1; q < rows[j + 1] - 1; q++)
+                Position[cols[q] - 1] = q;
+
+            for (CSRIndex_t q = p; q < pk1; q++)
+            {
+                const CSRIndex_t pos = Position[cols[q] - 1];
+                if (pos >= 0)
+                    U[pos] -= U[p] * U[q];
+            }
+
+            for (CSRIndex_t q = rows[j] - 1; q < rows[j + 1] - 1; q++)
+                Position[cols[q] - 1] = -1;
+        }
+    }
+
+    return true;
+}
+
+void CIC0Preconditioner::Apply(const double* r, double* z)
+{
+    const CSRIndex_t N = K.size;
+    const CSRIndex_t* rows = K.rowIndexs;
+    const CSRIndex_t* cols = K.columns;
+
+    for (CSRIndex_t i = 0; i < N; i++)
+        z[i] = r[i];
+
+    // U^T y = r
+    for (CSRIndex_t k = 0; k < N; k++)
+    {
+        z[k] /= U[rows[k] - 1];
+        for (CSRIndex_t p = rows[k]; p < rows[k + 1] - 1; p++)
+            z[cols[p] - 1] -= U[p] * z[k];
+    }
+
+    // U z = y
+    for (CSRIndex_t k = N - 1; k >= 0; k--)
+    {
+        double sum = z[k];
+        for (CSRIndex_t p = rows[k]; p < rows[k + 1] - 1; p++)
+            sum -= U[p] * z[cols[p] - 1];
+        z[k] = sum / U[rows[k] - 1];
+    }
+}
+
+//  Preconditioned conjugate gradient iteration from a zero initial guess
+bool CPCGSolver::Solve(double* Force)
+{
+    vector<double> x(N, 0.0), r(Force, Force + N), z(N), p(N), q(N);
+
+    double norm_b = 0.0;
+    for (Index_t i = 0; i < N; i++)
+        norm_b += r[i] * r[i];
+    norm_b = sqrt(norm_b);
+
+    Iterations = 0;
+    Residual = 0.0;
+
+    if (norm_b == 0.0)
+    {
+        for (Index_t i = 0; i < N; i++)
+            Force[i] = 0.0;
+        return true;
+    }
+
+    M->Apply(r.data(), z.data());
+    p = z;
+
+    double rz = 0.0;
+    for (Index_t i = 0; i < N; i++)
+        rz += r[i] * z[i];
+
+    Residual = 1.0;
+    while (Iterations < MaxIterations)
+    {
+        Multiply(p.data(), q.data());
+
+        double pq = 0.0;
+        for (Index_t i = 0; i < N; i++)
+            pq += p[i] * q[i];
+
+        const double alpha = rz / pq;
+
+        double rr = 0.0;
+        for (Index_t i = 0; i < N; i++)
+        {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * q[i];
+            rr += r[i] * r[i];
+        }
+
+        Iterations++;
+        Residual = sqrt(rr) / norm_b;
+        if (Residual <= Tolerance)
+            break;
+
+        M->Apply(r.data(), z.data());
+
+        double rz_new = 0.0;
+        for (Index_t i = 0; i < N; i++)
+            rz_new += r[i] * z[i];
+
+        const double beta = rz_new / rz;
+        rz = rz_new;
+
+        for (Index_t i = 0; i < N; i++)
+            p[i] = z[i] + beta * p[i];
+    }
+
+    for (Index_t i = 0; i < N; i++)
+        Force[i] = x[i];
+
+    return Residual <= Tolerance;
+}
@@ -36,7 +36,8 @@ void PostOutputter::OutputElementStress()
 
     CDomain* FEMData = CDomain::Instance();
 
-    double* Displacement = FEMData->GetDisplacement();
+    // Displacements of the last load case
+    double* Displacement = FEMData->GetDisplacement(FEMData->GetNLCASE() - 1);
 
     const unsigned int NUMEG = FEMData->GetNUMEG(); // Number of element groups
 
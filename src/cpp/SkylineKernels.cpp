@@ -0,0 +1,418 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#include "SkylineKernels.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_DISPATCH
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+//  Plain loops
+template <class T>
+static T DotScalar(const T* a, const T* b, size_t n)
+{
+    T sum = 0;
+    for (size_t k = 0; k < n; k++)
+        sum += a[k] * b[k];
+
+    return sum;
+}
+
+static double ReverseDotScalar(const double* a, const double* b, size_t n)
+{
+    double sum = 0.0;
+    for (size_t k = 0; k < n; k++)
+        sum += a[k] * b[n - 1 - k];
+
+    return sum;
+}
+
+static void ReverseAxpyScalar(double* y, double alpha, const double* x, size_t n)
+{
+    for (size_t k = 0; k < n; k++)
+        y[k] -= alpha * x[n - 1 - k];
+}
+
+static double SparseRowScalar(const double* a, const CSRIndex_t* index, size_t n, const double* x, double* y,
+                              CSRIndex_t offset, double alpha)
+{
+    double sum = 0.0;
+    for (size_t k = 0; k < n; k++)
+    {
+        const CSRIndex_t c = index[k] - 1;
+        sum += a[k] * x[c];
+        y[c - offset] += alpha * a[k];
+    }
+
+    return sum;
+}
+
+#ifdef SIMD_DISPATCH
+
+//  SSE2: two accumulators of 2 doubles (4 floats), scalar tail
+__attribute__((target("sse2"))) static double DotSSE2(const double* a, const double* b, size_t n)
+{
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4)
+    {
+        s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a + k), _mm_loadu_pd(b + k)));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(a + k + 2), _mm_loadu_pd(b + k + 2)));
+    }
+
+    double s[2];
+    _mm_storeu_pd(s, _mm_add_pd(s0, s1));
+    double sum = s[0] + s[1];
+    for (; k < n; k++)
+        sum += a[k] * b[k];
+
+    return sum;
+}
+
+__attribute__((target("sse2"))) static float DotFloatSSE2(const float* a, const float* b, size_t n)
+{
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8)
+    {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(a + k), _mm_loadu_ps(b + k)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(a + k + 4), _mm_loadu_ps(b + k + 4)));
+    }
+
+    float s[4];
+    _mm_storeu_ps(s, _mm_add_ps(s0, s1));
+    float sum = (s[0] + s[1]) + (s[2] + s[3]);
+    for (; k < n; k++)
+        sum += a[k] * b[k];
+
+    return sum;
+}
+
+//  b is read backwards two entries at a time, swapping them in the register
+__attribute__((target("sse2"))) static double ReverseDotSSE2(const double* a, const double* b, size_t n)
+{
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd();
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4)
+    {
+        const __m128d b0 = _mm_loadu_pd(b + n - k - 2);
+        const __m128d b1 = _mm_loadu_pd(b + n - k - 4);
+        s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a + k), _mm_shuffle_pd(b0, b0, 1)));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(a + k + 2), _mm_shuffle_pd(b1, b1, 1)));
+    }
+
+    double s[2];
+    _mm_storeu_pd(s, _mm_add_pd(s0, s1));
+    double sum = s[0] + s[1];
+    for (; k < n; k++)
+        sum += a[k] * b[n - 1 - k];
+
+    return sum;
+}
+
+__attribute__((target("sse2"))) static void ReverseAxpySSE2(double* y, double alpha, const double* x, size_t n)
+{
+    const __m128d va = _mm_set1_pd(alpha);
+    size_t k = 0;
+    for (; k + 2 <= n; k += 2)
+    {
+        const __m128d xk = _mm_loadu_pd(x + n - k - 2);
+        _mm_storeu_pd(y + k, _mm_sub_pd(_mm_loadu_pd(y + k), _mm_mul_pd(va, _mm_shuffle_pd(xk, xk, 1))));
+    }
+
+    for (; k < n; k++)
+        y[k] -= alpha * x[n - 1 - k];
+}
+
+//  AVX2: two accumulators of 4 doubles (8 floats) with fused multiply-add, scalar tail
+__attribute__((target("avx2,fma"))) static double HorizontalSum(__m256d v)
+{
+    const __m128d h = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+}
+
+__attribute__((target("avx2,fma"))) static float HorizontalSum(__m256 v)
+{
+    __m128 h = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    h = _mm_add_ps(h, _mm_movehl_ps(h, h));
+    return _mm_cvtss_f32(_mm_add_ss(h, _mm_shuffle_ps(h, h, 1)));
+}
+
+__attribute__((target("avx2,fma"))) static double DotAVX2(const double* a, const double* b, size_t n)
+{
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8)
+    {
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + k), _mm256_loadu_pd(b + k), s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + k + 4), _mm256_loadu_pd(b + k + 4), s1);
+    }
+
+    double sum = HorizontalSum(_mm256_add_pd(s0, s1));
+    for (; k < n; k++)
+        sum += a[k] * b[k];
+
+    return sum;
+}
+
+__attribute__((target("avx2,fma"))) static float DotFloatAVX2(const float* a, const float* b, size_t n)
+{
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    size_t k = 0;
+    for (; k + 16 <= n; k += 16)
+    {
+        s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + k), _mm256_loadu_ps(b + k), s0);
+        s1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + k + 8), _mm256_loadu_ps(b + k + 8), s1);
+    }
+
+    float sum = HorizontalSum(_mm256_add_ps(s0, s1));
+    for (; k < n; k++)
+        sum += a[k] * b[k];
+
+    return sum;
+}
+
+__attribute__((target("avx2,fma"))) static double ReverseDotAVX2(const double* a, const double* b, size_t n)
+{
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8)
+    {
+        const __m256d b0 = _mm256_permute4x64_pd(_mm256_loadu_pd(b + n - k - 4), 0x1B);
+        const __m256d b1 = _mm256_permute4x64_pd(_mm256_loadu_pd(b + n - k - 8), 0x1B);
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + k), b0, s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + k + 4), b1, s1);
+    }
+
+    double sum = HorizontalSum(_mm256_add_pd(s0, s1));
+    for (; k < n; k++)
+        sum += a[k] * b[n - 1 - k];
+
+    return sum;
+}
+
+__attribute__((target("avx2,fma"))) static void ReverseAxpyAVX2(double* y, double alpha, const double* x, size_t n)
+{
+    const __m256d va = _mm256_set1_pd(alpha);
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4)
+    {
+        const __m256d xk = _mm256_permute4x64_pd(_mm256_loadu_pd(x + n - k - 4), 0x1B);
+        _mm256_storeu_pd(y + k, _mm256_fnmadd_pd(va, xk, _mm256_loadu_pd(y + k)));
+    }
+
+    for (; k < n; k++)
+        y[k] -= alpha * x[n - 1 - k];
+}
+
+//  The entries of x are loaded one by one, the gathers being slower than the scalar loads on
+//  the rows of a few dozen entries of the stiffness matrices; the products are vectorized
+__attribute__((target("avx2,fma"))) static double SparseRowAVX2(const double* a, const CSRIndex_t* index, size_t n,
+                                                                const double* x, double* y, CSRIndex_t offset,
+                                                                double alpha)
+{
+    const __m256d va = _mm256_set1_pd(alpha);
+    __m256d s = _mm256_setzero_pd();
+    double t[4];
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4)
+    {
+        const CSRIndex_t c0 = index[k] - 1, c1 = index[k + 1] - 1, c2 = index[k + 2] - 1, c3 = index[k + 3] - 1;
+        const __m256d ak = _mm256_loadu_pd(a + k);
+        s = _mm256_fmadd_pd(ak, _mm256_set_pd(x[c3], x[c2], x[c1], x[c0]), s);
+
+        _mm256_storeu_pd(t, _mm256_mul_pd(va, ak));
+        y[c0 - offset] += t[0];
+        y[c1 - offset] += t[1];
+        y[c2 - offset] += t[2];
+        y[c3 - offset] += t[3];
+    }
+
+    double sum = HorizontalSum(s);
+    for (; k < n; k++)
+    {
+        const CSRIndex_t c = index[k] - 1;
+        sum += a[k] * x[c];
+        y[c - offset] += alpha * a[k];
+    }
+
+    return sum;
+}
+
+//  AVX-512: one accumulator of 8 doubles (16 floats), the tail is loaded with a mask. The sums
+//  add the two halves and finish as in AVX2, in the order of _mm512_reduce_add_pd/ps, whose
+//  unmasked extracts read an undefined register; the masked extracts and permutes below start
+//  from a zeroed one
+__attribute__((target("avx512f"))) static double HorizontalSum(__m512d v)
+{
+    const __m256d s = _mm256_add_pd(_mm512_maskz_extractf64x4_pd(0xFF, v, 1),
+                                    _mm512_maskz_extractf64x4_pd(0xFF, v, 0));
+    const __m128d h = _mm_add_pd(_mm256_castpd256_pd128(s), _mm256_extractf128_pd(s, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+}
+
+__attribute__((target("avx512f"))) static float HorizontalSum(__m512 v)
+{
+    const __m512d d = _mm512_castps_pd(v);
+    const __m256 s = _mm256_add_ps(_mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xFF, d, 1)),
+                                   _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0xFF, d, 0)));
+    __m128 h = _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1));
+    h = _mm_add_ps(h, _mm_movehl_ps(h, h));
+    return _mm_cvtss_f32(_mm_add_ss(h, _mm_shuffle_ps(h, h, 1)));
+}
+
+__attribute__((target("avx512f"))) static double DotAVX512(const double* a, const double* b, size_t n)
+{
+    __m512d s = _mm512_setzero_pd();
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8)
+        s = _mm512_fmadd_pd(_mm512_loadu_pd(a + k), _mm512_loadu_pd(b + k), s);
+
+    if (k < n)
+    {
+        const __mmask8 m = (__mmask8)((1u << (n - k)) - 1);
+        s = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, a + k), _mm512_maskz_loadu_pd(m, b + k), s);
+    }
+
+    return HorizontalSum(s);
+}
+
+__attribute__((target("avx512f"))) static float DotFloatAVX512(const float* a, const float* b, size_t n)
+{
+    __m512 s = _mm512_setzero_ps();
+    size_t k = 0;
+    for (; k + 16 <= n; k += 16)
+        s = _mm512_fmadd_ps(_mm512_loadu_ps(a + k), _mm512_loadu_ps(b + k), s);
+
+    if (k < n)
+    {
+        const __mmask16 m = (__mmask16)((1u << (n - k)) - 1);
+        s = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, a + k), _mm512_maskz_loadu_ps(m, b + k), s);
+    }
+
+    return HorizontalSum(s);
+}
+
+//  The tail of b, b[0:r-1], is loaded with a mask and reversed into the first r lanes
+__attribute__((target("avx512f"))) static double ReverseDotAVX512(const double* a, const double* b, size_t n)
+{
+    const __m512i Reverse = _mm512_set_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+    __m512d s = _mm512_setzero_pd();
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8)
+        s = _mm512_fmadd_pd(_mm512_loadu_pd(a + k),
+                            _mm512_maskz_permutexvar_pd(0xFF, Reverse, _mm512_loadu_pd(b + n - k - 8)), s);
+
+    if (k < n)
+    {
+        const long long r = n - k;
+        const __mmask8 m = (__mmask8)((1u << r) - 1);
+
+        // Lane i takes b[r-1-i]; the lanes i >= r take lanes r:7, which are zero
+        const __m512i Tail = _mm512_sub_epi64(_mm512_set1_epi64(r - 1), _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0));
+        const __m512d bk = _mm512_maskz_permutexvar_pd(0xFF, Tail, _mm512_maskz_loadu_pd(m, b));
+        s = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, a + k), bk, s);
+    }
+
+    return HorizontalSum(s);
+}
+
+__attribute__((target("avx512f"))) static void ReverseAxpyAVX512(double* y, double alpha, const double* x, size_t n)
+{
+    const __m512i Reverse = _mm512_set_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m512d va = _mm512_set1_pd(alpha);
+    size_t k = 0;
+    for (; k + 8 <= n; k += 8)
+    {
+        const __m512d xk = _mm512_maskz_permutexvar_pd(0xFF, Reverse, _mm512_loadu_pd(x + n - k - 8));
+        _mm512_storeu_pd(y + k, _mm512_fnmadd_pd(va, xk, _mm512_loadu_pd(y + k)));
+    }
+
+    for (; k < n; k++)
+        y[k] -= alpha * x[n - 1 - k];
+}
+
+#endif
+
+//  Best instruction set supported by the CPU
+static SIMDLevels DetectSIMDLevel()
+{
+#ifdef SIMD_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return SIMDLevels::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return SIMDLevels::AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return SIMDLevels::SSE2;
+#endif
+    return SIMDLevels::Scalar;
+}
+
+static SIMDLevels CurrentLevel = SIMDLevels::Scalar;
+
+double (*SkylineDot)(const double*, const double*, size_t) = DotScalar<double>;
+float (*SkylineDotFloat)(const float*, const float*, size_t) = DotScalar<float>;
+double (*SkylineReverseDot)(const double*, const double*, size_t) = ReverseDotScalar;
+void (*SkylineReverseAxpy)(double*, double, const double*, size_t) = ReverseAxpyScalar;
+double (*SparseRowProduct)(const double*, const CSRIndex_t*, size_t, const double*, double*, CSRIndex_t,
+                          double) = SparseRowScalar;
+
+SIMDLevels GetSIMDLevel()
+{
+    return CurrentLevel;
+}
+
+void SetSIMDLevel(SIMDLevels Level)
+{
+    static const SIMDLevels Supported = DetectSIMDLevel();
+    if (Level > Supported)
+        Level = Supported;
+
+    CurrentLevel = Level;
+
+    SkylineDot = DotScalar<double>;
+    SkylineDotFloat = DotScalar<float>;
+    SkylineReverseDot = ReverseDotScalar;
+    SkylineReverseAxpy = ReverseAxpyScalar;
+    SparseRowProduct = SparseRowScalar;
+
+#ifdef SIMD_DISPATCH
+    if (Level == SIMDLevels::SSE2)
+    {
+        SkylineDot = DotSSE2;
+        SkylineDotFloat = DotFloatSSE2;
+        SkylineReverseDot = ReverseDotSSE2;
+        SkylineReverseAxpy = ReverseAxpySSE2;
+    }
+    else if (Level == SIMDLevels::AVX2)
+    {
+        SkylineDot = DotAVX2;
+        SkylineDotFloat = DotFloatAVX2;
+        SkylineReverseDot = ReverseDotAVX2;
+        SkylineReverseAxpy = ReverseAxpyAVX2;
+        SparseRowProduct = SparseRowAVX2;
+    }
+    else if (Level == SIMDLevels::AVX512)
+    {
+        SkylineDot = DotAVX512;
+        SkylineDotFloat = DotFloatAVX512;
+        SkylineReverseDot = ReverseDotAVX512;
+        SkylineReverseAxpy = ReverseAxpyAVX512;
+        SparseRowProduct = SparseRowAVX2;
+    }
+#endif
+}
+
+//  Select the kernels of the CPU before main() runs
+static const bool KernelsSelected = (SetSIMDLevel(SIMDLevels::AVX512), true);
@@ -9,11 +9,14 @@
 /*****************************************************************************/
 
 #include "Solver.h"
+#include "SkylineKernels.h"
 
 #include <cmath>
 #include <cfloat>
 #include <iostream>
 #include <algorithm>
+#include <thread>
+#include <vector>
 
 #ifdef MKL
 #include "mkl.h"
@@ -21,34 +24,47 @@
 
 using namespace std;
 
+//	Dot product of two column segments of the skyline storage:  sum(a[k]*b[k], k=1:n),
+//	by the vectorized kernel of the CPU, so that all the factorizations sum in the same order
+static inline double ColumnDot(const double* a, const double* b, Index_t n)
+{
+	return SkylineDot(a + 1, b + 1, n);
+}
+
+static inline float ColumnDot(const float* a, const float* b, Index_t n)
+{
+	return SkylineDotFloat(a + 1, b + 1, n);
+}
+
 // LDLT facterization
 void CLDLTSolver::LDLT()
 {
-	const unsigned int N = K.dim();
-    unsigned int* ColumnHeights = K.GetColumnHeights();   // Column Hights
+	const Index_t N = K.dim();
+    Index_t* ColumnHeights = K.GetColumnHeights();   // Column Hights
+	const Index_t* DiagonalAddress = K.GetDiagonalAddress();
+	double* data = K.GetData();
 
-	for (unsigned int j = 2; j <= N; j++)      // Loop for column 2:n (Numbering starting from 1)
+	for (Index_t j = 2; j <= N; j++)      // Loop for column 2:n (Numbering starting from 1)
 	{
         // Row number of the first non-zero element in column j (Numbering starting from 1)
-		const unsigned int mj = j - ColumnHeights[j-1];
+		const Index_t mj = j - ColumnHeights[j-1];
+		double* Colj = data + DiagonalAddress[j-1] - 1;	// Colj[j-r] = K(r,j)
         
-		for (unsigned int i = mj+1; i < j; i++)	// Loop for mj+1:j-1 (Numbering starting from 1)
+		for (Index_t i = mj+1; i < j; i++)	// Loop for mj+1:j-1 (Numbering starting from 1)
 		{
             // Row number of the first nonzero element in column i (Numbering starting from 1)
-			unsigned int mi = i - ColumnHeights[i-1];
+			const Index_t mi = i - ColumnHeights[i-1];
+			const double* Coli = data + DiagonalAddress[i-1] - 1;
 
-			double C = 0.0;
-			for (unsigned int r = max(mi, mj); r < i; r++)
-				C += K(r,i) * K(r,j);		// C += L_ri * U_rj
-
-			K(i,j) -= C;	// U_ij = K_ij - C
+			// U_ij = K_ij - sum(L_ri * U_rj, r=max(mi,mj):i-1)
+			Colj[j-i] -= ColumnDot(Coli, Colj + (j-i), i - max(mi, mj));
 		}
 
-		for (unsigned int r = mj; r < j; r++)	// Loop for mj:j-1 (column j)
+		for (Index_t r = mj; r < j; r++)	// Loop for mj:j-1 (column j)
 		{
-			double Lrj = K(r,j) / K(r,r);	// L_rj = U_rj / D_rr
-			K(j,j) -= Lrj * K(r,j);	// D_jj = K_jj - sum(L_rj*U_rj, r=mj:j-1)
-			K(r,j) = Lrj;
+			double Lrj = Colj[j-r] / K(r,r);	// L_rj = U_rj / D_rr
+			Colj[0] -= Lrj * Colj[j-r];	// D_jj = K_jj - sum(L_rj*U_rj, r=mj:j-1)
+			Colj[j-r] = Lrj;
 		}
 
         if (fabs(K(j,j)) <= FLT_MIN)
@@ -62,139 +78,689 @@ void CLDLTSolver::LDLT()
     }
 };
 
+// Count the negative entries of D in the factor L*D*L(T)
+Index_t CLDLTSolver::NegativePivots()
+{
+	const Index_t N = K.dim();
+	Index_t Count = 0;
+
+	for (Index_t j = 1; j <= N; j++)
+		if (K(j,j) < 0.0)
+			Count++;
+
+	return Count;
+}
+
+// Reduce the columns p0:p1-1 (Numbering starting from 1) of the skyline matrix
+//	Column j is stored contiguously from its diagonal upwards, i.e. K(r,j) = Col(j)[j-r].
+//	For an out-of-core matrix, the columns mp:p1-1 must be in memory.
+//	If Flags is given, column i of the previous panels is waited for just before it is used.
+void CLDLTSolver::ReducePanel(Index_t p0, Index_t p1, CColumnFlags* Flags)
+{
+	const Index_t* ColumnHeights = K.GetColumnHeights();   // Column Hights
+	const Index_t* DiagonalAddress = K.GetDiagonalAddress();
+	double* data = K.GetData();
+	const size_t Offset = K.GetOffset();	// nonzero if only a window of the matrix is in memory
+
+	// Row number of the first non-zero element in the panel
+	Index_t mp = p0;
+	for (Index_t j = p0; j < p1; j++)
+		mp = min(mp, j - ColumnHeights[j-1]);
+
+	// D_mp,mp is used by the reduction of the panel below
+	if (Flags && mp < p0)
+		Flags->Wait(mp);
+
+	// Update the panel with the columns factored in the previous panels (mp+1:p0-1).
+	// Column i is loaded once and applied to all columns of the panel.
+	for (Index_t i = mp + 1; i < p0; i++)
+	{
+		if (Flags)
+			Flags->Wait(i);
+
+		const Index_t mi = i - ColumnHeights[i-1];
+		const double* Coli = data + (DiagonalAddress[i-1] - 1 - Offset);
+
+		for (Index_t j = p0; j < p1; j++)
+		{
+			const Index_t mj = j - ColumnHeights[j-1];
+			if (mj >= i)
+				continue;
+
+			double* Colj = data + (DiagonalAddress[j-1] - 1 - Offset);
+			Colj[j-i] -= ColumnDot(Coli, Colj + (j-i), i - max(mi, mj));	// U_ij = K_ij - sum(L_ri*U_rj)
+		}
+	}
+
+	// Reduce the columns within the panel in turn
+	for (Index_t j = p0; j < p1; j++)
+	{
+		const Index_t mj = j - ColumnHeights[j-1];
+		double* Colj = data + (DiagonalAddress[j-1] - 1 - Offset);
+
+		for (Index_t i = max(mj + 1, p0); i < j; i++)
+		{
+			const Index_t mi = i - ColumnHeights[i-1];
+			const double* Coli = data + (DiagonalAddress[i-1] - 1 - Offset);
+
+			Colj[j-i] -= ColumnDot(Coli, Colj + (j-i), i - max(mi, mj));
+		}
+
+		for (Index_t r = mj; r < j; r++)	// Loop for mj:j-1 (column j)
+		{
+			double Lrj = Colj[j-r] / data[DiagonalAddress[r-1] - 1 - Offset];	// L_rj = U_rj / D_rr
+			Colj[0] -= Lrj * Colj[j-r];	// D_jj = K_jj - sum(L_rj*U_rj, r=mj:j-1)
+			Colj[j-r] = Lrj;
+		}
+
+		if (fabs(Colj[0]) <= FLT_MIN)
+		{
+			cerr << "*** Error *** Stiffness matrix is not positive definite !" << endl
+				 << "    Euqation no = " << j << endl
+				 << "    Pivot = " << Colj[0] << endl;
+
+			exit(4);
+		}
+
+		if (Flags)
+			Flags->MarkFactored(j);
+	}
+
+	if (Flags)
+		Flags->Signal(p0);
+}
+
+// Blocked LDLT facterization
+void CLDLTSolver::BlockLDLT(unsigned int PanelSize)
+{
+	const Index_t N = K.dim();
+
+	if (PanelSize == 0)
+		PanelSize = 1;
+
+	for (Index_t p0 = 2; p0 <= N; p0 += PanelSize)	// Loop over panels p0:p1-1 (Numbering starting from 1)
+		ReducePanel(p0, min(p0 + PanelSize, N + 1), nullptr);
+};
+
+CColumnFlags::CColumnFlags(Index_t N, Index_t _PanelSize)
+	: Done(new atomic<bool>[N + 1]), Panels(new CPanel[N > 1 ? (N - 2) / _PanelSize + 1 : 1]),
+	  PanelSize(_PanelSize)
+{
+	for (Index_t i = 0; i <= N; i++)
+		Done[i].store(i == 1);
+}
+
+//	The flag is tested again under the lock of the panel, which Signal takes after the columns
+//	of the panel are marked, so no wake-up is lost
+void CColumnFlags::Wait(Index_t i)
+{
+	if (Done[i].load(memory_order_acquire))
+		return;
+
+	CPanel& Panel = PanelOf(i);
+	unique_lock<mutex> Lock(Panel.Mutex);
+	Panel.Factored.wait(Lock, [this, i]() { return Done[i].load(memory_order_acquire); });
+}
+
+void CColumnFlags::MarkFactored(Index_t i)
+{
+	Done[i].store(true, memory_order_release);
+}
+
+void CColumnFlags::Signal(Index_t p0)
+{
+	CPanel& Panel = PanelOf(p0);
+	lock_guard<mutex> Lock(Panel.Mutex);
+	Panel.Factored.notify_all();
+}
+
+// Multithreaded LDLT facterization
+//	Panels are handed out in increasing order. A panel applies the factored columns its skyline
+//	(given by ColumnHeights) reaches into one by one, and blocks on a column only when it comes to
+//	it. The updates by the columns factored earlier therefore run while the previous panels are
+//	still being reduced, and a panel only waits at the end of its update for the last columns.
+//	Each column is reduced by one thread in the same order as in LDLT(), so the factor does not
+//	depend on the number of threads.
+void CLDLTSolver::ParallelLDLT(unsigned int NumThreads, unsigned int PanelSize)
+{
+	const Index_t N = K.dim();
+
+	if (PanelSize == 0)
+		PanelSize = 1;
+
+	if (NumThreads == 0)
+		NumThreads = max(thread::hardware_concurrency(), 1u);
+
+	if (N < 2)
+		return;
+
+	const Index_t NumPanels = (N - 2) / PanelSize + 1;
+
+	CColumnFlags Flags(N, PanelSize);
+	atomic<Index_t> NextPanel(0);
+
+	auto Worker = [&]()
+	{
+		Index_t k;
+		while ((k = NextPanel.fetch_add(1)) < NumPanels)
+		{
+			const Index_t p0 = 2 + k * PanelSize;
+			ReducePanel(p0, min(p0 + PanelSize, N + 1), &Flags);
+		}
+	};
+
+	vector<thread> Pool;
+	for (unsigned int t = 1; t < NumThreads; t++)
+		Pool.push_back(thread(Worker));
+
+	Worker();
+
+	for (auto& t : Pool)
+		t.join();
+};
+
+// Out-of-core LDLT facterization
+//	Each panel is made as wide as the memory budget allows for the panel and the factored
+//	columns its skyline reaches into, which are read from the file (the columns kept from
+//	the previous panel are not read again). The reduced panel is written back to the file.
+void CLDLTSolver::OutOfCoreLDLT()
+{
+	const Index_t N = K.dim();
+	const Index_t* ColumnHeights = K.GetColumnHeights();
+	const size_t Budget = K.GetBudget();
+
+	for (Index_t p0 = 2, p1; p0 <= N; p0 = p1)
+	{
+		Index_t mp = p0 - ColumnHeights[p0-1];
+		for (p1 = p0 + 1; p1 <= N; p1++)
+		{
+			const Index_t m = min(mp, p1 - ColumnHeights[p1-1]);
+			if (K.ColumnsSize(m, p1 + 1) > Budget)
+				break;
+			mp = m;
+		}
+
+		K.LoadColumns(mp, p1);
+		ReducePanel(p0, p1, nullptr);
+		K.StoreColumns(p0, p1);
+	}
+}
+
+// Out-of-core reduction and back substitution of NRHS load vectors
+//	The factor is streamed forwards and then backwards in windows fitting the memory budget.
+//	The operations are those of BackSubstitution, in the same order.
+void CLDLTSolver::OutOfCoreSubstitution(double* Force, unsigned int NRHS)
+{
+	const Index_t N = K.dim();
+	const Index_t* ColumnHeights = K.GetColumnHeights();
+	const Index_t* DiagonalAddress = K.GetDiagonalAddress();
+	const size_t Budget = K.GetBudget();
+
+	std::vector<double> X((size_t)N * NRHS), D(N);
+	for (unsigned int r = 0; r < NRHS; r++)
+		for (Index_t i = 0; i < N; i++)
+			X[(size_t)i * NRHS + r] = Force[(size_t)r * N + i];
+
+	//	Reduce right-hand-side load vectors (LV = R)
+	for (Index_t c0 = 1, c1; c0 <= N; c0 = c1)
+	{
+		for (c1 = c0 + 1; c1 <= N && K.ColumnsSize(c0, c1 + 1) <= Budget; c1++)
+			;
+
+		K.LoadColumns(c0, c1);
+		const double* data = K.GetData();
+		const size_t Offset = K.GetOffset();
+
+		for (Index_t i = c0; i < c1; i++)
+		{
+			const Index_t mi = i - ColumnHeights[i-1];
+			const double* column = data + (DiagonalAddress[i-1] - 1 - Offset);	// column[i-j] = K(j,i)
+			double* Xi = &X[(size_t)(i-1) * NRHS];
+
+			D[i-1] = column[0];
+			for (Index_t j = mi; j < i; j++)
+			{
+				const double* Xj = &X[(size_t)(j-1) * NRHS];
+				for (unsigned int r = 0; r < NRHS; r++)
+					Xi[r] -= column[i-j] * Xj[r];
+			}
+		}
+	}
+
+	//	Back substitute (Vbar = D^(-1) V, L^T a = Vbar)
+	for (Index_t i = 1; i <= N; i++)
+		for (unsigned int r = 0; r < NRHS; r++)
+			X[(size_t)(i-1) * NRHS + r] /= D[i-1];
+
+	for (Index_t c1 = N + 1, c0; c1 > 2; c1 = c0)
+	{
+		for (c0 = c1 - 1; c0 > 2 && K.ColumnsSize(c0 - 1, c1) <= Budget; c0--)
+			;
+
+		K.LoadColumns(c0, c1);
+		const double* data = K.GetData();
+		const size_t Offset = K.GetOffset();
+
+		for (Index_t j = c1 - 1; j >= c0; j--)
+		{
+			const Index_t mj = j - ColumnHeights[j-1];
+			const double* column = data + (DiagonalAddress[j-1] - 1 - Offset);
+			const double* Xj = &X[(size_t)(j-1) * NRHS];
+
+			for (Index_t i = mj; i < j; i++)
+			{
+				double* Xi = &X[(size_t)(i-1) * NRHS];
+				for (unsigned int r = 0; r < NRHS; r++)
+					Xi[r] -= column[j-i] * Xj[r];
+			}
+		}
+	}
+
+	for (unsigned int r = 0; r < NRHS; r++)
+		for (Index_t i = 0; i < N; i++)
+			Force[(size_t)r * N + i] = X[(size_t)i * NRHS + r];
+}
+
+//	Equations reached by the nonzero loads in the forward reduction
+//	Row i of V = L^(-1) R is nonzero only if R_i is, or if V_j is for a row j in the skyline
+//	of column i. Following the first such column from every row (its parent) is enough:
+//	the rows j = mi:i-1 of column i lead to i through parents between j and i.
+Index_t CLDLTSolver::ForwardReach(const double* Force, unsigned int NRHS, vector<char>& Reached)
+{
+	const Index_t N = K.dim();
+	const Index_t* ColumnHeights = K.GetColumnHeights();
+
+	if (Parent.size() != N)
+	{
+		// Rows without a parent yet are kept on a stack in increasing order, so that column i
+		// adopts those from the top down to its first row mi
+		Parent.assign(N, 0);
+		vector<Index_t> Orphans;
+		for (Index_t i = 1; i <= N; i++)
+		{
+			const Index_t mi = i - ColumnHeights[i-1];
+			while (!Orphans.empty() && Orphans.back() >= mi)
+			{
+				Parent[Orphans.back() - 1] = i;
+				Orphans.pop_back();
+			}
+			Orphans.push_back(i);
+		}
+	}
+
+	Reached.assign(N, 0);
+	for (unsigned int r = 0; r < NRHS; r++)
+		for (Index_t i = 0; i < N; i++)
+			if (Force[(size_t)r * N + i] != 0.0)
+				Reached[i] = 1;
+
+	Index_t First = N + 1;
+	for (Index_t i = 1; i <= N; i++)
+		if (Reached[i-1])
+		{
+			First = min(First, i);
+			if (Parent[i-1])
+				Reached[Parent[i-1] - 1] = 1;
+		}
+
+	return First;
+}
+
 // Solve displacement by back substitution
 void CLDLTSolver::BackSubstitution(double* Force)
 {
-	const unsigned int N = K.dim();
-    const unsigned int* ColumnHeights = K.GetColumnHeights();   // Column Hights
+	if (K.IsOutOfCore())
+	{
+		OutOfCoreSubstitution(Force, 1);
+		return;
+	}
+
+	const Index_t N = K.dim();
+    const Index_t* ColumnHeights = K.GetColumnHeights();   // Column Hights
+
+	//	Rows above the first nonzero load, and rows no nonzero load reaches, stay zero
+	vector<char> Reached;
+	const Index_t First = ForwardReach(Force, 1, Reached);
 
 	//	Reduce right-hand-side load vector (LV = R)
-	for (unsigned int i = 2; i <= N; i++)	// Loop for i=2:N (Numering starting from 1)
+	for (Index_t i = First + 1; i <= N; i++)	// Loop for i=First+1:N (Numering starting from 1)
 	{
-        unsigned int mi = i - ColumnHeights[i-1];
+		if (!Reached[i-1])
+			continue;
+
+        const Index_t mi = max(i - ColumnHeights[i-1], First);
 
-		for (unsigned int j = mi; j < i; j++)	// Loop for j=mi:i-1
-			Force[i-1] -= K(j,i) * Force[j-1];	// V_i = R_i - sum_j (L_ji V_j)
+		// V_i = R_i - sum_j (L_ji V_j), j=mi:i-1, where K(j,i) is stored backwards from row i-1
+		Force[i-1] -= SkylineReverseDot(Force + mi - 1, &K(i,i) + 1, i - mi);
 	}
 
 	//	Back substitute (Vbar = D^(-1) V, L^T a = Vbar)
-	for (unsigned int i = 1; i <= N; i++)	// Loop for i=1:N
+	for (Index_t i = 1; i <= N; i++)	// Loop for i=1:N
 		Force[i-1] /= K(i,i);	// Vbar = D^(-1) V
 
-	for (unsigned int j = N; j >= 2; j--)	// Loop for j=N:2
+	for (Index_t j = N; j >= 2; j--)	// Loop for j=N:2
 	{
-        const unsigned int mj = j - ColumnHeights[j-1];
+        const Index_t mj = j - ColumnHeights[j-1];
 
-		for (unsigned int i = mj; i < j; i++)	// Loop for i=mj:j-1
-			Force[i-1] -= K(i,j) * Force[j-1];	// a_i = Vbar_i - sum_j(L_ij Vbar_j)
+		// a_i = Vbar_i - sum_j(L_ij Vbar_j), i=mj:j-1
+		SkylineReverseAxpy(Force + mj - 1, Force[j-1], &K(j,j) + 1, j - mj);
 	}
 };
 
+//	Reduce and back substitute NRHS right-hand-side load vectors at once
+void CLDLTSolver::BackSubstitution(double* Force, unsigned int NRHS)
+{
+	if (K.IsOutOfCore())
+	{
+		OutOfCoreSubstitution(Force, NRHS);
+		return;
+	}
+
+	const Index_t N = K.dim();
+	const Index_t* ColumnHeights = K.GetColumnHeights();
+	const Index_t* DiagonalAddress = K.GetDiagonalAddress();
+	const double* data = K.GetData();
+
+//	X(i,r) = X[(i-1)*NRHS + r] holds the load vectors row by row
+	std::vector<double> X((size_t)N * NRHS);
+	for (unsigned int r = 0; r < NRHS; r++)
+		for (Index_t i = 0; i < N; i++)
+			X[(size_t)i * NRHS + r] = Force[(size_t)r * N + i];
+
+	//	Rows above the first nonzero load, and rows no nonzero load reaches, stay zero
+	vector<char> Reached;
+	const Index_t First = ForwardReach(Force, NRHS, Reached);
+
+	//	Reduce right-hand-side load vectors (LV = R)
+	for (Index_t i = First + 1; i <= N; i++)
+	{
+		if (!Reached[i-1])
+			continue;
+
+		const Index_t mi = max(i - ColumnHeights[i-1], First);
+		const double* column = data + DiagonalAddress[i-1] - 1;	// column[i-j] = K(j,i)
+		double* Xi = &X[(size_t)(i-1) * NRHS];
+
+		for (Index_t j = mi; j < i; j++)
+		{
+			const double Lji = column[i-j];
+			const double* Xj = &X[(size_t)(j-1) * NRHS];
+			for (unsigned int r = 0; r < NRHS; r++)
+				Xi[r] -= Lji * Xj[r];
+		}
+	}
+
+	//	Back substitute (Vbar = D^(-1) V, L^T a = Vbar)
+	for (Index_t i = 1; i <= N; i++)
+	{
+		const double Dii = data[DiagonalAddress[i-1] - 1];
+		double* Xi = &X[(size_t)(i-1) * NRHS];
+		for (unsigned int r = 0; r < NRHS; r++)
+			Xi[r] /= Dii;
+	}
+
+	for (Index_t j = N; j >= 2; j--)
+	{
+		const Index_t mj = j - ColumnHeights[j-1];
+		const double* column = data + DiagonalAddress[j-1] - 1;
+		const double* Xj = &X[(size_t)(j-1) * NRHS];
+
+		for (Index_t i = mj; i < j; i++)
+		{
+			const double Lij = column[j-i];
+			double* Xi = &X[(size_t)(i-1) * NRHS];
+			for (unsigned int r = 0; r < NRHS; r++)
+				Xi[r] -= Lij * Xj[r];
+		}
+	}
+
+	for (unsigned int r = 0; r < NRHS; r++)
+		for (Index_t i = 0; i < N; i++)
+			Force[(size_t)r * N + i] = X[(size_t)i * NRHS + r];
+}
+
+// Single precision LDLT facterization of a copy of K (column by column, as in LDLT())
+void CMixedLDLTSolver::LDLT()
+{
+	const Index_t N = K.dim();
+	const Index_t* ColumnHeights = K.GetColumnHeights();
+	const Index_t* DiagonalAddress = K.GetDiagonalAddress();
+	const double* data = K.GetData();
+
+	Factor.assign(data, data + K.size());
+	DoubleFactor = false;
+
+	//	||K||_inf, summing the rows from the columns of the upper triangle
+	vector<double> RowSum(N, 0.0);
+	for (Index_t j = 1; j <= N; j++)
+	{
+		const double* Colj = data + DiagonalAddress[j-1] - 1;
+		RowSum[j-1] += fabs(Colj[0]);
+		for (Index_t r = j - ColumnHeights[j-1]; r < j; r++)
+		{
+			RowSum[r-1] += fabs(Colj[j-r]);
+			RowSum[j-1] += fabs(Colj[j-r]);
+		}
+	}
+	NormK = N ? *max_element(RowSum.begin(), RowSum.end()) : 0.0;
+
+	for (Index_t j = 1; j <= N; j++)
+	{
+		const Index_t mj = j - ColumnHeights[j-1];
+		float* Colj = &Factor[DiagonalAddress[j-1] - 1];
+
+		for (Index_t i = mj + 1; i < j; i++)
+		{
+			const Index_t mi = i - ColumnHeights[i-1];
+			const float* Coli = &Factor[DiagonalAddress[i-1] - 1];
+
+			Colj[j-i] -= ColumnDot(Coli, Colj + (j-i), i - max(mi, mj));	// U_ij = K_ij - sum(L_ri*U_rj)
+		}
+
+		for (Index_t r = mj; r < j; r++)
+		{
+			float Lrj = Colj[j-r] / Factor[DiagonalAddress[r-1] - 1];	// L_rj = U_rj / D_rr
+			Colj[0] -= Lrj * Colj[j-r];
+			Colj[j-r] = Lrj;
+		}
+
+		if (!(Colj[0] > FLT_MIN && Colj[0] <= FLT_MAX))
+		{
+			FallBack("single precision pivot breaks down");
+			return;
+		}
+	}
+}
+
+//	Forward reduction and back substitution with the single precision factor
+void CMixedLDLTSolver::FactorSolve(double* x) const
+{
+	const Index_t N = K.dim();
+	const Index_t* ColumnHeights = K.GetColumnHeights();
+	const Index_t* DiagonalAddress = K.GetDiagonalAddress();
+
+	for (Index_t i = 2; i <= N; i++)
+	{
+		const float* Coli = &Factor[DiagonalAddress[i-1] - 1];
+		double C = 0.0;
+		for (Index_t j = i - ColumnHeights[i-1]; j < i; j++)
+			C += Coli[i-j] * x[j-1];
+		x[i-1] -= C;
+	}
+
+	for (Index_t i = 1; i <= N; i++)
+		x[i-1] /= Factor[DiagonalAddress[i-1] - 1];
+
+	for (Index_t j = N; j >= 2; j--)
+	{
+		const float* Colj = &Factor[DiagonalAddress[j-1] - 1];
+		for (Index_t i = j - ColumnHeights[j-1]; i < j; i++)
+			x[i-1] -= Colj[j-i] * x[j-1];
+	}
+}
+
+//	Factorize K in double; the residuals can no longer be formed with K afterwards
+void CMixedLDLTSolver::FallBack(const char* Reason)
+{
+	cerr << "*** Warning *** Mixed precision LDLT: " << Reason
+		 << ", the stiffness matrix is factorized in double precision" << endl;
+
+	vector<float>().swap(Factor);
+	CLDLTSolver(K).LDLT();
+	DoubleFactor = true;
+}
+
+//	Iterative refinement of the solution with the single precision factor
+void CMixedLDLTSolver::Solve(double* Force)
+{
+	const Index_t N = K.dim();
+
+	Iterations = 0;
+	Residual = 0.0;
+
+	if (DoubleFactor)
+	{
+		CLDLTSolver(K).BackSubstitution(Force);
+		return;
+	}
+
+	vector<double> R(Force, Force + N), a(N, 0.0), r(R), Ka(N);
+
+	double NormR = 0.0;
+	for (Index_t i = 0; i < N; i++)
+		NormR += R[i] * R[i];
+	NormR = sqrt(NormR);
+
+	const double Criterion = NormK * DBL_EPSILON * sqrt(double(N));
+
+	for (;;)
+	{
+		//	a = a + (LDL^T)^(-1) r
+		FactorSolve(r.data());
+		for (Index_t i = 0; i < N; i++)
+			a[i] += r[i];
+
+		//	r = R - K a
+		K.Multiply(a.data(), Ka.data());
+
+		double NormA = 0.0, NormInf = 0.0, rr = 0.0;
+		for (Index_t i = 0; i < N; i++)
+		{
+			r[i] = R[i] - Ka[i];
+			NormA = max(NormA, fabs(a[i]));
+			NormInf = max(NormInf, fabs(r[i]));
+			rr += r[i] * r[i];
+		}
+		Residual = NormR > 0.0 ? sqrt(rr) / NormR : 0.0;
+
+		if (NormInf <= NormA * Criterion)
+			break;
+
+		if (++Iterations > MaxIterations)
+		{
+			FallBack("iterative refinement does not converge");
+			copy(R.begin(), R.end(), Force);
+			Solve(Force);
+			return;
+		}
+	}
+
+	copy(a.begin(), a.end(), Force);
+}
+
 #ifdef MKL
-void CSRSolver::solve(double* Force, unsigned NLCase)
+#ifdef _INDEX64_
+#define PARDISO pardiso_64	// 64-bit integer interface of PARDISO
+#else
+#define PARDISO pardiso
+#endif
+
+CSRSolver::CSRSolver(CSRMatrix<double>& _K) : CSolver(_K), K(_K), mtype(2), Done(0)
 {
-	void* pt[64];
     for (unsigned _ = 0; _ < 64; _++) pt[_] = 0;
-    
-    const int mtype = 2;
-    int iparm[64] = { 0 };
 
-    pardisoinit(pt, &mtype, iparm);
+    int iparm32[64] = { 0 };
+    const int mtype32 = 2;	// real symmetric positive definite
+    pardisoinit(pt, &mtype32, iparm32);
+
+    for (unsigned _ = 0; _ < 64; _++) iparm[_] = iparm32[_];
     iparm[1] = 2; // The parallel (OpenMP) version of the nested dissection algorithm.
 	iparm[5] = 1; // write back to Force
     iparm[59] = 1; // use OOC if needed
 
-    const int one = 1;
-    const int size = K.size;
-    double* values = K.values;
-    int* columns = K.columns;
-    int* rowIndexs = K.rowIndexs;
-
-    const int rhsCount = NLCase;
-    double* rhs = Force;
-
-    int phase = 13;
-    double* res = new double[rhsCount*size];
-    for (std::size_t _ = 0; _ < rhsCount*size; _++) res[_] = 0;
-
-    int msglvl = 0; // print info
+    msglvl = 0; // print info
 #if defined(_DEBUG_) || defined(_RUN_)
     msglvl = 1;
 #endif // _DEBUG_
-    int* perm = new int[size];
-    int error;
+}
 
-    pardiso(
-        pt, // handle to some shit
+CSRSolver::~CSRSolver()
+{
+    if (Done)
+        Call(-1);	// release all internal memory
+}
+
+//	Run one PARDISO phase with the persistent handle
+void CSRSolver::Call(CSRIndex_t phase, double* Force, CSRIndex_t NRHS)
+{
+    const CSRIndex_t one = 1;
+    const CSRIndex_t size = K.size;
+    CSRIndex_t idum;
+    CSRIndex_t error = 0;
+
+    vector<double> res(Force ? (size_t)NRHS * size : 0);
+    double ddum;
+
+    PARDISO(
+        pt, // handle kept between the phases
         &one, // maxfct
         &one, // mnum
         &mtype, // sym pos matrix
-        &phase, // go through all
+        &phase,
         &size,  // size of matrix
-        values,
-        rowIndexs,
-        columns,
-        perm, // idk wtf this is
-        &rhsCount,
-        iparm, // sort like settings
+        K.values,
+        K.rowIndexs,
+        K.columns,
+        &idum, // no user permutation
+        &NRHS,
+        iparm,
         &msglvl, // print info or not
-        rhs,
-        res,
+        Force ? Force : &ddum,
+        Force ? res.data() : &ddum,
         &error // see if any error
     );
     if (error)
     {
-        std::cerr << "ERROR IN PARDISO SOLVER: " << error << std::endl;
+        std::cerr << "ERROR IN PARDISO SOLVER (PHASE " << phase << "): " << error << std::endl;
         exit(8);
     }
-
-#ifdef _DEBUG_
-    for (int _ = 0; _<size; _++)
-        std::cout << "res[" << _ << "] = " << res[_] << std::endl;
-    for (int _ = 0; _<size; _++)
-        std::cout << "rhs[" << _ << "] = " << rhs[_] << std::endl;
-#endif // _DEBUG_
-    delete[] perm;
-    delete[] res;
 }
-#endif
 
-#ifdef _VIB_
-//! only to be used before LDLT() factorization
-void CLDLTSolver::Multiple(double* acc,double* force,unsigned int numeq,unsigned int vib_m){
-	unsigned int* diag = K.GetDiagonalAddress();
-    unsigned int* colh = K.GetColumnHeights();
-	unsigned int diag_sc=0;
-	unsigned int row_ck=0;
-
-	for (unsigned int i=0; i<numeq*vib_m; ++i){
-		force[i]=0.0;
-	}
-
-	for (unsigned int i=1; i<diag[numeq]; ++i){
-		
-			if (i==diag[diag_sc]){
-				for (unsigned int j=0; j<vib_m; ++j){
-				    force[j*numeq+diag_sc] += K(diag_sc+1,diag_sc+1)*acc[j*numeq+diag_sc];
-				}
-				
-				
-			}
-			else {
-				for (unsigned int j=0; j<vib_m; ++j){
-				    force[j*numeq+row_ck] += K(diag_sc+1,row_ck+1)*acc[j*numeq+diag_sc];
-				    force[j*numeq+diag_sc] += K(diag_sc+1,row_ck+1)*acc[j*numeq+row_ck];
-				}
+void CSRSolver::analyze()
+{
+    Call(11);
+    Done = 1;
+}
 
-			}
-		    if (diag_sc-row_ck < colh[diag_sc]) row_ck--;
-			else {
-				diag_sc++;
-				row_ck=diag_sc;
-			}
-		
-	}
+void CSRSolver::factorize()
+{
+    if (Done < 1)
+        analyze();
 
+    Call(22);
+    Done = 2;
 }
 
-#endif
\ No newline at end of file
+void CSRSolver::solve(double* Force, unsigned NRHS)
+{
+    if (Done < 2)
+        factorize();
+
+    Call(33, Force, NRHS);
+
+#ifdef _DEBUG_
+    for (int _ = 0; _ < K.size; _++)
+        std::cout << "rhs[" << _ << "] = " << Force[_] << std::endl;
+#endif // _DEBUG_
+}
+#endif
@@ -0,0 +1,368 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#include "SolverRegistry.h"
+#include "Domain.h"
+#include "SparseSolver.h"
+#include "EBESolver.h"
+#include "AMGPreconditioner.h"
+#include "Outputter.h"
+
+#include <iostream>
+
+using namespace std;
+
+void CSolution::Assemble()
+{
+    CDomain::Instance()->AssembleStiffnessMatrix();
+}
+
+//  Skyline LDLT solver, in core, out of core or read from the factor cache, solving all the load
+//  cases at once
+class CLDLTSolution : public CSolution
+{
+protected:
+    CLDLTSolver* Solver;
+    bool FactorCached;
+
+public:
+    CLDLTSolution(const CSolverOptions& _Options) : CSolution(_Options), Solver(nullptr), FactorCached(false){};
+
+    virtual ~CLDLTSolution() { delete Solver; }
+
+//  Read the factor of the same model written by an earlier run instead of assembling K
+    virtual void Assemble()
+    {
+        CDomain* FEMData = CDomain::Instance();
+        if (!Options.CacheFile.empty() && !FEMData->GetOutOfCoreBudget())
+            FactorCached = FEMData->ReadFactorCache(Options.CacheFile);
+
+        if (!FactorCached)
+            FEMData->AssembleStiffnessMatrix();
+    }
+
+    virtual void Factorize()
+    {
+        CDomain* FEMData = CDomain::Instance();
+        Solver = new CLDLTSolver(FEMData->GetStiffnessMatrix());
+
+        if (FactorCached)
+            cout << "Factor of the stiffness matrix read from " << Options.CacheFile << endl;
+        else if (FEMData->GetOutOfCoreBudget())
+            Solver->OutOfCoreLDLT();
+        else
+        {
+            if (Options.NumThreads != 1)
+                Solver->ParallelLDLT(Options.NumThreads, Options.PanelSize ? Options.PanelSize : 16);
+            else if (Options.PanelSize)
+                Solver->BlockLDLT(Options.PanelSize);
+            else
+                Solver->LDLT();
+
+            if (!Options.CacheFile.empty() && !FEMData->WriteFactorCache(Options.CacheFile))
+                cerr << "*** Warning *** Cannot write the factor cache file " << Options.CacheFile << endl;
+        }
+    }
+
+    virtual void Solve(unsigned int lcase)
+    {
+        if (lcase)
+            return;
+
+        CDomain* FEMData = CDomain::Instance();
+        for (unsigned int l = 0; l < FEMData->GetNLCASE(); l++)
+            FEMData->AssembleForce(l + 1);
+
+        if (FEMData->GetNLCASE() > 1)
+            Solver->BackSubstitution(FEMData->GetForce(), FEMData->GetNLCASE());
+        else
+            Solver->BackSubstitution(FEMData->GetForce());
+
+//      The out-of-core file is removed with the factor
+        if (FEMData->GetOutOfCoreBudget())
+            FEMData->ReleaseStiffnessMatrix();
+    }
+
+    virtual CLDLTSolver* GetSkylineSolver() { return Solver; }
+};
+
+//  Skyline LDLT solver in single precision with iterative refinement (-precision mixed)
+class CMixedLDLTSolution : public CSolution
+{
+protected:
+    CMixedLDLTSolver* Solver;
+
+public:
+    CMixedLDLTSolution(const CSolverOptions& _Options) : CSolution(_Options), Solver(nullptr){};
+
+    virtual ~CMixedLDLTSolution() { delete Solver; }
+
+    virtual void Factorize()
+    {
+        Solver = new CMixedLDLTSolver(CDomain::Instance()->GetStiffnessMatrix());
+        Solver->LDLT();
+    }
+
+    virtual void Solve(unsigned int lcase)
+    {
+        CDomain* FEMData = CDomain::Instance();
+        FEMData->AssembleForce(lcase + 1);
+        Solver->Solve(FEMData->GetForce(lcase));
+    }
+
+    virtual void Report(COutputter& Output)
+    {
+        if (!Solver->IsDoubleFactor())
+            Output << " REFINEMENT STEPS = " << Solver->GetIterations()
+                   << ",  RELATIVE RESIDUAL = " << Solver->GetResidual() << endl << endl;
+    }
+};
+
+//  Supernodal sparse LDLT solver
+class CSparseSolution : public CSolution
+{
+protected:
+    CSparseLDLTSolver* Solver;
+
+public:
+    CSparseSolution(const CSolverOptions& _Options) : CSolution(_Options), Solver(nullptr){};
+
+    virtual ~CSparseSolution() { delete Solver; }
+
+    virtual void Factorize()
+    {
+        CDomain* FEMData = CDomain::Instance();
+        Solver = new CSparseLDLTSolver(FEMData->GetCSRStiffnessMatrix(), Options.NumThreads);
+        Solver->Analyze(FEMData->GetEquationOrder().data());
+        Solver->LDLT();
+    }
+
+    virtual void Solve(unsigned int lcase)
+    {
+        CDomain* FEMData = CDomain::Instance();
+        FEMData->AssembleForce(lcase + 1);
+        Solver->BackSubstitution(FEMData->GetForce(lcase));
+    }
+};
+
+//  Preconditioned conjugate gradient solver
+class CPCGSolution : public CSolution
+{
+protected:
+    CPCGSolver* Solver;
+    CPreconditioner* Preconditioner;
+    CAMGPreconditioner* AMG;
+
+public:
+    CPCGSolution(const CSolverOptions& _Options)
+        : CSolution(_Options), Solver(nullptr), Preconditioner(nullptr), AMG(nullptr){};
+
+    virtual ~CPCGSolution()
+    {
+        delete Solver;
+        delete Preconditioner;
+    }
+
+    virtual void Factorize()
+    {
+        CDomain* FEMData = CDomain::Instance();
+        CSRMatrix<double>& K = FEMData->GetCSRStiffnessMatrix();
+
+        if (Options.Preconditioner == PreconditionerTypes::Jacobi)
+            Preconditioner = new CJacobiPreconditioner(K);
+        else if (Options.Preconditioner == PreconditionerTypes::BlockJacobi)
+        {
+            vector<int> BlockStart, BlockIndex;
+            FEMData->GetNodalEquations(BlockStart, BlockIndex);
+            Preconditioner = new CBlockJacobiPreconditioner(K, BlockStart, BlockIndex);
+        }
+        else if (Options.Preconditioner == PreconditionerTypes::AMG)
+        {
+            vector<int> BlockStart, BlockIndex;
+            vector<double> Modes;
+            FEMData->GetNodalEquations(BlockStart, BlockIndex);
+            unsigned int NumModes = FEMData->GetRigidBodyModes(Modes);
+            AMG = new CAMGPreconditioner(K, BlockStart, BlockIndex, Modes, NumModes);
+            Preconditioner = AMG;
+        }
+        else
+            Preconditioner = new CIC0Preconditioner(K);
+
+        Solver = new CPCGSolver(K, Preconditioner, Options.Tolerance, Options.MaxIterations);
+        Solver->SetNumThreads(Options.NumThreads);
+    }
+
+    virtual void Solve(unsigned int lcase)
+    {
+        CDomain* FEMData = CDomain::Instance();
+        FEMData->AssembleForce(lcase + 1);
+        if (!Solver->Solve(FEMData->GetForce(lcase)))
+            cerr << "*** Warning *** PCG solver did not converge in " << Options.MaxIterations
+                 << " iterations for load case " << lcase + 1 << endl;
+    }
+
+    virtual void Report(COutputter& Output)
+    {
+        Output << " PCG ITERATIONS = " << Solver->GetIterations()
+               << ",  RELATIVE RESIDUAL = " << Solver->GetResidual() << endl << endl;
+        if (AMG)
+            Output << " AMG LEVELS = " << AMG->GetNumLevels()
+                   << ",  OPERATOR COMPLEXITY = " << AMG->GetOperatorComplexity() << endl << endl;
+    }
+};
+
+//  Element-by-element PCG solver, without a global stiffness matrix
+class CEBESolution : public CPCGSolution
+{
+public:
+    CEBESolution(const CSolverOptions& _Options) : CPCGSolution(_Options){};
+
+    virtual void Assemble() {}
+
+    virtual void Factorize()
+    {
+        CDomain* FEMData = CDomain::Instance();
+        Solver = new CEBESolver(FEMData->GetEleGrpList(), FEMData->GetNUMEG(), FEMData->GetNEQ(),
+                                Options.CacheElementMatrices, Options.Tolerance, Options.MaxIterations);
+    }
+};
+
+//  Substructures condensed to their interface equations, solving all the load cases at once
+class CSubstructureSolution : public CSolution
+{
+public:
+    CSubstructureSolution(const CSolverOptions& _Options) : CSolution(_Options){};
+
+    virtual void Assemble() { CDomain::Instance()->GetSubstructures().Condense(Options.NumThreads); }
+
+    virtual void Factorize() { CDomain::Instance()->GetSubstructures().Factorize(); }
+
+    virtual void Solve(unsigned int lcase)
+    {
+        if (lcase)
+            return;
+
+        CDomain* FEMData = CDomain::Instance();
+        for (unsigned int l = 0; l < FEMData->GetNLCASE(); l++)
+            FEMData->AssembleForce(l + 1);
+
+        FEMData->GetSubstructures().Solve(FEMData->GetForce(), FEMData->GetNLCASE());
+    }
+};
+
+#ifdef MKL
+//  MKL PARDISO solver, solving all the load cases at once
+class CPardisoSolution : public CSolution
+{
+protected:
+    CSRSolver* Solver;
+
+public:
+    CPardisoSolution(const CSolverOptions& _Options) : CSolution(_Options), Solver(nullptr){};
+
+    virtual ~CPardisoSolution() { delete Solver; }
+
+    virtual void Factorize()
+    {
+        Solver = new CSRSolver(CDomain::Instance()->GetCSRStiffnessMatrix());
+        Solver->analyze();
+        Solver->factorize();
+    }
+
+    virtual void Solve(unsigned int lcase)
+    {
+        if (lcase)
+            return;
+
+        CDomain* FEMData = CDomain::Instance();
+        for (unsigned int l = 0; l < FEMData->GetNLCASE(); l++)
+            FEMData->AssembleForce(l + 1);
+
+        Solver->solve(FEMData->GetForce(), FEMData->GetNLCASE());
+
+//      Release the memory held by PARDISO
+        delete Solver;
+        Solver = nullptr;
+    }
+};
+#endif
+
+template <class Solution_>
+static CSolution* Create(const CSolverOptions& Options)
+{
+    return new Solution_(Options);
+}
+
+//  -precision mixed replaces the double precision factor of the skyline solver
+static CSolution* CreateLDLT(const CSolverOptions& Options)
+{
+    if (Options.MixedPrecision)
+        return new CMixedLDLTSolution(Options);
+
+    return new CLDLTSolution(Options);
+}
+
+//  Solvers selected by the -solver option, in the order of the help message. The vibration
+//  and transient solvers of _VIB_ builds work on the skyline matrices, so that only the skyline
+//  solver is offered there
+const vector<CSolverEntry>& SolverRegistry()
+{
+    static const vector<CSolverEntry> Registry = {
+        {"ldlt", SolverTypes::LDLT, "skyline LDLT solver", CreateLDLT},
+#ifndef _VIB_
+        {"sparse", SolverTypes::Sparse, "supernodal sparse LDLT solver", Create<CSparseSolution>},
+        {"pcg", SolverTypes::PCG, "preconditioned conjugate gradient solver", Create<CPCGSolution>},
+        {"ebe", SolverTypes::EBE, "Jacobi preconditioned conjugate gradient solver without the stiffness\n"
+                                  "                  matrix, whose products are summed element by element",
+         Create<CEBESolution>},
+        {"substructure", SolverTypes::Substructure, "condense the substructures to their interface equations on\n"
+                                                    "                           separate threads and solve the interface equations",
+         Create<CSubstructureSolution>},
+#ifdef MKL
+        {"pardiso", SolverTypes::PARDISO, "MKL PARDISO solver", Create<CPardisoSolution>},
+#endif
+#endif
+        {"auto", SolverTypes::Auto, "skyline, sparse or PCG solver, chosen from the number of equations,\n"
+                                    "                   the skyline profile and the available memory",
+         nullptr}
+    };
+
+    return Registry;
+}
+
+bool FindSolver(const string& Name, SolverTypes& Type)
+{
+    for (const CSolverEntry& Entry : SolverRegistry())
+        if (Name == Entry.Name)
+        {
+            Type = Entry.Type;
+            return true;
+        }
+
+    return false;
+}
+
+const char* SolverName(SolverTypes Type)
+{
+    for (const CSolverEntry& Entry : SolverRegistry())
+        if (Entry.Type == Type)
+            return Entry.Name;
+
+    return "";
+}
+
+CSolution* CreateSolution(SolverTypes Type, const CSolverOptions& Options)
+{
+    for (const CSolverEntry& Entry : SolverRegistry())
+        if (Entry.Type == Type && Entry.Create)
+            return Entry.Create(Options);
+
+    return nullptr;
+}
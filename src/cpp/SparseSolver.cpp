@@ -0,0 +1,517 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#include "SparseSolver.h"
+#include "Eigen/Dense"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+using namespace Eigen;
+
+//  Build the lower triangle of P*K*P(T) by columns, where Perm[k] is the k-th equation
+static void PermutedLower(CSRMatrix<double>& K, const vector<int>& Perm, vector<CSRIndex_t>& Ap,
+                          vector<int>& Ai, vector<CSRIndex_t>& Ax)
+{
+    const int N = K.size;
+
+    vector<int> IPerm(N);
+    for (int k = 0; k < N; k++)
+        IPerm[Perm[k]] = k;
+
+    Ap.assign(N + 1, 0);
+    for (int row = 0; row < N; row++)
+        for (CSRIndex_t p = K.rowIndexs[row] - 1; p < K.rowIndexs[row + 1] - 1; p++)
+            Ap[min(IPerm[row], IPerm[K.columns[p] - 1]) + 1]++;
+
+    for (int k = 0; k < N; k++)
+        Ap[k + 1] += Ap[k];
+
+    Ai.resize(Ap[N]);
+    Ax.resize(Ap[N]);
+
+    vector<CSRIndex_t> Next(Ap.begin(), Ap.end() - 1);
+    for (int row = 0; row < N; row++)
+        for (CSRIndex_t p = K.rowIndexs[row] - 1; p < K.rowIndexs[row + 1] - 1; p++)
+        {
+            const int i = IPerm[row];
+            const int j = IPerm[K.columns[p] - 1];
+            const CSRIndex_t q = Next[min(i, j)]++;
+            Ai[q] = max(i, j);
+            Ax[q] = p;
+        }
+}
+
+//  Elimination tree of the matrix whose lower triangle is stored by columns in (Ap, Ai)
+static void EliminationTree(int N, const vector<CSRIndex_t>& Ap, const vector<int>& Ai,
+                            vector<int>& Parent)
+{
+    // Rows of the lower triangle: the columns i < k with L(k,i) != 0
+    vector<CSRIndex_t> Rp(N + 1, 0);
+    vector<int> Rj(Ap[N]);
+    for (CSRIndex_t q = 0; q < Ap[N]; q++)
+        Rp[Ai[q] + 1]++;
+    for (int k = 0; k < N; k++)
+        Rp[k + 1] += Rp[k];
+
+    vector<CSRIndex_t> Next(Rp.begin(), Rp.end() - 1);
+    for (int j = 0; j < N; j++)
+        for (CSRIndex_t q = Ap[j]; q < Ap[j + 1]; q++)
+            Rj[Next[Ai[q]]++] = j;
+
+    // Liu's algorithm with path compression
+    vector<int> Ancestor(N, -1);
+    Parent.assign(N, -1);
+
+    for (int k = 0; k < N; k++)
+        for (CSRIndex_t q = Rp[k]; q < Rp[k + 1]; q++)
+        {
+            int i = Rj[q];
+            while (i != -1 && i < k)
+            {
+                const int next = Ancestor[i];
+                Ancestor[i] = k;
+                if (next == -1)
+                    Parent[i] = k;
+                i = next;
+            }
+        }
+}
+
+//  Symbolic analysis
+void CSparseLDLTSolver::Analyze(const int* Ordering)
+{
+    N = K.size;
+
+    Perm.resize(N);
+    for (int k = 0; k < N; k++)
+        Perm[k] = Ordering ? Ordering[k] : k;
+
+    // Postorder the elimination tree, so that the columns of every subtree are contiguous
+    vector<int> Parent;
+    PermutedLower(K, Perm, Ap, Ai, Ax);
+    EliminationTree(N, Ap, Ai, Parent);
+
+    {
+        vector<int> Head(N, -1), Sibling(N, -1);
+        for (int k = N - 1; k >= 0; k--)
+            if (Parent[k] != -1)
+            {
+                Sibling[k] = Head[Parent[k]];
+                Head[Parent[k]] = k;
+            }
+
+        vector<int> Post, Stack;
+        Post.reserve(N);
+        for (int root = 0; root < N; root++)
+        {
+            if (Parent[root] != -1)
+                continue;
+
+            Stack.push_back(root);
+            while (!Stack.empty())
+            {
+                const int k = Stack.back();
+                if (Head[k] != -1)
+                {
+                    Stack.push_back(Head[k]);
+                    Head[k] = Sibling[Head[k]];
+                }
+                else
+                {
+                    Post.push_back(k);
+                    Stack.pop_back();
+                }
+            }
+        }
+
+        for (int k = 0; k < N; k++)
+            Post[k] = Perm[Post[k]];
+        Perm.swap(Post);
+    }
+
+    PermutedLower(K, Perm, Ap, Ai, Ax);
+    EliminationTree(N, Ap, Ai, Parent);
+
+    // Column counts of L: row k of L is the set of nodes on the paths from each i (A(k,i) != 0)
+    // up to k in the elimination tree
+    vector<int> ColCount(N, 1), Mark(N, -1);
+    {
+        vector<CSRIndex_t> Rp(N + 1, 0);
+        vector<int> Rj(Ap[N]);
+        for (CSRIndex_t q = 0; q < Ap[N]; q++)
+            Rp[Ai[q] + 1]++;
+        for (int k = 0; k < N; k++)
+            Rp[k + 1] += Rp[k];
+        vector<CSRIndex_t> Next(Rp.begin(), Rp.end() - 1);
+        for (int j = 0; j < N; j++)
+            for (CSRIndex_t q = Ap[j]; q < Ap[j + 1]; q++)
+                Rj[Next[Ai[q]]++] = j;
+
+        for (int k = 0; k < N; k++)
+        {
+            Mark[k] = k;
+            for (CSRIndex_t q = Rp[k]; q < Rp[k + 1]; q++)
+                for (int i = Rj[q]; Mark[i] != k; i = Parent[i])
+                {
+                    ColCount[i]++;
+                    Mark[i] = k;
+                }
+        }
+    }
+
+    // Relaxed supernodes: column k joins the supernode of column k-1 if k is the parent of
+    // k-1, as long as the explicit zeros stored in the supernode stay few. The structure of
+    // L(:,k-1) is then contained in that of L(:,k) plus the diagonal.
+    SuperStart.clear();
+    size_t Stored = 0, Zeros = 0;
+    for (int k = 0; k < N; k++)
+    {
+        if (k > 0 && Parent[k - 1] == k)
+        {
+            const int first = SuperStart.back();
+            const size_t nc = k - first + 1;
+            const size_t nr = nc + ColCount[k] - 1;
+
+            size_t NewZeros = Zeros, NewStored = 0;
+            if (ColCount[k - 1] != ColCount[k] + 1)
+            {
+                // All columns of the supernode get the rows of column k
+                NewStored = nc * nr - nc * (nc - 1) / 2;
+                NewZeros = NewStored;
+                for (int c = first; c <= k; c++)
+                    NewZeros -= ColCount[c];
+            }
+            else
+                NewStored = Stored + ColCount[k];
+
+            if (NewZeros == Zeros || nc <= 4 || (nc <= 16 && NewZeros < 0.8 * NewStored) ||
+                (nc <= 48 && NewZeros < 0.1 * NewStored) || NewZeros < 0.05 * NewStored)
+            {
+                Stored = NewStored;
+                Zeros = NewZeros;
+                continue;
+            }
+        }
+
+        SuperStart.push_back(k);
+        Stored = ColCount[k];
+        Zeros = 0;
+    }
+    SuperStart.push_back(N);
+
+    const int NS = int(SuperStart.size()) - 1;
+
+    vector<int> SuperOf(N);
+    for (int s = 0; s < NS; s++)
+        for (int k = SuperStart[s]; k < SuperStart[s + 1]; k++)
+            SuperOf[k] = s;
+
+    SuperParent.assign(NS, -1);
+    for (int s = 0; s < NS; s++)
+    {
+        const int last = SuperStart[s + 1] - 1;
+        if (Parent[last] != -1)
+            SuperParent[s] = SuperOf[Parent[last]];
+    }
+
+    ChildStart.assign(NS + 1, 0);
+    for (int s = 0; s < NS; s++)
+        if (SuperParent[s] != -1)
+            ChildStart[SuperParent[s] + 1]++;
+    for (int s = 0; s < NS; s++)
+        ChildStart[s + 1] += ChildStart[s];
+    Children.resize(ChildStart[NS]);
+    {
+        vector<int> Next(ChildStart.begin(), ChildStart.end() - 1);
+        for (int s = 0; s < NS; s++)
+            if (SuperParent[s] != -1)
+                Children[Next[SuperParent[s]]++] = s;
+    }
+
+    // Row structure of the supernodes: their own columns, the rows of A below them and the
+    // rows of the children below them. Children precede their parent in postorder.
+    RowStart.assign(NS + 1, 0);
+    FactorStart.assign(NS + 1, 0);
+    RowIndex.clear();
+    Mark.assign(N, -1);
+
+    for (int s = 0; s < NS; s++)
+    {
+        const int first = SuperStart[s];
+        const int last = SuperStart[s + 1];
+
+        for (int k = first; k < last; k++)
+        {
+            RowIndex.push_back(k);
+            Mark[k] = s;
+        }
+
+        const size_t below = RowIndex.size();
+
+        for (int k = first; k < last; k++)
+            for (CSRIndex_t q = Ap[k]; q < Ap[k + 1]; q++)
+                if (Mark[Ai[q]] != s)
+                {
+                    Mark[Ai[q]] = s;
+                    RowIndex.push_back(Ai[q]);
+                }
+
+        for (int c = ChildStart[s]; c < ChildStart[s + 1]; c++)
+        {
+            const int child = Children[c];
+            const size_t nc = SuperStart[child + 1] - SuperStart[child];
+            for (size_t p = RowStart[child] + nc; p < RowStart[child + 1]; p++)
+                if (Mark[RowIndex[p]] != s)
+                {
+                    Mark[RowIndex[p]] = s;
+                    RowIndex.push_back(RowIndex[p]);
+                }
+        }
+
+        sort(RowIndex.begin() + below, RowIndex.end());
+        RowStart[s + 1] = RowIndex.size();
+
+        FactorStart[s + 1] = FactorStart[s] + (RowStart[s + 1] - RowStart[s]) * (last - first);
+    }
+}
+
+//  Assemble the frontal matrix of supernode s, eliminate its columns and keep the update
+//  matrix (the Schur complement on the rows below the supernode) for its parent
+void CSparseLDLTSolver::FactorSupernode(int s, int* RowMap, vector<vector<double>>& Update)
+{
+    const int first = SuperStart[s];
+    const int nc = SuperStart[s + 1] - first;
+    const int nr = int(RowStart[s + 1] - RowStart[s]);
+    const int nu = nr - nc;
+    const int* Rows = &RowIndex[RowStart[s]];
+
+    for (int i = 0; i < nr; i++)
+        RowMap[Rows[i]] = i;
+
+    // Frontal matrix (lower triangle, column major)
+    vector<double> Front(size_t(nr) * nr, 0.0);
+    Map<MatrixXd> F(Front.data(), nr, nr);
+
+    for (int j = 0; j < nc; j++)
+        for (CSRIndex_t q = Ap[first + j]; q < Ap[first + j + 1]; q++)
+            F(RowMap[Ai[q]], j) += K.values[Ax[q]];
+
+    // Extend-add the update matrices of the children, in a fixed order
+    for (int c = ChildStart[s]; c < ChildStart[s + 1]; c++)
+    {
+        const int child = Children[c];
+        const int cnc = SuperStart[child + 1] - SuperStart[child];
+        const int cnu = int(RowStart[child + 1] - RowStart[child]) - cnc;
+        const int* CRows = &RowIndex[RowStart[child] + cnc];
+        const double* U = Update[child].data();
+
+        for (int jj = 0; jj < cnu; jj++)
+        {
+            const int j = RowMap[CRows[jj]];
+            for (int ii = jj; ii < cnu; ii++)
+                F(RowMap[CRows[ii]], j) += U[size_t(jj) * cnu + ii];
+        }
+
+        vector<double>().swap(Update[child]);
+    }
+
+    // Dense L*D*L(T) of the supernode columns, by blocks of columns
+    const int BlockSize = 32;
+    VectorXd D(nc);
+
+    for (int k0 = 0; k0 < nc; k0 += BlockSize)
+    {
+        const int k1 = min(k0 + BlockSize, nc);
+
+        for (int k = k0; k < k1; k++)
+        {
+            const double d = F(k, k);
+            if (fabs(d) <= FLT_MIN)
+            {
+                cerr << "*** Error *** Stiffness matrix is not positive definite !" << endl
+                     << "    Euqation no = " << Perm[first + k] + 1 << endl
+                     << "    Pivot = " << d << endl;
+
+                exit(4);
+            }
+
+            D(k) = d;
+            F.col(k).tail(nr - k - 1) /= d;
+
+            for (int j = k + 1; j < k1; j++)
+                F.col(j).tail(nr - j) -= F.col(k).tail(nr - j) * (d * F(j, k));
+        }
+
+        if (k1 < nc)
+        {
+            MatrixXd W = F.block(k1, k0, nc - k1, k1 - k0) * D.segment(k0, k1 - k0).asDiagonal();
+            F.block(k1, k1, nr - k1, nc - k1).noalias() -=
+                F.block(k1, k0, nr - k1, k1 - k0) * W.transpose();
+        }
+    }
+
+    // Schur complement on the rows below the supernode
+    if (nu > 0)
+    {
+        MatrixXd W = F.bottomLeftCorner(nu, nc) * D.asDiagonal();
+        F.bottomRightCorner(nu, nu).triangularView<Lower>() -=
+            F.bottomLeftCorner(nu, nc) * W.transpose();
+
+        Update[s].resize(size_t(nu) * nu);
+        Map<MatrixXd>(Update[s].data(), nu, nu) = F.bottomRightCorner(nu, nu);
+    }
+
+    // Store L (with D on the diagonal) of the supernode
+    Map<MatrixXd> L(&Factor[FactorStart[s]], nr, nc);
+    L = F.leftCols(nc);
+    L.diagonal() = D;
+}
+
+//  Numerical factorization
+//  A supernode is factorized as soon as all its children are, so that independent subtrees
+//  are processed at the same time. Each supernode sums its contributions in the same order
+//  whatever the number of threads, so the factor does not depend on NumThreads.
+void CSparseLDLTSolver::LDLT()
+{
+    const int NS = int(SuperParent.size());
+
+    Factor.assign(FactorStart[NS], 0.0);
+    vector<vector<double>> Update(NS);
+
+    unsigned int Threads = NumThreads ? NumThreads : max(thread::hardware_concurrency(), 1u);
+
+    if (Threads == 1)
+    {
+        vector<int> RowMap(N);
+        for (int s = 0; s < NS; s++)
+            FactorSupernode(s, RowMap.data(), Update);
+
+        return;
+    }
+
+    vector<int> Pending(NS);
+    deque<int> Ready;
+    for (int s = 0; s < NS; s++)
+    {
+        Pending[s] = ChildStart[s + 1] - ChildStart[s];
+        if (!Pending[s])
+            Ready.push_back(s);
+    }
+
+    mutex Lock;
+    condition_variable Wakeup;
+    int Done = 0;
+
+    auto Worker = [&]()
+    {
+        vector<int> RowMap(N);
+
+        unique_lock<mutex> Guard(Lock);
+        while (Done < NS)
+        {
+            if (Ready.empty())
+            {
+                Wakeup.wait(Guard);
+                continue;
+            }
+
+            const int s = Ready.front();
+            Ready.pop_front();
+
+            Guard.unlock();
+            FactorSupernode(s, RowMap.data(), Update);
+            Guard.lock();
+
+            Done++;
+            if (SuperParent[s] != -1 && --Pending[SuperParent[s]] == 0)
+                Ready.push_back(SuperParent[s]);
+
+            Wakeup.notify_all();
+        }
+    };
+
+    vector<thread> Pool;
+    for (unsigned int t = 1; t < Threads; t++)
+        Pool.push_back(thread(Worker));
+
+    Worker();
+
+    for (auto& t : Pool)
+        t.join();
+}
+
+//  Solve displacement by forward reduction and back substitution
+void CSparseLDLTSolver::BackSubstitution(double* Force)
+{
+    const int NS = int(SuperParent.size());
+
+    vector<double> x(N);
+    for (int k = 0; k < N; k++)
+        x[k] = Force[Perm[k]];
+
+    // Reduce right-hand-side load vector (LV = R)
+    for (int s = 0; s < NS; s++)
+    {
+        const int first = SuperStart[s];
+        const int nc = SuperStart[s + 1] - first;
+        const int nr = int(RowStart[s + 1] - RowStart[s]);
+        const int* Rows = &RowIndex[RowStart[s]];
+        const double* L = &Factor[FactorStart[s]];
+
+        for (int j = 0; j < nc; j++)
+        {
+            const double xj = x[first + j];
+            const double* Lj = L + size_t(j) * nr;
+            for (int i = j + 1; i < nr; i++)
+                x[Rows[i]] -= Lj[i] * xj;
+        }
+    }
+
+    // Vbar = D^(-1) V
+    for (int s = 0; s < NS; s++)
+    {
+        const int first = SuperStart[s];
+        const int nr = int(RowStart[s + 1] - RowStart[s]);
+        const double* L = &Factor[FactorStart[s]];
+
+        for (int j = 0; j < SuperStart[s + 1] - first; j++)
+            x[first + j] /= L[size_t(j) * nr + j];
+    }
+
+    // Back substitute (L^T a = Vbar)
+    for (int s = NS - 1; s >= 0; s--)
+    {
+        const int first = SuperStart[s];
+        const int nc = SuperStart[s + 1] - first;
+        const int nr = int(RowStart[s + 1] - RowStart[s]);
+        const int* Rows = &RowIndex[RowStart[s]];
+        const double* L = &Factor[FactorStart[s]];
+
+        for (int j = nc - 1; j >= 0; j--)
+        {
+            const double* Lj = L + size_t(j) * nr;
+            double xj = x[first + j];
+            for (int i = j + 1; i < nr; i++)
+                xj -= Lj[i] * x[Rows[i]];
+            x[first + j] = xj;
+        }
+    }
+
+    for (int k = 0; k < N; k++)
+        Force[Perm[k]] = x[k];
+}
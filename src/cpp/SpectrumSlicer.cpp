@@ -0,0 +1,188 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#include "SpectrumSlicer.h"
+#include "LanczosSolver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <thread>
+
+using namespace std;
+
+CSpectrumSlicer::CSpectrumSlicer(CSkylineMatrix<double>& _K, CSkylineMatrix<double>& _M,
+                                 unsigned int _NumWindows, unsigned int _NumThreads)
+    : K(_K), M(&_M), LumpedM(nullptr), NumWindows(_NumWindows), NumThreads(_NumThreads)
+{
+    if (NumThreads == 0)
+        NumThreads = max(thread::hardware_concurrency(), 1u);
+
+    if (NumWindows == 0)
+        NumWindows = NumThreads;
+}
+
+CSpectrumSlicer::CSpectrumSlicer(CSkylineMatrix<double>& _K, const double* _LumpedM,
+                                 unsigned int _NumWindows, unsigned int _NumThreads)
+    : K(_K), M(nullptr), LumpedM(_LumpedM), NumWindows(_NumWindows), NumThreads(_NumThreads)
+{
+    if (NumThreads == 0)
+        NumThreads = max(thread::hardware_concurrency(), 1u);
+
+    if (NumWindows == 0)
+        NumWindows = NumThreads;
+}
+
+void CSpectrumSlicer::ShiftedMatrix(double Shift, CSkylineMatrix<double>& A)
+{
+    const Index_t N = K.dim();
+    copy(K.GetColumnHeights(), K.GetColumnHeights() + N, A.GetColumnHeights());
+    copy(K.GetDiagonalAddress(), K.GetDiagonalAddress() + N + 1, A.GetDiagonalAddress());
+    A.Allocate();
+
+    const double* k = K.GetData();
+    double* a = A.GetData();
+    if (M)
+    {
+        const double* m = M->GetData();
+        for (Index_t i = 0; i < A.size(); i++)
+            a[i] = k[i] - Shift * m[i];
+    }
+    else
+    {
+        copy(k, k + A.size(), a);
+        for (Index_t j = 1; j <= N; j++)
+            A(j, j) -= Shift * LumpedM[j - 1];
+    }
+}
+
+//  The tasks are taken in increasing order by the first idle thread
+template <class Task_>
+bool CSpectrumSlicer::ForEach(unsigned int Size, Task_ Task)
+{
+    atomic<unsigned int> Next(0);
+    atomic<bool> Success(true);
+
+    auto Worker = [&]()
+    {
+        for (unsigned int i = Next++; i < Size; i = Next++)
+            if (!Task(i))
+                Success = false;
+    };
+
+    vector<thread> Pool;
+    for (unsigned int t = 1; t < min(NumThreads, Size); t++)
+        Pool.push_back(thread(Worker));
+    Worker();
+    for (thread& t : Pool)
+        t.join();
+
+    return Success;
+}
+
+bool CSpectrumSlicer::Solve(double Cutoff, vector<double>& EigenValues, vector<double>& EigenVectors)
+{
+    const Index_t N = K.dim();
+
+    EigenValues.clear();
+    EigenVectors.clear();
+
+//  Bounds of the windows, uniform in frequency, and the Sturm count of each of them
+    Bounds.resize(NumWindows);
+    Counts.resize(NumWindows);
+    for (unsigned int w = 0; w < NumWindows; w++)
+        Bounds[w] = Cutoff * pow(double(w + 1) / NumWindows, 2);
+
+    ForEach(NumWindows, [this, N](unsigned int w)
+    {
+        CSkylineMatrix<double> A(N);
+        ShiftedMatrix(Bounds[w], A);
+
+        CLDLTSolver Solver(A);
+        Solver.LDLT();
+        Counts[w] = Solver.NegativePivots();
+        return true;
+    });
+
+//  Modes of each window by the Lanczos solver shifted to its centre. The modes nearest to the
+//  centre are those of the window, unless the Lanczos solver missed some of them, in which case
+//  more modes are asked for. The lowest window also holds the rigid body modes, which may come
+//  out slightly negative
+    vector<vector<double>> Values(NumWindows), Vectors(NumWindows);
+
+    const bool Success = ForEach(NumWindows, [&, this, N](unsigned int w)
+    {
+        const double Lower = w ? Bounds[w - 1] : -numeric_limits<double>::infinity();
+        const double Upper = Bounds[w];
+        if (w && Counts[w] < Counts[w - 1])
+        {
+            cerr << "*** Error *** The Sturm counts of the factors of K - b*M decrease at b = "
+                 << Upper << endl;
+            return false;
+        }
+
+        const Index_t Expected = Counts[w] - (w ? Counts[w - 1] : 0);
+        if (Expected == 0)
+            return true;
+
+        const double Centre = 0.5 * ((w ? Bounds[w - 1] : 0.0) + Upper);
+
+        CSkylineMatrix<double> A(N);
+        ShiftedMatrix(Centre, A);
+
+        CLDLTSolver Solver(A);
+        Solver.LDLT();
+        CLanczosSolver Lanczos = M ? CLanczosSolver(Solver, *M, Centre)
+                                   : CLanczosSolver(Solver, LumpedM, Centre);
+
+        Index_t Found = 0;
+        for (Index_t Asked = Expected; ; Asked = min(N, 2 * Asked))
+        {
+            vector<double> Lambda(Asked), X((size_t)N * Asked);
+            if (!Lanczos.Solve((unsigned int)Asked, Lambda.data(), X.data()))
+                return false;
+
+            Values[w].clear();
+            Vectors[w].clear();
+            for (Index_t m = 0; m < Asked; m++)
+                if (Lambda[m] >= Lower && Lambda[m] < Upper)
+                {
+                    Values[w].push_back(Lambda[m]);
+                    Vectors[w].insert(Vectors[w].end(), X.begin() + m * N, X.begin() + (m + 1) * N);
+                }
+
+            Found = Values[w].size();
+            if (Found == Expected || Asked == N)
+                break;
+        }
+
+        if (Found != Expected)
+        {
+            cerr << "*** Error *** " << Found << " eigenvalues found in [" << Lower << ", " << Upper
+                 << ") instead of the " << Expected << " of the Sturm sequence" << endl;
+            return false;
+        }
+
+        return true;
+    });
+
+    if (!Success)
+        return false;
+
+    for (unsigned int w = 0; w < NumWindows; w++)
+    {
+        EigenValues.insert(EigenValues.end(), Values[w].begin(), Values[w].end());
+        EigenVectors.insert(EigenVectors.end(), Vectors[w].begin(), Vectors[w].end());
+    }
+
+    return true;
+}
@@ -0,0 +1,473 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#include "Substructure.h"
+#include "Solver.h"
+#include "Eigen/Dense"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <thread>
+#include <typeinfo>
+
+using namespace std;
+using namespace Eigen;
+
+//  Calculate the diagonal addresses of a skyline matrix from its column heights, and allocate it
+static void AllocateSkyline(CSkylineMatrix<double>& K)
+{
+    const Index_t* ColumnHeights = K.GetColumnHeights();
+    Index_t* DiagonalAddress = K.GetDiagonalAddress();
+
+    DiagonalAddress[0] = 1;
+    for (Index_t i = 0; i < K.dim(); i++)
+        DiagonalAddress[i + 1] = DiagonalAddress[i] + ColumnHeights[i] + 1;
+
+    K.Allocate();
+}
+
+CSubstructureSolver::~CSubstructureSolver()
+{
+    for (CCondensed& C : Condensed)
+        delete C.Kii;
+
+    delete KBB;
+}
+
+//  Split the elements into slabs along the longest side of the box bounding their centroids
+void CSubstructureSolver::Split(vector<CElement*>& Elements, unsigned int NumParts,
+                                vector<vector<CElement*>>& Parts)
+{
+    const size_t N = Elements.size();
+
+    vector<double> Centroid(3 * N, 0.0);
+    double Min[3] = {HUGE_VAL, HUGE_VAL, HUGE_VAL}, Max[3] = {-HUGE_VAL, -HUGE_VAL, -HUGE_VAL};
+    for (size_t e = 0; e < N; e++)
+    {
+        CNode** Nodes = Elements[e]->GetNodes();
+        const int NEN = Elements[e]->GetNEN();
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            for (int n = 0; n < NEN; n++)
+                Centroid[3 * e + i] += Nodes[n]->XYZ[i] / NEN;
+
+            Min[i] = min(Min[i], Centroid[3 * e + i]);
+            Max[i] = max(Max[i], Centroid[3 * e + i]);
+        }
+    }
+
+    unsigned int Axis = 0;
+    for (unsigned int i = 1; i < 3; i++)
+        if (Max[i] - Min[i] > Max[Axis] - Min[Axis])
+            Axis = i;
+
+    vector<size_t> Order(N);
+    for (size_t e = 0; e < N; e++)
+        Order[e] = e;
+    stable_sort(Order.begin(), Order.end(), [&](size_t a, size_t b) {
+        return Centroid[3 * a + Axis] < Centroid[3 * b + Axis];
+    });
+
+    for (unsigned int p = 0; p < NumParts; p++)
+    {
+        const size_t e0 = N * p / NumParts, e1 = N * (p + 1) / NumParts;
+        if (e1 == e0)
+            continue;
+
+        Parts.push_back(vector<CElement*>());
+        for (size_t k = e0; k < e1; k++)
+            Parts.back().push_back(Elements[Order[k]]);
+    }
+}
+
+//  Partition the elements into substructures and number the interface equations
+void CSubstructureSolver::Partition(CElementGroup* EleGrpList, unsigned int NUMEG, Index_t _NEQ,
+                                    unsigned int NumParts)
+{
+    NEQ = _NEQ;
+
+    for (unsigned int EleGrp = 0; EleGrp < NUMEG; EleGrp++)
+    {
+        CElementGroup& ElementGrp = EleGrpList[EleGrp];
+
+        vector<CElement*> Elements;
+        ElementGrp.AppendElements(Elements);
+
+        vector<vector<CElement*>> Parts;
+        Split(Elements, max(NumParts, 1u), Parts);
+
+        for (auto& Part : Parts)
+        {
+            Substructures.push_back(CSubstructure());
+            Substructures.back().Elements.swap(Part);
+        }
+    }
+
+//  Equations used by more than one substructure are interface equations
+    const unsigned int None = UINT_MAX;
+    vector<unsigned int> Owner(NEQ, None);
+    vector<bool> Shared(NEQ, false);
+    for (unsigned int s = 0; s < Substructures.size(); s++)
+        for (CElement* Element : Substructures[s].Elements)
+        {
+            const Index_t* LM = Element->GetLocationMatrix();
+            for (unsigned int k = 0; k < Element->GetLMSize() - Element->GetNumCondensed(); k++)
+                if (LM[k])
+                {
+                    if (Owner[LM[k] - 1] == None)
+                        Owner[LM[k] - 1] = s;
+                    else if (Owner[LM[k] - 1] != s)
+                        Shared[LM[k] - 1] = true;
+                }
+        }
+
+//  Local equations of each substructure. The pattern of a substructure gives the local
+//  equation of every entry of the location matrices of its elements: 0 for a fixed DOF,
+//  i for the i-th interior equation and -b for the b-th interface equation
+    vector<long long> Local(NEQ, 0);
+    for (CSubstructure& Sub : Substructures)
+    {
+        for (CElement* Element : Sub.Elements)
+        {
+            const Index_t* LM = Element->GetLocationMatrix();
+            for (unsigned int k = 0; k < Element->GetLMSize() - Element->GetNumCondensed(); k++)
+            {
+                const Index_t eq = LM[k];
+                if (eq && !Local[eq - 1])
+                {
+                    if (Shared[eq - 1])
+                    {
+                        Sub.Interface.push_back(eq);
+                        Local[eq - 1] = -(long long)Sub.Interface.size();
+                    }
+                    else
+                    {
+                        Sub.Interior.push_back(eq);
+                        Local[eq - 1] = Sub.Interior.size();
+                    }
+                }
+                Sub.Pattern.push_back(eq ? Local[eq - 1] : 0);
+            }
+        }
+
+        for (Index_t eq : Sub.Interior)
+            Local[eq - 1] = 0;
+        for (Index_t eq : Sub.Interface)
+            Local[eq - 1] = 0;
+    }
+
+//  The interface equations are numbered substructure by substructure, so that the interfaces
+//  of a chain of substructures give a block tridiagonal interface matrix
+    InterfaceNumber.assign(NEQ, 0);
+    Index_t NB = 0;
+    for (CSubstructure& Sub : Substructures)
+        for (Index_t eq : Sub.Interface)
+            if (!InterfaceNumber[eq - 1])
+                InterfaceNumber[eq - 1] = ++NB;
+
+//  The condensed matrices of a substructure are shared with the first identical one. The element
+//  matrices of every substructure are calculated once, and those of the distinct substructures
+//  are kept for their condensation
+    vector<double> Matrices;
+    for (unsigned int s = 0; s < Substructures.size(); s++)
+    {
+        ElementMatrices(s, Matrices);
+
+        unsigned int c = 0;
+        while (c < Condensed.size() && !Identical(s, Matrices, c))
+            c++;
+
+        if (c == Condensed.size())
+        {
+            Condensed.push_back(CCondensed());
+            Condensed.back().Substructure = s;
+            Condensed.back().Kii = nullptr;
+            Condensed.back().Matrices.swap(Matrices);
+        }
+
+        Substructures[s].Condensed = c;
+    }
+
+//  Skyline of the interface matrix, in which the interface equations of each substructure
+//  are coupled with each other
+    KBB = new CSkylineMatrix<double>(NB);
+    Index_t* ColumnHeights = KBB->GetColumnHeights();
+    for (CSubstructure& Sub : Substructures)
+    {
+        Index_t First = NB + 1;
+        for (Index_t eq : Sub.Interface)
+            First = min(First, InterfaceNumber[eq - 1]);
+
+        for (Index_t eq : Sub.Interface)
+        {
+            const Index_t b = InterfaceNumber[eq - 1];
+            ColumnHeights[b - 1] = max(ColumnHeights[b - 1], b - First);
+        }
+    }
+
+    AllocateSkyline(*KBB);
+}
+
+//  Element stiffness matrices of a substructure, one after another
+void CSubstructureSolver::ElementMatrices(unsigned int s, vector<double>& Matrices) const
+{
+    size_t Size = 0;
+    for (CElement* Element : Substructures[s].Elements)
+        Size += Element->SizeOfStiffnessMatrix();
+
+    Matrices.resize(Size);
+    double* Matrix = Matrices.data();
+    for (CElement* Element : Substructures[s].Elements)
+    {
+        Element->CondensedStiffness(Matrix);
+        Matrix += Element->SizeOfStiffnessMatrix();
+    }
+}
+
+//  Substructures are identical if the stiffness matrices of their elements are equal and
+//  are assembled into the same local equations
+bool CSubstructureSolver::Identical(unsigned int s, const vector<double>& Matrices, unsigned int c) const
+{
+    const CSubstructure& A = Substructures[s];
+    const CSubstructure& B = Substructures[Condensed[c].Substructure];
+
+    if (A.Elements.size() != B.Elements.size() || A.Interior.size() != B.Interior.size() ||
+        A.Interface.size() != B.Interface.size() || A.Pattern != B.Pattern ||
+        Matrices.size() != Condensed[c].Matrices.size())
+        return false;
+
+    const double* Ka = Matrices.data();
+    const double* Kb = Condensed[c].Matrices.data();
+    for (size_t e = 0; e < A.Elements.size(); e++)
+    {
+        CElement& Ea = *A.Elements[e];
+        CElement& Eb = *B.Elements[e];
+        if (typeid(Ea) != typeid(Eb) || Ea.SizeOfStiffnessMatrix() != Eb.SizeOfStiffnessMatrix() ||
+            Ea.GetNumCondensed() != Eb.GetNumCondensed())
+            return false;
+
+        const unsigned int Size = Ea.SizeOfStiffnessMatrix();
+
+        double Norm = 0.0;
+        for (unsigned int i = 0; i < Size; i++)
+            Norm = max(Norm, fabs(Ka[i]));
+
+        for (unsigned int i = 0; i < Size; i++)
+            if (fabs(Ka[i] - Kb[i]) > 1.0e-12 * Norm)
+                return false;
+
+        Ka += Size;
+        Kb += Size;
+    }
+
+    return true;
+}
+
+//  Assemble K_ii, K_ib and K_bb of a substructure, factorize K_ii and condense
+void CSubstructureSolver::CondenseSubstructure(unsigned int c)
+{
+    CCondensed& C = Condensed[c];
+    const CSubstructure& Sub = Substructures[C.Substructure];
+    const Index_t NI = Sub.Interior.size();
+    const Index_t NB = Sub.Interface.size();
+
+//  Skyline of K_ii
+    C.Kii = new CSkylineMatrix<double>(NI);
+    Index_t* ColumnHeights = C.Kii->GetColumnHeights();
+    const long long* Pattern = Sub.Pattern.data();
+    for (CElement* Element : Sub.Elements)
+    {
+        const unsigned int ND = Element->GetLMSize() - Element->GetNumCondensed();
+
+        long long First = NI + 1;
+        for (unsigned int k = 0; k < ND; k++)
+            if (Pattern[k] > 0)
+                First = min(First, Pattern[k]);
+
+        for (unsigned int k = 0; k < ND; k++)
+            if (Pattern[k] > 0)
+                ColumnHeights[Pattern[k] - 1] = max(ColumnHeights[Pattern[k] - 1], Index_t(Pattern[k] - First));
+
+        Pattern += ND;
+    }
+    AllocateSkyline(*C.Kii);
+
+    CSkylineMatrix<double>& Kii = *C.Kii;
+    vector<double> Kib((size_t)NI * NB, 0.0);
+    C.S.assign((size_t)NB * NB, 0.0);
+
+//  Assemble the element stiffness matrices calculated in Partition()
+    const double* Matrix = C.Matrices.data();
+    Pattern = Sub.Pattern.data();
+    for (CElement* Element : Sub.Elements)
+    {
+        const unsigned int ND = Element->GetLMSize() - Element->GetNumCondensed();
+
+        for (unsigned int j = 0; j < ND; j++)
+        {
+            const long long b = Pattern[j];
+            if (!b)
+                continue;
+
+            for (unsigned int i = 0; i <= j; i++)
+            {
+                const long long a = Pattern[i];
+                if (!a)
+                    continue;
+
+                const double Kij = Matrix[(j + 1) * j / 2 + j - i];
+
+                if (a > 0 && b > 0)
+                    Kii(a, b) += Kij;
+                else if (a > 0)
+                    Kib[(size_t)(-b - 1) * NI + a - 1] += Kij;
+                else if (b > 0)
+                    Kib[(size_t)(-a - 1) * NI + b - 1] += Kij;
+                else
+                {
+                    C.S[(size_t)(-b - 1) * NB - a - 1] += Kij;
+                    if (a != b)
+                        C.S[(size_t)(-a - 1) * NB - b - 1] += Kij;
+                }
+            }
+        }
+
+        Pattern += ND;
+        Matrix += Element->SizeOfStiffnessMatrix();
+    }
+    vector<double>().swap(C.Matrices);
+
+//  X = K_ii^-1 * K_ib, S = K_bb - K_bi * X
+    CLDLTSolver Solver(Kii);
+    if (NI)
+        Solver.LDLT();
+
+    C.X = Kib;
+    if (NI && NB)
+    {
+        Solver.BackSubstitution(C.X.data(), NB);
+
+        Map<MatrixXd>(C.S.data(), NB, NB).noalias() -=
+            Map<MatrixXd>(Kib.data(), NI, NB).transpose() * Map<MatrixXd>(C.X.data(), NI, NB);
+    }
+}
+
+//  Condense the distinct substructures in parallel and assemble the interface matrix
+void CSubstructureSolver::Condense(unsigned int NumThreads)
+{
+    if (NumThreads == 0)
+        NumThreads = max(thread::hardware_concurrency(), 1u);
+
+    atomic<unsigned int> Next(0);
+    auto Worker = [&]()
+    {
+        unsigned int c;
+        while ((c = Next.fetch_add(1)) < Condensed.size())
+            CondenseSubstructure(c);
+    };
+
+    vector<thread> Pool;
+    for (unsigned int t = 1; t < NumThreads && t < Condensed.size(); t++)
+        Pool.push_back(thread(Worker));
+
+    Worker();
+
+    for (auto& t : Pool)
+        t.join();
+
+    for (CSubstructure& Sub : Substructures)
+    {
+        const vector<double>& S = Condensed[Sub.Condensed].S;
+        const size_t NB = Sub.Interface.size();
+
+        for (size_t b = 0; b < NB; b++)
+            for (size_t a = 0; a <= b; a++)
+                (*KBB)(InterfaceNumber[Sub.Interface[a] - 1], InterfaceNumber[Sub.Interface[b] - 1]) +=
+                    S[b * NB + a];
+    }
+
+    for (CCondensed& C : Condensed)
+        vector<double>().swap(C.S);
+}
+
+//  Factorize the interface matrix
+void CSubstructureSolver::Factorize()
+{
+    if (KBB->dim())
+        CLDLTSolver(*KBB).LDLT();
+}
+
+//  Condense the loads to the interface, solve for the interface displacements and recover
+//  the interior displacements of each substructure
+void CSubstructureSolver::Solve(double* Force, unsigned int NRHS)
+{
+    const Index_t NB = KBB->dim();
+
+    for (unsigned int r = 0; r < NRHS; r++)
+    {
+        double* F = Force + (size_t)NEQ * r;
+
+        vector<double> FB(NB);
+        for (Index_t eq = 0; eq < NEQ; eq++)
+            if (InterfaceNumber[eq])
+                FB[InterfaceNumber[eq] - 1] = F[eq];
+
+//      F_B - sum K_bi * K_ii^-1 * f_i, with K_ii^-1 * f_i kept in Y
+        vector<vector<double>> Y(Substructures.size());
+        for (size_t s = 0; s < Substructures.size(); s++)
+        {
+            const CSubstructure& Sub = Substructures[s];
+            CCondensed& C = Condensed[Sub.Condensed];
+            const size_t NI = Sub.Interior.size();
+
+            Y[s].resize(NI);
+            for (size_t i = 0; i < NI; i++)
+                Y[s][i] = F[Sub.Interior[i] - 1];
+
+            for (size_t b = 0; b < Sub.Interface.size(); b++)
+            {
+                double sum = 0.0;
+                for (size_t i = 0; i < NI; i++)
+                    sum += C.X[b * NI + i] * Y[s][i];
+                FB[InterfaceNumber[Sub.Interface[b] - 1] - 1] -= sum;
+            }
+
+            if (NI)
+                CLDLTSolver(*C.Kii).BackSubstitution(Y[s].data());
+        }
+
+        if (NB)
+            CLDLTSolver(*KBB).BackSubstitution(FB.data());
+
+//      u_i = K_ii^-1 * f_i - X * u_b
+        for (size_t s = 0; s < Substructures.size(); s++)
+        {
+            const CSubstructure& Sub = Substructures[s];
+            const CCondensed& C = Condensed[Sub.Condensed];
+            const size_t NI = Sub.Interior.size();
+
+            for (size_t b = 0; b < Sub.Interface.size(); b++)
+            {
+                const double ub = FB[InterfaceNumber[Sub.Interface[b] - 1] - 1];
+                for (size_t i = 0; i < NI; i++)
+                    Y[s][i] -= C.X[b * NI + i] * ub;
+            }
+
+            for (size_t i = 0; i < NI; i++)
+                F[Sub.Interior[i] - 1] = Y[s][i];
+        }
+
+        for (Index_t eq = 0; eq < NEQ; eq++)
+            if (InterfaceNumber[eq])
+                F[eq] = FB[InterfaceNumber[eq] - 1];
+    }
+}
@@ -0,0 +1,102 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#include "ThreadPool.h"
+
+using namespace std;
+
+//  True on the workers of the pool, and on the thread running its tasks on them
+static thread_local bool InPool = false;
+
+CThreadPool::CThreadPool()
+    : Task(nullptr), NumTasks(0), NextTask(0), Pending(0), Generation(0), Stop(false)
+{
+}
+
+CThreadPool& CThreadPool::Instance()
+{
+    static CThreadPool Pool;
+    return Pool;
+}
+
+CThreadPool::~CThreadPool()
+{
+    {
+        lock_guard<mutex> Lock(Mutex);
+        Stop = true;
+    }
+    Start.notify_all();
+
+    for (thread& Worker : Workers)
+        Worker.join();
+}
+
+void CThreadPool::RunTasks(unique_lock<mutex>& Lock)
+{
+    while (NextTask < NumTasks)
+    {
+        const unsigned int t = NextTask++;
+
+        Lock.unlock();
+        (*Task)(t);
+        Lock.lock();
+
+        if (--Pending == 0)
+            Finished.notify_all();
+    }
+}
+
+//  Seen is the generation when the worker was started, so that it takes part in that call
+void CThreadPool::Work(unsigned long long Seen)
+{
+    InPool = true;
+
+    unique_lock<mutex> Lock(Mutex);
+    for (;;)
+    {
+        Start.wait(Lock, [this, &Seen]() { return Stop || Generation != Seen; });
+        if (Stop)
+            return;
+
+        Seen = Generation;
+        RunTasks(Lock);
+    }
+}
+
+void CThreadPool::Run(unsigned int _NumTasks, const function<void(unsigned int)>& _Task)
+{
+    if (_NumTasks <= 1 || InPool || !Busy.try_lock())
+    {
+        for (unsigned int t = 0; t < _NumTasks; t++)
+            _Task(t);
+        return;
+    }
+
+    lock_guard<mutex> Owner(Busy, adopt_lock);
+    InPool = true;
+
+    unique_lock<mutex> Lock(Mutex);
+    while (Workers.size() + 1 < _NumTasks)
+        Workers.push_back(thread(&CThreadPool::Work, this, Generation));
+
+    Task = &_Task;
+    NumTasks = _NumTasks;
+    NextTask = 0;
+    Pending = _NumTasks;
+    Generation++;
+    Start.notify_all();
+
+    RunTasks(Lock);
+    Finished.wait(Lock, [this]() { return Pending == 0; });
+
+    Task = nullptr;
+    NumTasks = NextTask = 0;
+    InPool = false;
+}
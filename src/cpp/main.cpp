@@ -10,8 +10,10 @@
 
 #include <string>
 #include <iostream>
+#include <cstdlib>
 
 #include "Domain.h"
+#include "SolverRegistry.h"
 #include "Outputter.h"
 #include "PostOutputter.h"
 #include "Clock.h"
@@ -20,12 +22,226 @@ using namespace std;
 
 int main(int argc, char *argv[])
 {
+	CDomain* FEMData = CDomain::Instance();
+
 	if (argc < 2) //  Print help message
 	{
-	    cout << "Usage: stap++ InputFileName\n";
+	    cout << "Usage: stap++ InputFileName [-solver Solver] [-block PanelSize]\n"
+	         << "                     [-threads NumThreads] [-parts NumParts] [-ebe cache|recompute]\n"
+	         << "                     [-precond jacobi|block|ic0|amg] [-tol Tolerance] [-maxit MaxIterations]\n"
+	         << "                     [-renumber none|rcm|sloan] [-ordering natural|amd|nd] [-cache CacheFile]\n"
+	         << "                     [-ooc MemoryMB] [-precision double|mixed]\n";
+	    for (const CSolverEntry& Entry : SolverRegistry())
+	        cout << "    -solver " << Entry.Name << " : " << Entry.Description
+	             << (Entry.Type == FEMData->GetSolverType() ? " (default)\n" : "\n");
+	    cout << "    -block PanelSize : factorize the skyline matrix by panels of PanelSize columns\n"
+	         << "    -threads NumThreads : factorize the stiffness matrix, or multiply it in the PCG solver,\n"
+	         << "                          on NumThreads threads (0 : all cores)\n"
+	         << "    -parts NumParts : split each element group into NumParts substructures (default 1)\n"
+	         << "    -ebe recompute : recalculate the element matrices in every product of the ebe solver\n"
+	         << "                     instead of keeping them (default cache)\n"
+	         << "    -precond : Jacobi, nodal block Jacobi, IC(0) or smoothed aggregation AMG preconditioner\n"
+	         << "               of the PCG solver (default ic0)\n"
+	         << "    -tol Tolerance : relative residual tolerance of the PCG solver (default 1e-10)\n"
+	         << "    -maxit MaxIterations : maximum number of PCG iterations (default 10000)\n"
+	         << "    -renumber : number the equations in the input order of the nodes (default), or reorder\n"
+	         << "                the nodes by reverse Cuthill-McKee or Sloan to reduce the skyline profile\n"
+	         << "    -ordering : fill-reducing ordering of the sparse solver, approximate minimum degree\n"
+	         << "                or geometric nested dissection (default)\n"
+	         << "    -cache CacheFile : read the skyline factor from CacheFile if it was written for the same\n"
+	         << "                       nodes, elements and materials, otherwise factorize and write it\n"
+	         << "    -ooc MemoryMB : keep the skyline matrix in the file InputFileName.sky and factorize it\n"
+	         << "                    in column panels using at most about MemoryMB of memory\n"
+	         << "    -precision mixed : factorize the skyline matrix in single precision and refine the\n"
+	         << "                       displacements to double precision (default double)\n";
+#ifdef _VIB_
+	    cout << "    -mass consistent|rowsum|hrz : consistent mass matrix (default), or mass matrix lumped\n"
+	         << "                                  to its diagonal by row sums or by the HRZ scaling\n"
+	         << "    -cutoff Frequency : calculate all the vibration modes below Frequency (Hz) by spectrum\n"
+	         << "                        slicing, instead of the number of modes of the input file\n"
+	         << "    -windows NumWindows : number of frequency windows of -cutoff, solved NumThreads at a\n"
+	         << "                          time (default one per thread)\n"
+	         << "    -dynamics DynFile : integrate the equations of motion in time by the HHT-alpha method\n"
+	         << "                        with the data of DynFile, writing the displacement histories\n"
+	         << "                        to InputFileName.his\n"
+	         << "    -explicit : integrate the equations of motion of -dynamics by the central difference\n"
+	         << "                method with the lumped mass matrix (hrz unless -mass is given), reducing\n"
+	         << "                the time step to 0.9 times the stable time step if it is longer. K is\n"
+	         << "                not assembled, and neither the load cases nor the modes are solved\n";
+#endif
 		exit(1);
 	}
 
+//  Read the optional switches following the input file name
+    CSolverOptions Options;
+    double OutOfCoreMB = 0.0;
+#ifdef _VIB_
+    double CutoffFrequency = 0.0;   // 0 : number of modes of the input file
+    unsigned int NumWindows = 0;
+    string DynamicsFile;
+    bool Explicit = false;
+    bool MassGiven = false;
+#endif
+    for (int i = 2; i < argc; i++)
+    {
+        string option(argv[i]);
+        if (option == "-block" && i + 1 < argc)
+            Options.PanelSize = atoi(argv[++i]);
+        else if (option == "-threads" && i + 1 < argc)
+            Options.NumThreads = atoi(argv[++i]);
+        else if (option == "-parts" && i + 1 < argc)
+            FEMData->SetNumParts(atoi(argv[++i]));
+        else if (option == "-solver" && i + 1 < argc)
+        {
+            string name(argv[++i]);
+            SolverTypes Type;
+            if (FindSolver(name, Type))
+                FEMData->SetSolverType(Type);
+            else
+            {
+                cerr << "*** Error *** Solver " << name << " is not available" << endl;
+                exit(1);
+            }
+        }
+        else if (option == "-renumber" && i + 1 < argc)
+        {
+            string name(argv[++i]);
+            if (name == "none")
+                FEMData->SetNodeOrdering(OrderingTypes::Input);
+            else if (name == "rcm")
+                FEMData->SetNodeOrdering(OrderingTypes::RCM);
+            else if (name == "sloan")
+                FEMData->SetNodeOrdering(OrderingTypes::Sloan);
+            else
+            {
+                cerr << "*** Error *** Ordering " << name << " is not available" << endl;
+                exit(1);
+            }
+        }
+        else if (option == "-ooc" && i + 1 < argc)
+            OutOfCoreMB = atof(argv[++i]);
+        else if (option == "-precision" && i + 1 < argc)
+        {
+            string name(argv[++i]);
+            if (name == "double" || name == "mixed")
+                Options.MixedPrecision = (name == "mixed");
+            else
+            {
+                cerr << "*** Error *** Precision " << name << " is not available" << endl;
+                exit(1);
+            }
+        }
+        else if (option == "-ebe" && i + 1 < argc)
+        {
+            string name(argv[++i]);
+            if (name == "cache" || name == "recompute")
+                Options.CacheElementMatrices = (name == "cache");
+            else
+            {
+                cerr << "*** Error *** Element matrices " << name << " is not available" << endl;
+                exit(1);
+            }
+        }
+        else if (option == "-cache" && i + 1 < argc)
+            Options.CacheFile = argv[++i];
+        else if (option == "-ordering" && i + 1 < argc)
+        {
+            string name(argv[++i]);
+            if (name == "natural")
+                FEMData->SetSparseOrdering(OrderingTypes::Input);
+            else if (name == "amd")
+                FEMData->SetSparseOrdering(OrderingTypes::AMD);
+            else if (name == "nd")
+                FEMData->SetSparseOrdering(OrderingTypes::ND);
+            else
+            {
+                cerr << "*** Error *** Ordering " << name << " is not available" << endl;
+                exit(1);
+            }
+        }
+        else if (option == "-precond" && i + 1 < argc)
+        {
+            string name(argv[++i]);
+            if (name == "jacobi")
+                Options.Preconditioner = PreconditionerTypes::Jacobi;
+            else if (name == "block")
+                Options.Preconditioner = PreconditionerTypes::BlockJacobi;
+            else if (name == "ic0")
+                Options.Preconditioner = PreconditionerTypes::IC0;
+            else if (name == "amg")
+                Options.Preconditioner = PreconditionerTypes::AMG;
+            else
+            {
+                cerr << "*** Error *** Preconditioner " << name << " is not available" << endl;
+                exit(1);
+            }
+        }
+        else if (option == "-tol" && i + 1 < argc)
+            Options.Tolerance = atof(argv[++i]);
+        else if (option == "-maxit" && i + 1 < argc)
+            Options.MaxIterations = atoi(argv[++i]);
+#ifdef _VIB_
+        else if (option == "-mass" && i + 1 < argc)
+        {
+            string name(argv[++i]);
+            MassGiven = true;
+            if (name == "consistent")
+                FEMData->SetMassType(MassTypes::Consistent);
+            else if (name == "rowsum")
+                FEMData->SetMassType(MassTypes::RowSum);
+            else if (name == "hrz")
+                FEMData->SetMassType(MassTypes::HRZ);
+            else
+            {
+                cerr << "*** Error *** Mass matrix " << name << " is not available" << endl;
+                exit(1);
+            }
+        }
+        else if (option == "-cutoff" && i + 1 < argc)
+            CutoffFrequency = atof(argv[++i]);
+        else if (option == "-windows" && i + 1 < argc)
+            NumWindows = atoi(argv[++i]);
+        else if (option == "-dynamics" && i + 1 < argc)
+            DynamicsFile = argv[++i];
+        else if (option == "-explicit")
+            Explicit = true;
+#endif
+        else
+        {
+            cerr << "*** Error *** Unknown option " << option << endl;
+            exit(1);
+        }
+    }
+
+#ifdef _VIB_
+//  Spectrum slicing and the transient analysis work on copies of K, which must be assembled in core
+    if ((CutoffFrequency > 0.0 || !DynamicsFile.empty()) && (!Options.CacheFile.empty() || OutOfCoreMB > 0.0))
+    {
+        cerr << "*** Error *** -cutoff and -dynamics cannot be combined with -cache or -ooc" << endl;
+        exit(1);
+    }
+
+//  The explicit solver needs a lumped mass matrix, and neither K nor the vibration modes
+    if (Explicit)
+    {
+        if (DynamicsFile.empty() || CutoffFrequency > 0.0)
+        {
+            cerr << "*** Error *** -explicit needs -dynamics, and cannot be combined with -cutoff" << endl;
+            exit(1);
+        }
+
+        if (!MassGiven)
+            FEMData->SetMassType(MassTypes::HRZ);
+        else if (FEMData->GetMassType() == MassTypes::Consistent)
+        {
+            cerr << "*** Error *** The explicit solver needs a lumped mass matrix (-mass rowsum or hrz)" << endl;
+            exit(1);
+        }
+
+        FEMData->SetExplicit(true);
+    }
+#endif
+
     string filename(argv[1]);
     if (filename.length() > 4 && filename.substr(filename.length()-4) == ".dat") {
         filename = filename.substr(0, filename.find_last_of('.'));
@@ -34,7 +250,9 @@ int main(int argc, char *argv[])
 	string OutFile = filename + ".out";
 	string PostFile = filename + "_post.dat";
 
-	CDomain* FEMData = CDomain::Instance();
+//  The mixed precision solver needs K in core for the residuals
+    if (OutOfCoreMB > 0.0 && FEMData->GetSolverType() == SolverTypes::LDLT && !Options.MixedPrecision)
+        FEMData->SetOutOfCore(filename + ".sky", size_t(OutOfCoreMB * 1024 * 1024 / sizeof(double)));
 
     Clock timer;
     timer.Start();
@@ -45,6 +263,14 @@ int main(int argc, char *argv[])
 		cerr << "*** Error *** Data input failed!" << endl;
 		exit(1);
 	}
+
+#ifdef _VIB_
+	if (!DynamicsFile.empty() && !FEMData->ReadDynamics(DynamicsFile))
+	{
+		cerr << "*** Error *** Dynamics data input failed!" << endl;
+		exit(1);
+	}
+#endif
     
     double time_input = timer.ElapsedTime();
 
@@ -52,68 +278,107 @@ int main(int argc, char *argv[])
 //  DiagonalAddress and StiffnessMatrix, and calculate the column heights
 //  and address of diagonal elements
 	FEMData->AllocateMatrices();
-    
-//  Assemble the banded gloabl stiffness matrix
-	FEMData->AssembleStiffnessMatrix();
+
+//  The explicit analysis needs neither K nor the static solution of the load cases
+#ifdef _VIB_
+    const bool Static = !Explicit;
+#else
+    const bool Static = true;
+#endif
+
+//  Assemble the banded gloabl stiffness matrix, or what the solver uses instead of it
+    CSolution* Solution = nullptr;
+    if (Static)
+    {
+        Solution = CreateSolution(FEMData->GetSolverType(), Options);
+        Solution->Assemble();
+    }
     
     double time_assemble = timer.ElapsedTime();
 
-//  Solve the linear equilibrium equations for displacements
-#ifdef MKL
-    CSRSolver* Solver = new CSRSolver(FEMData->GetCSRStiffnessMatrix());
-    for (unsigned int lcase = 0; lcase < FEMData->GetNLCASE(); lcase++)
-        FEMData->AssembleForce(lcase + 1);
-    Solver->solve(FEMData->GetDisplacement(), FEMData->GetNLCASE());
-#else
-    CLDLTSolver* Solver = new CLDLTSolver(FEMData->GetStiffnessMatrix());
-    Solver->LDLT();
+#ifdef _VIB_
+	FEMData->AssembleMassMatrix();
+
+//  Spectrum slicing factorizes shifted copies of K, so it runs before K itself is factorized
+	if (CutoffFrequency > 0.0 && !FEMData->SliceSpectrum(CutoffFrequency, NumWindows, Options.NumThreads))
+	{
+		cerr << "*** Error *** Spectrum slicing failed" << endl;
+		exit(9);
+	}
+
+	if (!DynamicsFile.empty())
+	{
+		const bool Solved = Explicit ? FEMData->ExplicitSolver(filename + ".his", Options.NumThreads)
+		                             : FEMData->TransientSolver(filename + ".his", Options.NumThreads);
+		if (!Solved)
+		{
+			cerr << "*** Error *** Transient analysis failed" << endl;
+			exit(9);
+		}
+	}
 #endif
 
+//  Solve the linear equilibrium equations for displacements
+    if (Static)
+        Solution->Factorize();
 
     COutputter* Output = COutputter::Instance();
 
 	PostOutputter* PostOutput = PostOutputter::Instance(PostFile);
 
 #ifdef _DEBUG_
-    Output->PrintStiffnessMatrix();
+    if (Static)
+        Output->PrintStiffnessMatrix();
 #endif
 #ifdef _VIB_
-	FEMData->AssembleMassMatrix();
-
 #ifdef _DEBUG_
 	Output->PrintMassMatrix();
 #endif
 
-	if (!FEMData->VibSolver(FEMData->GetNumEig())){
+	if (!DynamicsFile.empty() && Explicit)
+		*Output << " EXPLICIT ANALYSIS : " << FEMData->GetNumSteps() << " STEPS OF " << FEMData->GetTimeStep()
+		        << " (STABLE TIME STEP " << FEMData->GetStableTimeStep() << "), HISTORIES WRITTEN TO "
+		        << filename << ".his" << endl << endl;
+	else if (!DynamicsFile.empty())
+		*Output << " TRANSIENT ANALYSIS : " << FEMData->GetNumSteps() << " STEPS OF " << FEMData->GetTimeStep()
+		        << ", HISTORIES WRITTEN TO " << filename << ".his" << endl << endl;
+
+	if (CutoffFrequency > 0.0)
+		*Output << " VIBRATION MODES BELOW " << CutoffFrequency << " HZ = " << FEMData->GetNumEig()
+		        << endl << endl;
+	else if (!Explicit && !FEMData->VibSolver(FEMData->GetNumEig(), Solution->GetSkylineSolver())){
 	    exit(9);
 		cout<< "ERROR: MKL SOLVER FAILED FOR SINGULARITY OR SOMETHING ELSE"<<endl;
 	}
 #endif
 
 //  Loop over for all load cases
-    for (unsigned int lcase = 0; lcase < FEMData->GetNLCASE(); lcase++)
+    for (unsigned int lcase = 0; Static && lcase < FEMData->GetNLCASE(); lcase++)
     {
-//      Assemble righ-hand-side vector (force vector)
-#ifndef MKL
-        FEMData->AssembleForce(lcase + 1);
-        Solver->BackSubstitution(FEMData->GetForce());
-#endif
+//      Assemble righ-hand-side vector (force vector) and solve for the displacements
+        Solution->Solve(lcase);
 
 #ifdef _DEBUG_ 
         Output->PrintDisplacement(lcase);
 #endif
 
         Output->OutputNodalDisplacement(lcase);
+
+        Solution->Report(*Output);
     }
 
+    delete Solution;
+
 #ifdef _VIB_
-	Output->OutputVibDisps();
+	if (!Explicit)
+		Output->OutputVibDisps();
 #endif
     double time_solution = timer.ElapsedTime();
 
 #ifndef _RUN_
 //  Calculate and output stresses of all elements
-	Output->OutputElementStress();
+	if (Static)
+		Output->OutputElementStress();
 #endif    
 
 #ifdef _POST_
@@ -0,0 +1,88 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+#include "PCGSolver.h"
+
+//! Smoothed aggregation algebraic multigrid preconditioner (one V-cycle per application)
+/*! The nodes are grouped into aggregates of strongly coupled neighbours. On each aggregate
+    the near null space (the rigid body modes of the nodes) is orthonormalized to give the
+    tentative prolongator, which is smoothed by one damped Jacobi step. Coarse matrices are
+    the Galerkin products P^T*A*P. The V-cycle uses a forward Gauss-Seidel sweep before and
+    a backward sweep after the coarse correction, so the preconditioner is symmetric. */
+class CAMGPreconditioner : public CPreconditioner
+{
+protected:
+    //! Sparse matrix stored by rows, indices numbered from 0
+    struct CSparseRows
+    {
+        int Rows, Columns;
+        std::vector<CSRIndex_t> Start;  //!< Row starts, which exceed int for large levels
+        std::vector<int> Index;
+        std::vector<double> Value;
+
+        //! y = A * x
+        void Multiply(const double* x, double* y) const;
+    };
+
+    //! Level l holds its matrix and the prolongator from level l+1
+    struct CLevel
+    {
+        CSparseRows A, P, R;        //!< R = P^T
+        std::vector<CSRIndex_t> Diagonal;  //!< Position of the diagonal entry of each row of A
+        std::vector<double> x, b, r;
+    };
+
+    std::vector<CLevel> Levels;
+
+    //! Inverse (dense, column major) of the coarsest matrix, if it is small enough
+    std::vector<double> CoarseInverse;
+
+    //! Coarsening stops when a level has no more than CoarseSize equations
+    static const int CoarseSize = 500;
+
+    //! C = A * B
+    static void Product(const CSparseRows& A, const CSparseRows& B, CSparseRows& C);
+
+    //! T = A^T
+    static void Transpose(const CSparseRows& A, CSparseRows& T);
+
+    //! Build the next level from level l
+    /*! Block b of level l holds the equations BlockIndex[BlockStart[b]:BlockStart[b+1]-1],
+        and NullSpace is the near null space of level l (Rows x NumModes, row major).
+        They are replaced by those of the coarse level. Return false if it does not coarsen. */
+    bool Coarsen(std::size_t l, std::vector<int>& BlockStart, std::vector<int>& BlockIndex,
+                 std::vector<double>& NullSpace, int NumModes, double Theta);
+
+    //! Perform a V-cycle on level l: solve Levels[l].A * x = b approximately from x = 0
+    void Cycle(std::size_t l);
+
+    //! Gauss-Seidel sweep on level l, forward or backward
+    void GaussSeidel(std::size_t l, bool Forward);
+
+public:
+    //! Constructor
+    /*! The blocks group the equations (numbered from 0) of each node, and NullSpace holds
+        NumModes near null space vectors of K (K.size x NumModes, row major). */
+    CAMGPreconditioner(CSRMatrix<double>& K, const std::vector<int>& BlockStart,
+                       const std::vector<int>& BlockIndex, const std::vector<double>& NullSpace,
+                       int NumModes);
+
+    virtual void Apply(const double* r, double* z);
+
+    //! Return the number of levels
+    std::size_t GetNumLevels() const { return Levels.size(); }
+
+    //! Return the ratio of the nonzeros of all levels to those of the finest level
+    double GetOperatorComplexity() const;
+};
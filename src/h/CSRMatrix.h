@@ -4,37 +4,64 @@
 #include <vector>
 #include <set>
 #include <algorithm>
+#include <limits>
+#include <cstdlib>
 
 #include "SparseMatrix.h"
+#include "SkylineKernels.h"
 
 #define CSR_USE_VECTOR
 
 #ifdef CSR_USE_VECTOR
-typedef std::vector<int> STL_t;
+typedef std::vector<CSRIndex_t> STL_t;
 #define CSR_OPT push_back
 #else
-typedef std::set<int> STL_t;
+typedef std::set<CSRIndex_t> STL_t;
 #define CSR_OPT insert
 #endif
 
+//! Add xr*a[k] to row index[k]-1 of z (zv[i-lo] being row i) for k = 0:n-1 and return the sum
+//! of a[k]*xv[index[k]-1]
+template <typename T>
+inline T CSRRowProduct(const T* a, const CSRIndex_t* index, const T* xv, T* zv, T xr, CSRIndex_t lo, CSRIndex_t n)
+{
+    T sum = 0;
+    for (CSRIndex_t k = 0; k < n; ++k)
+    {
+        const CSRIndex_t c = index[k] - 1;
+        sum += a[k] * xv[c];
+        zv[c - lo] += a[k] * xr;
+    }
+
+    return sum;
+}
+
+//! The double rows use the vectorized kernels, the loop above not being vectorized by the
+//! compiler because of the reduction and of the indirect accesses
+inline double CSRRowProduct(const double* a, const CSRIndex_t* index, const double* xv, double* zv, double xr,
+                            CSRIndex_t lo, CSRIndex_t n)
+{
+    return SparseRowProduct(a, index, n, xv, zv, lo, xr);
+}
+
 template <typename T> class CSRMatrix : public SparseMatrix<T>
 {
 private:
     STL_t* _tempColumns;
 
 public:
-    int size;
-    int elementCount;
+    CSRIndex_t size;
+    CSRIndex_t elementCount;
     T* values;
-    int* columns;
-    int* rowIndexs;
+    CSRIndex_t* columns;
+    CSRIndex_t* rowIndexs;
 
-    CSRMatrix(int m) : SparseMatrix<T>(m)
+    CSRMatrix(CSRIndex_t m) : SparseMatrix<T>(m)
     {
         size = m;
         values = nullptr;
         columns = nullptr;
-        rowIndexs = new int[size + 1];
+        rowIndexs = new CSRIndex_t[size + 1];
         _tempColumns = nullptr;
     }
 
@@ -48,7 +75,7 @@ public:
 
     }
 
-    void markPosition(int row, int column)
+    void markPosition(CSRIndex_t row, CSRIndex_t column)
     {
         // insert column
         _tempColumns[row - 1].CSR_OPT(column);
@@ -57,27 +84,33 @@ public:
     void allocate()
     {
         #ifdef CSR_USE_VECTOR
-        for (int row = 0; row < size; ++row)
+        for (CSRIndex_t row = 0; row < size; ++row)
         {
-            std::vector<int>& v = _tempColumns[row];
+            std::vector<CSRIndex_t>& v = _tempColumns[row];
             std::sort(v.begin(), v.end());
             v.erase(std::unique(v.begin(), v.end()), v.end());
         }
         #endif
         // first, calculate row indexs. Notice row index starts from 1
         rowIndexs[0] = 1;
-        for (int row = 0; row < size; ++row)
+        for (CSRIndex_t row = 0; row < size; ++row)
         {
-            rowIndexs[row + 1] = rowIndexs[row] + int(_tempColumns[row].size());
+            if (_tempColumns[row].size() >= std::size_t(std::numeric_limits<CSRIndex_t>::max() - rowIndexs[row]))
+            {
+                std::cerr << "*** Error *** The CSR matrix has more entries than CSRIndex_t can address,"
+                          << std::endl << "    rebuild with STAP++_INDEX64" << std::endl;
+                exit(6);
+            }
+            rowIndexs[row + 1] = rowIndexs[row] + CSRIndex_t(_tempColumns[row].size());
         }
 
         // allocate columns
         elementCount = rowIndexs[size] - rowIndexs[0];
-        columns = new int[elementCount];
+        columns = new CSRIndex_t[elementCount];
 
         // write columns
-        int count = 0;
-        for (int row = 0; row < size; ++row)
+        CSRIndex_t count = 0;
+        for (CSRIndex_t row = 0; row < size; ++row)
         {
             // column already sorted in _tempColumns
             for (const auto& column : _tempColumns[row])
@@ -93,26 +126,26 @@ public:
 
         // allocate values last to save memory
         values = new T[elementCount];
-        for (int i = 0; i < elementCount; ++i)
+        for (CSRIndex_t i = 0; i < elementCount; ++i)
             values[i] = T(0);
     }
 
     // get item at (row, column)
-    T& operator()(unsigned row, unsigned column)
+    T& operator()(Index_t row, Index_t column)
     {
         if (row > column)
         {
             return this->operator()(column, row);
         }
-        int offset1 = rowIndexs[row - 1] - 1;
-        int offset2 = rowIndexs[row] - 1;
+        CSRIndex_t offset1 = rowIndexs[row - 1] - 1;
+        CSRIndex_t offset2 = rowIndexs[row] - 1;
         // index lies in [offset1, offset2)
         // find index by bisection
 
         while (offset2 != (offset1 + 1))
         {
-            int offset = (offset1 + offset2) / 2;
-            if (columns[offset] > int(column))
+            CSRIndex_t offset = (offset1 + offset2) / 2;
+            if (columns[offset] > CSRIndex_t(column))
             {
                 offset2 = offset;
             }
@@ -125,7 +158,42 @@ public:
         return values[offset1];
     }
 
-    int dim() const { return size; }
+    CSRIndex_t dim() const { return size; }
+
+    // y = A * x, where A is the symmetric matrix whose upper triangle is stored, for NRHS
+    // vectors stored one after another, on NumThreads threads (0: all hardware threads).
+    // The diagonal is the first entry of each row
+    void multiply(const T* x, T* y, unsigned int NRHS = 1, unsigned int NumThreads = 1) const
+    {
+        const CSRIndex_t N = size;
+
+        auto Start = [this](Index_t row) { return rowIndexs[row]; };
+
+        // Row i reaches the columns i up to its last entry
+        auto Range = [this](Index_t r0, Index_t r1, Index_t& lo, Index_t& hi) {
+            lo = r0;
+            hi = r1;
+            for (Index_t row = r0; row < r1; ++row)
+                hi = std::max(hi, Index_t(columns[rowIndexs[row + 1] - 2]));
+        };
+
+        auto Kernel = [this, x, N, NRHS](Index_t r0, Index_t r1, Index_t lo, T* z, Index_t ldz) {
+            for (unsigned int v = 0; v < NRHS; ++v)
+            {
+                const T* xv = x + (std::size_t)v * N;
+                T* zv = z + (std::size_t)v * ldz;     // zv[i - lo] is row i
+                for (Index_t row = r0; row < r1; ++row)
+                {
+                    const CSRIndex_t p0 = rowIndexs[row] - 1, p1 = rowIndexs[row + 1] - 1;
+                    const T xr = xv[row];
+                    zv[row - lo] += values[p0] * xr
+                                  + CSRRowProduct(values + p0 + 1, columns + p0 + 1, xv, zv, xr, CSRIndex_t(lo), p1 - p0 - 1);
+                }
+            }
+        };
+
+        SymmetricProduct(Index_t(N), y, NRHS, NumThreads, Start, Range, Kernel);
+    }
 
     ~CSRMatrix()
     {
@@ -139,17 +207,17 @@ template <typename T> std::ostream& operator<<(std::ostream& out, const CSRMatri
 {
     out << "CSR Matrix, size = " << mat.size << std::endl;
     out << "values = " << std::endl << "(";
-    for (int i = 0; i < mat.elementCount; ++i)
+    for (CSRIndex_t i = 0; i < mat.elementCount; ++i)
     {
         out << std::setw(14) << mat.values[i];
     }
     out << ")\ncolumns = \n(";
-    for (std::size_t i = 0; i < mat.elementCount; ++i)
+    for (CSRIndex_t i = 0; i < mat.elementCount; ++i)
     {
         out << std::setw(14) << mat.columns[i];
     }
     out << ")\nrowIndexs = \n(";
-    for (std::size_t i = 0; i <= mat.size; ++i)
+    for (CSRIndex_t i = 0; i <= mat.size; ++i)
     {
         out << std::setw(14) << mat.rowIndexs[i];
     }
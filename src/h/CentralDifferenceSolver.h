@@ -0,0 +1,93 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "ElementGroup.h"
+
+#ifdef _VIB_
+
+//! Explicit linear dynamics M a + C v + K u = F(t) by the central difference method
+/*! With the lumped mass matrix, the accelerations are
+        a_n+1 = M^-1 (F_n+1 - K (u_n+1 + DampingK v_n+1/2)) - DampingM v_n+1/2,
+    the velocities being those of the half steps, v_n+1/2 = v_n-1/2 + dt a_n, and
+    u_n+1 = u_n + dt v_n+1/2. Nothing is factorized: the internal forces are summed element by
+    element from the element stiffness matrices, which are calculated once and kept. The element
+    forces are calculated on NumThreads threads into their own slots, and then gathered equation
+    by equation in the order of the elements, so the results do not depend on the number of
+    threads. The step is conditionally stable, below 2/omega_max (reduced by the damping), where
+    omega_max is bounded by the highest frequency of the elements. */
+class CCentralDifferenceSolver
+{
+protected:
+    //! All elements of the model
+    std::vector<CElement*> Elements;
+
+    Index_t N;
+
+    //! Diagonal of the lumped mass matrix, and the lumping of the element mass matrices
+    const double* LumpedM;
+    MassTypes MassType;
+
+    double DampingM, DampingK;
+
+    unsigned int NumThreads;
+
+    //! Matrix of element e is stored in Matrices from MatrixStart[e]
+    std::vector<std::size_t> MatrixStart;
+    std::vector<double> Matrices;
+
+    //! Forces of element e are stored in ElementForces from ForceStart[e]
+    std::vector<std::size_t> ForceStart;
+    std::vector<double> ElementForces;
+
+    //! Slots of ElementForces summed up to equation i: GatherIndex[GatherStart[i]:GatherStart[i+1]-1]
+    std::vector<std::size_t> GatherStart, GatherIndex;
+
+    double TimeStep, Time;
+    bool FirstStep;
+
+    //! Displacements, velocities of the half step and accelerations
+    std::vector<double> U, V, A;
+
+    //! Displacements the elastic and damping forces are calculated from, u + DampingK v
+    std::vector<double> W;
+
+    //! Run Task(begin, end) over [0, Size) split into NumThreads ranges, on the threads of CThreadPool
+    template <class Task_>
+    void ForEach(std::size_t Size, Task_ Task);
+
+public:
+    //! Constructor
+    CCentralDifferenceSolver(CElementGroup* EleGrpList, unsigned int NUMEG, Index_t NEQ,
+                             const double* _LumpedM, MassTypes _MassType, double _DampingM = 0.0,
+                             double _DampingK = 0.0, unsigned int _NumThreads = 1);
+
+    //! Return the stable time step, 2/omega_max reduced for the damping, omega_max being the
+    //! highest frequency of the elements with their lumped mass matrices
+    double StableTimeStep();
+
+    //! Start from rest (u = v = 0) at t = 0 under the loads Force
+    void Initialize(double _TimeStep, const double* Force);
+
+    //! Advance one step, NextForce being the loads at the next time
+    void Step(const double* NextForce);
+
+    //! Return the current time
+    inline double GetTime() const { return Time; }
+
+    //! Return the current displacements (NEQ entries)
+    inline const double* GetDisplacement() const { return U.data(); }
+};
+
+#endif
@@ -26,13 +26,15 @@
 #include "LoadCaseData.h"
 #include "SkylineMatrix.h"
 #include "CSRMatrix.h"
+#include "Ordering.h"
+#include "Substructure.h"
 #include "Eigen/Dense"
 
 
 using namespace std;
 
 //!	Clear an array
-template <class type> void clear( type* a, unsigned int N );
+template <class type> void clear( type* a, size_t N );
 
 //!	Domain class : Define the problem domain
 /*!	Only a single instance of Domain class can be created */
@@ -77,13 +79,23 @@ private:
 	unsigned int* NLOAD;
 
 //!	Total number of equations in the system
-	unsigned int NEQ;
+	Index_t NEQ;
+
+//!	Number of equations of the internal nodes condensed out of the system, numbered
+//!	NEQ+1 ... NEQ+NCEQ after the equations of the system
+	Index_t NCEQ;
+
+//!	CondensedNode[np] is true if the DOFs of node np are condensed out of the system
+	vector<bool> CondensedNode;
+
+//!	Displacements of all equations, the condensed ones included (only used if NCEQ > 0)
+	vector<double> FullDisplacement;
 
 //!	Number of elements in banded global stiffness matrix
-	unsigned int NWK;
+	Index_t NWK;
 
 //!	Maximum half bandwith
-	unsigned int MK;
+	Index_t MK;
 
 //!	Banded stiffness matrix
 /*! A one-dimensional array storing only the elements below the	skyline of the 
@@ -91,24 +103,107 @@ private:
     CSkylineMatrix<double>* StiffnessMatrix;
 
 
+//!	CSR stiffness matrix (upper triangular part), used by the sparse solvers
 	CSRMatrix<double>* CSRStiffnessMatrix;
 
+//!	Solver of the global equilibrium equations, which decides the storage of the stiffness matrix
+	SolverTypes SolverType;
+
+//!	Substructures of the substructuring solver, which replace the global stiffness matrix
+	CSubstructureSolver* Substructures;
+
+//!	Number of substructures each element group is split into
+	unsigned int NumParts;
+
+//!	Ordering of the nodes used to number the equations
+	OrderingTypes NodeOrdering;
+
+//!	Skyline profile and maximum half bandwidth of the input and of the reordered numbering
+//!	(only calculated if NodeOrdering is not Input)
+	unsigned long long InputProfile, OrderedProfile;
+	Index_t InputBandwidth, OrderedBandwidth;
+
+//!	True if the reordering did not reduce the profile and the input order was kept
+	bool InputOrderKept;
+
+//!	Fill-reducing ordering used by the sparse solver
+	OrderingTypes SparseOrdering;
+
+//!	EquationOrder[k] is the equation (numbered from 0) eliminated k-th by the sparse solver
+	vector<int> EquationOrder;
+
+//!	Entries of L and floating point operations predicted for EquationOrder
+	double PredictedFill, PredictedFlops;
+
+//!	True if the solver was chosen by ChooseSolver
+	bool SolverChosen;
+
+//!	Estimates ChooseSolver decided from: entries and operations of the skyline factor, entries
+//!	of the CSR stiffness matrix and available memory in bytes (0: unknown)
+	double SkylineFill, SkylineFlops, CSREntries, AvailableMemory;
+
+//!	Memory in bytes and floating point operations estimated for the chosen solver
+//!	(operations per iteration for the PCG solver)
+	double EstimatedMemory, EstimatedFlops;
+
 #ifdef _VIB_
     //Banded mass matrix
     CSkylineMatrix<double>* MassMatrix;
 
+//!	Diagonal of the lumped mass matrix (NEQ entries), used instead of MassMatrix if MassType is
+//!	RowSum or HRZ
+	double* LumpedMass;
+
+	MassTypes MassType;
+
+//!	True if the explicit solver is the only one run, which needs neither K nor its profile
+	bool Explicit;
+
 	//Vibration displacement modes
 	double* VibDisp;
 
 	double* EigenValues;
 
 	int numEig;
+
+//!	Time integration of the transient analysis: number of steps, step size and HHT parameter
+	unsigned int NumSteps;
+	double TimeStep;
+	double HHTAlpha;
+
+//!	Stable time step of the explicit solver
+	double StableTimeStep;
+
+//!	Rayleigh damping C = DampingM*M + DampingK*K
+	double DampingM, DampingK;
+
+//!	Node and DOF (numbered from 1) of the displacement histories written to the history file
+	vector<unsigned int> HistoryNode, HistoryDOF;
+
+//!	Sum the load cases multiplied by their time functions at time t into F
+	void TransientLoads(double t, vector<double>& F);
+
+//!	Open the history file and write its header
+	bool OpenHistory(ofstream& History, const string& HistoryFile);
+
+//!	Write the displacements U of the history DOFs at time t
+	void WriteHistory(ofstream& History, double t, const double* U);
 #endif
 
 
 //!	Global nodal force/displacement vector
 	double* Force;
 
+//!	Hash of the nodal, element and material data and of the options deciding the equation
+//!	numbers, which identifies the stiffness matrix of the model
+	unsigned long long ModelKey;
+
+//!	Memory budget (number of entries) of the out-of-core skyline matrix (0: in core)
+	size_t OutOfCoreBudget;
+
+//!	File keeping the out-of-core skyline matrix
+	string OutOfCoreFile;
+
 public:
 
 //!	Constructor
@@ -135,6 +230,33 @@ public:
 //!	Calculate global equation numbers corresponding to every degree of freedom of each node
 	void CalculateEquationNumber();
 
+//!	Find the internal nodes to be condensed out of the system by their elements
+	void FindCondensedNodes();
+
+//!	Number the active DOFs node by node, Order[k] being the k-th node (numbered from 0),
+//!	where BoundaryCodes holds the input bcode of all nodes
+	void NumberEquations(const vector<unsigned int>& Order, const vector<unsigned int>& BoundaryCodes);
+
+//!	Build the adjacency graph of the nodes (numbered from 0) connected by the elements
+	void NodeGraph(vector<int>& Start, vector<int>& Index);
+
+//!	Reorder the nodes on their adjacency graph with NodeOrdering to reduce the skyline profile
+	void OrderNodes(vector<unsigned int>& Order);
+
+//!	Calculate EquationOrder with SparseOrdering on the graph of the nodes with active DOFs,
+//!	and predict the fill and operations of the factorization
+	void CalculateSparseOrdering();
+
+//!	Calculate the skyline profile and the maximum half bandwidth of the current equation numbers,
+//!	and the floating point operations of the skyline factorization if Flops is given
+	void CalculateProfile(unsigned long long& Profile, Index_t& Bandwidth, double* Flops = nullptr);
+
+//!	Replace the Auto solver type by the skyline, sparse or PCG solver
+/*!	Small models are solved by the skyline solver if its factor fits into memory. Otherwise
+	the direct solver whose factor fits into half of the available memory with the fewest
+	operations is chosen, or the PCG solver if none fits. */
+	void ChooseSolver();
+
 //!	Calculate column heights
 	void CalculateColumnHeights();
 
@@ -146,6 +268,14 @@ public:
 
 	void CalculateCSRColumns();
 
+//!	Collect the equation numbers (numbered from 0) of the active DOFs of each node:
+//!	node block b holds BlockIndex[BlockStart[b]:BlockStart[b+1]-1]
+	void GetNodalEquations(vector<int>& BlockStart, vector<int>& BlockIndex);
+
+//!	Collect the rigid body modes (translations and rotations about the centroid) restricted
+//!	to the active DOFs as a NEQ x NumModes row major array, and return NumModes
+	unsigned int GetRigidBodyModes(vector<double>& Modes);
+
 //! Allocate storage for matrices
 /*!	Allocate Force, ColumnHeights, DiagonalAddress and StiffnessMatrix and 
     calculate the column heights and address of diagonal elements */
@@ -154,6 +284,13 @@ public:
 //!	Assemble the banded gloabl stiffness matrix
 	void AssembleStiffnessMatrix();
 
+//!	Write the factored skyline stiffness matrix and the equation numbers to a cache file
+	bool WriteFactorCache(const string& FileName);
+
+//!	Read the factored skyline stiffness matrix from a cache file (after AllocateMatrices).
+//!	Return false if the file does not exist or was written for another model
+	bool ReadFactorCache(const string& FileName);
+
 #ifdef _VIB_
 //!	Assemble the banded global mass matrix
 	void AssembleMassMatrix();
@@ -162,6 +299,69 @@ public:
 //!	Assemble the global nodal force vector for load case LoadCase
 	bool AssembleForce(unsigned int LoadCase); 
 
+//!	Set the solver type (must be called before ReadData)
+	inline void SetSolverType(SolverTypes Type) { SolverType = Type; }
+
+//!	Return the solver type
+	inline SolverTypes GetSolverType() { return SolverType; }
+
+//!	Set the number of substructures each element group is split into (must be called before ReadData)
+	inline void SetNumParts(unsigned int Parts) { NumParts = Parts; }
+
+//!	Return the substructures of the substructuring solver
+	inline CSubstructureSolver& GetSubstructures() { return *Substructures; }
+
+//!	Set the ordering of the nodes used to number the equations (must be called before ReadData)
+	inline void SetNodeOrdering(OrderingTypes Type) { NodeOrdering = Type; }
+
+//!	Return the ordering of the nodes
+	inline OrderingTypes GetNodeOrdering() { return NodeOrdering; }
+
+//!	Return the skyline profile and maximum half bandwidth before and after reordering the nodes
+	inline unsigned long long GetInputProfile() { return InputProfile; }
+	inline Index_t GetInputBandwidth() { return InputBandwidth; }
+	inline unsigned long long GetOrderedProfile() { return OrderedProfile; }
+	inline Index_t GetOrderedBandwidth() { return OrderedBandwidth; }
+	inline bool IsInputOrderKept() { return InputOrderKept; }
+
+//!	Set the fill-reducing ordering of the sparse solver (must be called before ReadData)
+	inline void SetSparseOrdering(OrderingTypes Type) { SparseOrdering = Type; }
+
+//!	Return the fill-reducing ordering of the sparse solver
+	inline OrderingTypes GetSparseOrdering() { return SparseOrdering; }
+
+//!	Return the elimination order of the equations for the sparse solver
+	inline const vector<int>& GetEquationOrder() { return EquationOrder; }
+
+//!	Return the predicted entries of L and floating point operations of the sparse factorization
+	inline double GetPredictedFill() { return PredictedFill; }
+	inline double GetPredictedFlops() { return PredictedFlops; }
+
+//!	Return true if the solver was chosen by ChooseSolver
+	inline bool IsSolverChosen() { return SolverChosen; }
+
+//!	Return the estimates the solver was chosen from
+	inline double GetSkylineFill() { return SkylineFill; }
+	inline double GetSkylineFlops() { return SkylineFlops; }
+	inline double GetCSREntries() { return CSREntries; }
+	inline double GetAvailableMemory() { return AvailableMemory; }
+
+//!	Return the memory (bytes) and operations estimated for the chosen solver
+	inline double GetEstimatedMemory() { return EstimatedMemory; }
+	inline double GetEstimatedFlops() { return EstimatedFlops; }
+
+//!	Keep the skyline stiffness matrix in file FileName with at most Budget entries in memory
+	inline void SetOutOfCore(const string& FileName, size_t Budget) { OutOfCoreFile = FileName; OutOfCoreBudget = Budget; }
+
+//!	Return the memory budget (number of entries) of the out-of-core skyline matrix (0: in core)
+	inline size_t GetOutOfCoreBudget() { return OutOfCoreBudget; }
+
+//!	Release the skyline stiffness matrix and its out-of-core file once the equations are solved
+	inline void ReleaseStiffnessMatrix() { delete StiffnessMatrix; StiffnessMatrix = nullptr; }
+
+//!	Return the key of the stiffness matrix of the model
+	inline unsigned long long GetModelKey() { return ModelKey; }
+
 //!	Return solution mode
 	inline unsigned int GetMODEX() { return MODEX; }
 
@@ -169,16 +369,19 @@ public:
 	inline string GetTitle() { return Title; }
 
 //!	Return the total number of equations
-	inline unsigned int GetNEQ() { return NEQ; }
+	inline Index_t GetNEQ() { return NEQ; }
+
+//!	Return the number of condensed equations
+	inline Index_t GetNCEQ() { return NCEQ; }
 
 //!	Return the total number of nodal points
 	inline unsigned int GetNUMNP() { return NUMNP; }
 
 //!	Return the number of banded global stiffness matrix elements
-	inline unsigned int GetNWK() { return NWK; }
+	inline Index_t GetNWK() { return NWK; }
 
 //!	Return the maximum half bandwith
-	inline unsigned int GetMK() { return MK; }
+	inline Index_t GetMK() { return MK; }
 
 //!	Return the node list
 	inline CNode* GetNodeList() { return NodeList; }
@@ -189,11 +392,14 @@ public:
 //! Return element group list
     CElementGroup* GetEleGrpList() { return EleGrpList; }
 
-//!	Return pointer to the global nodal force vector
-	inline double* GetForce() { return Force; }
+//!	Return pointer to the global nodal force vector of load case lcase (numbered from 0)
+/*!	The vectors of all load cases are stored one after another (NEQ x NLCASE, column major) */
+	inline double* GetForce(unsigned int lcase = 0) { return Force + (size_t)NEQ * lcase; }
 
-//!	Return pointer to the global nodal displacement vector
-	inline double* GetDisplacement() { return Force; }
+//!	Return pointer to the global nodal displacement vector of load case lcase (numbered from 0)
+/*!	If internal nodes are condensed, their displacements are recovered element by element
+	into a vector of NEQ + NCEQ equations, which is valid until the next call */
+	double* GetDisplacement(unsigned int lcase = 0);
 
 //!	Return the total number of load cases
 	inline unsigned int GetNLCASE() { return NLCASE; }
@@ -210,8 +416,15 @@ public:
 	CSRMatrix<double>& GetCSRStiffnessMatrix() { return *CSRStiffnessMatrix; }
 
 #ifdef _VIB_
-//! Subspace Iteration Method
-    bool VibSolver(unsigned int NVibModes);
+//!	Calculate the lowest NVibModes vibration modes by the block Lanczos eigensolver, applying
+//!	K^-1 with the factor of KSolver, or with the factor of a copy of K calculated here if KSolver
+//!	is null (K not factorized, or factorized in single precision)
+    bool VibSolver(unsigned int NVibModes, CLDLTSolver* KSolver = nullptr);
+
+//!	Calculate all the vibration modes below CutoffFrequency (Hz) by spectrum slicing over
+//!	NumWindows frequency windows (0: one per thread), NumThreads of them at a time (0: all
+//!	hardware threads). Must be called before K is factorized
+    bool SliceSpectrum(double CutoffFrequency, unsigned int NumWindows, unsigned int NumThreads);
 
 	inline double* GetVibDisp() {return VibDisp;}
 
@@ -219,9 +432,43 @@ public:
 
 	bool ReadVibNum();
 
+//!	Read the time integration parameters, the time functions of the load cases and the DOFs
+//!	whose histories are written, from the dynamics data file FileName
+	bool ReadDynamics(const string& FileName);
+
+//!	Integrate M a + C v + K u = F(t) from rest by the HHT-alpha method on NumThreads threads,
+//!	writing the displacement histories to HistoryFile. Must be called before K is factorized
+	bool TransientSolver(const string& HistoryFile, unsigned int NumThreads);
+
+//!	Integrate M a + C v + K u = F(t) from rest by the central difference method with the lumped
+//!	mass matrix, on NumThreads threads, writing the displacement histories to HistoryFile
+	bool ExplicitSolver(const string& HistoryFile, unsigned int NumThreads);
+
+//!	Return the number of time steps and the step size of the transient analysis
+	inline unsigned int GetNumSteps() { return NumSteps; }
+	inline double GetTimeStep() { return TimeStep; }
+
+//!	Return the stable time step of the explicit solver
+	inline double GetStableTimeStep() { return StableTimeStep; }
+
 	inline unsigned int GetNumEig() {return numEig;}
 
 	CSkylineMatrix<double>& GetMassMatrix() { return *MassMatrix; }
 
+//!	Set the consistent or lumped mass matrix (must be called before ReadData)
+	inline void SetMassType(MassTypes Type) { MassType = Type; }
+
+//!	Return the type of mass matrix
+	inline MassTypes GetMassType() { return MassType; }
+
+//!	Skip the stiffness matrix for an explicit analysis (must be called before ReadData)
+	inline void SetExplicit(bool _Explicit) { Explicit = _Explicit; }
+
+//!	Return true if the stiffness matrix is skipped for an explicit analysis
+	inline bool IsExplicit() { return Explicit; }
+
+//!	Return the diagonal of the lumped mass matrix (nullptr for the consistent mass matrix)
+	inline double* GetLumpedMass() { return LumpedMass; }
+
 #endif
 };
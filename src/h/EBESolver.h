@@ -0,0 +1,50 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "ElementGroup.h"
+#include "PCGSolver.h"
+
+//! Matrix-free element-by-element PCG solver
+/*! The global stiffness matrix is never assembled: K*x is summed element by element from
+    the element stiffness matrices, which are kept (upper triangles, as returned by
+    ElementStiffness) if CacheMatrices is true, or recalculated in every product otherwise.
+    The Jacobi preconditioner is assembled from the diagonals of the element matrices. */
+class CEBESolver : public CPCGSolver
+{
+protected:
+    //! All elements of the model
+    std::vector<CElement*> Elements;
+
+    //! Cached matrix of element e is stored in Matrices from MatrixStart[e] (if CacheMatrices)
+    bool CacheMatrices;
+    std::vector<std::size_t> MatrixStart;
+    std::vector<double> Matrices;
+
+    //! Calculate the element stiffness matrix of element e, with its internal DOFs condensed out
+    void ElementMatrix(std::size_t e, std::vector<double>& Matrix) const;
+
+    virtual void Multiply(const double* p, double* q);
+
+public:
+    //! Constructor
+    CEBESolver(CElementGroup* EleGrpList, unsigned int NUMEG, Index_t NEQ, bool _CacheMatrices,
+               double _Tolerance = 1.0e-10, unsigned int _MaxIterations = 10000);
+
+    //! Deconstructor
+    virtual ~CEBESolver();
+
+    //! Return the number of entries of the cached element matrices
+    std::size_t GetCacheSize() const { return Matrices.size(); }
+};
@@ -28,7 +28,18 @@ using namespace std;
 
 class CDomain;
 
-template <class type> void clear( type* a, unsigned int N );	// Clear an array
+#ifdef _VIB_
+//!	Mass matrices: consistent (skyline, with the profile of the stiffness matrix) or lumped to a
+//!	diagonal stored as a vector of NEQ entries
+enum class MassTypes
+{
+	Consistent,
+	RowSum,	//!< Sum of each row of the consistent element mass matrix
+	HRZ		//!< Diagonal of the consistent element mass matrix scaled to the element mass (Hinton, Rock, Zienkiewicz)
+};
+#endif
+
+template <class type> void clear( type* a, size_t N );	// Clear an array
 
 inline void normalize(double ptr[3])
 {
@@ -54,15 +65,18 @@ protected:
 	CMaterial* ElementMaterial;	//!< Pointer to an element of MaterialSetList[][]
     
 //! Location Matrix of the element
-    unsigned int* LocationMatrix;
+    Index_t* LocationMatrix;
 
 //! Dimension of the location matrix
     unsigned int ND;
 
+//! Number of trailing DOFs of the location matrix condensed out of the element stiffness matrix
+    unsigned int NumCondensed;
+
 public:
 
 //!	Constructor
-	CElement() : NEN(0), nodes(nullptr), ElementMaterial(nullptr), LocationMatrix(nullptr), ND(0) {};
+	CElement() : NEN(0), nodes(nullptr), ElementMaterial(nullptr), LocationMatrix(nullptr), ND(0), NumCondensed(0) {};
 
 //! Virtual deconstructor
     virtual ~CElement();
@@ -78,14 +92,21 @@ public:
     virtual void GenerateLocationMatrix() = 0;
     
 //! Calculate the column height, used with the skyline storage scheme
-	void CalculateColumnHeight(unsigned int* ColumnHeight); 
+	void CalculateColumnHeight(Index_t* ColumnHeight); 
 
 //!	Assemble the element stiffness matrix to the global stiffness matrix
 	void assembly(double* Matrix, CSkylineMatrix<double>* StiffnessMatrix, CSRMatrix<double>* CSRMatrix);
 
 #ifdef _VIB_
-    //!	Assemble the element stiffness matrix to the global stiffness matrix
+    //!	Assemble the element mass matrix to the global mass matrix
 	void assembly_mass(double* Matrix, CSkylineMatrix<double>* MassMatrix);
+
+    //!	Lump the consistent element mass matrix in Matrix (calculated by ElementMass) to the ND
+    //!	diagonal entries of Mass
+	void LumpMass(const double* Matrix, double* Mass, MassTypes Type);
+
+    //!	Assemble the lumped element mass matrix to the global lumped mass vector (NEQ entries)
+	void assembly_lumped_mass(double* Matrix, double* LumpedMass, MassTypes Type);
 #endif
 
 //!	Calculate element stiffness matrix (Upper triangular matrix, stored as an array column by colum)
@@ -111,7 +132,7 @@ public:
 	virtual unsigned GetLMSize() { return ND; }
 
 //! return LocationMatrix
-	unsigned* GetLocationMatrix() { return LocationMatrix; }
+	Index_t* GetLocationMatrix() { return LocationMatrix; }
 
 //!	Return material of the element
 	inline CMaterial* GetElementMaterial() { return ElementMaterial; }
@@ -119,5 +140,34 @@ public:
 //!	Return the size of the element stiffness matrix (stored as an array column by column)
 	virtual unsigned int SizeOfStiffnessMatrix() = 0;     
 
+//!	Return the number of internal nodes, which are the last nodes of the element. They may be
+//!	condensed out of the global system if no other element uses them and they are not loaded
+	virtual unsigned int GetNumInternalNodes() { return 0; }
+
+//!	Condense the DOFs of the internal nodes out of the element stiffness matrix (or keep them)
+	void SetCondensed(bool Condensed) { NumCondensed = Condensed ? GetNumInternalNodes() * (ND / NEN) : 0; }
+
+//!	Return the number of condensed DOFs
+	inline unsigned int GetNumCondensed() { return NumCondensed; }
+
+//!	Condense the last NumCondensed DOFs out of the element stiffness matrix Matrix:
+//!	K_bb - K_bi * K_ii^-1 * K_ib is left in the leading block, with the same packed storage
+	void Condense(double* Matrix);
+
+//!	Calculate the element stiffness matrix with the last NumCondensed DOFs condensed out
+	void CondensedStiffness(double* Matrix);
+
+//!	Gather the entries of the retained DOFs (the first ND - NumCondensed) of the element from the
+//!	global vector Global (NEQ entries) to Local, the fixed DOFs being zero
+	void GatherDOFs(const double* Global, double* Local);
+
+//!	y = Matrix * x on the retained DOFs, Matrix being the element stiffness matrix returned by
+//!	CondensedStiffness
+	void MatrixProduct(const double* Matrix, const double* x, double* y);
+
+//!	Recover the displacements of the condensed DOFs from those of the other DOFs of the element
+//!	(Displacement holds all equations, the condensed ones included)
+	void RecoverCondensed(double* Displacement);
+
 	friend class CDomain;	// Allow class Domain to access its protected member
 };
\ No newline at end of file
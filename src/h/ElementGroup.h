@@ -103,6 +103,9 @@ public:
 
     CElement& GetElement(unsigned int index);
 
+    //! Append the addresses of all elements of the group to Elements
+    void AppendElements(std::vector<CElement*>& Elements);
+
     CMaterial& GetMaterial(unsigned int index);
 
     //! Return the number of material/section property setss in this element group
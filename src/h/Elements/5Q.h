@@ -41,9 +41,17 @@ public:
 //!	Calculate element stress
 	virtual void ElementStress(double* Q4stress, double* Displacement);
 
+#ifdef _VIB_
+//!	Calculate element mass matrix (not available yet, the matrix is zero)
+	virtual void ElementMass(double* mass);
+#endif
+
 //! Calculate coordinate of gauss point
 	virtual void ElementGauss(double* Coordinate);
 
 //!	Return the size of the element stiffness matrix (stored as an array column by column)
 	virtual unsigned int SizeOfStiffnessMatrix();
+
+//!	The fifth node is condensed if it belongs to this element only
+	virtual unsigned int GetNumInternalNodes() { return 1; }
 };
@@ -36,6 +36,9 @@ public:
     //!	Return the size of the element stiffness matrix (stored as an array column by column)
     virtual unsigned int SizeOfStiffnessMatrix();
 
+    //!	The center node is internal
+    virtual unsigned int GetNumInternalNodes() { return 1; }
+
 #ifdef _VIB_
 //!	Calculate element mass matrix (Upper triangular matrix, stored as an array column by colum)
 	virtual void ElementMass(double* mass); 
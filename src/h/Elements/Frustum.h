@@ -41,6 +41,11 @@ public:
 	//!	Calculate element stress
 	virtual void ElementStress(double* stress, double* Displacement);
 
+#ifdef _VIB_
+	//!	Calculate element mass matrix (not available yet, the matrix is zero)
+	virtual void ElementMass(double* mass);
+#endif
+
 	//!	Return the size of the element stiffness matrix (stored as an array column by column)
 	virtual unsigned int SizeOfStiffnessMatrix();
 };
@@ -0,0 +1,24 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#pragma once
+
+//! Index types of the global matrices
+/*! Index_t numbers the equations and addresses the entries of the skyline matrix (NEQ, NWK,
+    LocationMatrix, ColumnHeights, DiagonalAddress), and CSRIndex_t addresses the rows and
+    entries of the CSR matrix. They are 32-bit unless STAP++_INDEX64 is set, in which case
+    skyline profiles above 4G entries and CSR matrices above 2G nonzeros can be stored. */
+#ifdef _INDEX64_
+typedef unsigned long long Index_t;
+typedef long long CSRIndex_t;
+#else
+typedef unsigned int Index_t;
+typedef int CSRIndex_t;
+#endif
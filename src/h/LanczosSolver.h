@@ -0,0 +1,103 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+#include "Solver.h"
+
+//! Block Lanczos eigensolver of K x = lambda M x in shift-invert mode
+/*! The Lanczos basis Q is built from the operator OP = (K - Shift*M)^-1 M, applied to BlockSize
+    vectors at a time with the LDLT factor of K - Shift*M, and kept M-orthonormal by full
+    reorthogonalization. The eigenvalues theta of the projected matrix T = Q^T M OP Q give
+    lambda = Shift + 1/theta, the eigenvalues nearest to Shift converging first. A Ritz pair is
+    converged once its residual ||OP x - theta x||_M <= Tolerance * |theta|. When the basis
+    is full, the Lanczos process is restarted from the wanted Ritz vectors (thick restart).
+    Blocks that become linearly dependent are deflated. */
+class CLanczosSolver
+{
+protected:
+    //! LDLT factor of K - Shift*M
+    CLDLTSolver& Solver;
+
+    //! Mass matrix, consistent (skyline) or lumped (diagonal of NEQ entries)
+    CSkylineMatrix<double>* M;
+    const double* LumpedM;
+
+    double Shift;
+
+    //! Number of vectors OP is applied to at a time (0: chosen from the number of modes)
+    unsigned int BlockSize;
+
+    double Tolerance;
+
+    //! Threads of the products by M
+    unsigned int NumThreads;
+
+    //! Number of vectors OP was applied to, and of restarts, in the last solution
+    unsigned int Applications;
+    unsigned int Restarts;
+
+    //! Number of equations and of columns of Q
+    Index_t N;
+    unsigned int Columns;
+
+    //! Basis Q and M*Q (N x Columns, column major)
+    std::vector<double> Q, MQ;
+
+    //! MW = M*W for the Width vectors in W (N x Width)
+    void MultiplyMass(const double* W, double* MW, unsigned int Width);
+
+    //! Replace the products M*x of Width vectors in W (N x Width) by OP*x
+    void Apply(double* W, unsigned int Width);
+
+    //! M-orthogonalize the Width vectors W to the first Basis columns of Q (twice), returning
+    //! the coefficients in C (Basis x Width, column major)
+    void Orthogonalize(double* W, unsigned int Width, unsigned int Basis, std::vector<double>& C);
+
+    //! Make the Width vectors W M-orthonormal, MW holding their products by M. The vectors whose
+    //! squared M-norm falls below a round-off multiple of Scale are dropped as linearly dependent.
+    //! Return the number of vectors kept, with W_old = W_new * R (R: kept x Width, column major)
+    unsigned int Orthonormalize(double* W, double* MW, unsigned int Width, double Scale,
+                                std::vector<double>& R);
+
+    //! Start a block of random vectors at column Basis of Q, M-orthonormal to the columns before
+    //! it. Return its width
+    unsigned int RandomBlock(unsigned int Basis, unsigned int Width, unsigned int Seed);
+
+public:
+    //! Constructor, Solver holding the factor of K - Shift*M
+    CLanczosSolver(CLDLTSolver& _Solver, CSkylineMatrix<double>& _M, double _Shift = 0.0,
+                   unsigned int _BlockSize = 0, double _Tolerance = 1.0e-10)
+        : Solver(_Solver), M(&_M), LumpedM(nullptr), Shift(_Shift), BlockSize(_BlockSize),
+          Tolerance(_Tolerance), NumThreads(1), Applications(0), Restarts(0), N(0), Columns(0){};
+
+    //! Constructor for a lumped mass matrix, whose diagonal is _LumpedM
+    CLanczosSolver(CLDLTSolver& _Solver, const double* _LumpedM, double _Shift = 0.0,
+                   unsigned int _BlockSize = 0, double _Tolerance = 1.0e-10)
+        : Solver(_Solver), M(nullptr), LumpedM(_LumpedM), Shift(_Shift), BlockSize(_BlockSize),
+          Tolerance(_Tolerance), NumThreads(1), Applications(0), Restarts(0), N(0), Columns(0){};
+
+    //! Calculate the NumModes eigenvalues nearest to Shift, in increasing order, and their
+    //! M-orthonormal eigenvectors, stored one after another in EigenVectors (NEQ x NumModes).
+    //! Return false if they do not converge in MaxRestarts restarts
+    bool Solve(unsigned int NumModes, double* EigenValues, double* EigenVectors,
+               unsigned int MaxRestarts = 100);
+
+    //! Multiply by M on NumThreads threads (0: all hardware threads)
+    inline void SetNumThreads(unsigned int Threads) { NumThreads = Threads; }
+
+    //! Return the number of vectors OP was applied to in the last solution
+    inline unsigned int GetApplications() const { return Applications; }
+
+    //! Return the number of restarts of the last solution
+    inline unsigned int GetRestarts() const { return Restarts; }
+};
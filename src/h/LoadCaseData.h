@@ -27,9 +27,13 @@ public:
 	unsigned int* dof;		//!< Degree of freedom number for this load component
 	double* load;			//!< Magnitude of load
 
+	unsigned int npoints;	//!< Number of points of the time function (0: the loads are constant)
+	double* time;			//!< Times of the points, in increasing order
+	double* factor;			//!< Factors the loads are multiplied by at these times
+
 public:
 
-	CLoadCaseData() : nloads(0), node(NULL), dof(NULL), load(NULL) {};
+	CLoadCaseData() : nloads(0), node(NULL), dof(NULL), load(NULL), npoints(0), time(NULL), factor(NULL) {};
 	~CLoadCaseData();
 
 //!	Set nloads, and new array node, dof and load
@@ -40,4 +44,11 @@ public:
 
 //!	Write load case data to stream
 	void Write(COutputter& output, unsigned int lcase);
+
+//!	Read the time function of the load case from stream Input
+	bool ReadTimeFunction(ifstream& Input, unsigned int lcase);
+
+//!	Return the factor of the loads at time t, interpolated linearly between the points of the
+//!	time function and kept constant beyond its first and last points
+	double TimeFunction(double t) const;
 };
@@ -0,0 +1,90 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+#include "Solver.h"
+
+//! Implicit linear dynamics M a + C v + K u = F(t) by the HHT-alpha method
+/*! With alpha in [-1/3, 0], beta = (1 - alpha)^2 / 4 and gamma = 1/2 - alpha, the equation of
+    motion is satisfied at t_n+1 with the elastic and damping forces and the loads averaged as
+    (1 + alpha) X_n+1 - alpha X_n, and u, v are updated by the Newmark formulas. alpha = 0 is
+    the Newmark average acceleration (trapezoidal) rule, negative alpha damps the high
+    frequencies. The damping is of Rayleigh type, C = DampingM*M + DampingK*K.
+    The step size is constant, so the effective stiffness
+        K_eff = (1/(beta dt^2) + (1 + alpha) gamma/(beta dt) DampingM) M
+                + (1 + alpha)(1 + gamma/(beta dt) DampingK) K
+    is assembled and factorized once. Each step then costs one back substitution and one product
+    by K and by M. K itself is left unchanged, so it can still be factorized for the static
+    load cases. */
+class CNewmarkSolver
+{
+protected:
+    //! Stiffness matrix, and the mass matrix, consistent (skyline) or lumped (diagonal)
+    CSkylineMatrix<double>& K;
+    CSkylineMatrix<double>* M;
+    const double* LumpedM;
+
+    double TimeStep;
+    double Alpha, Beta, Gamma;
+    double DampingM, DampingK;
+
+    //! Threads of the factorization and of the products
+    unsigned int NumThreads;
+
+    Index_t N;
+
+    //! Effective stiffness matrix and its factor
+    CSkylineMatrix<double>* Effective;
+    CLDLTSolver* EffectiveSolver;
+
+    //! Time, displacements, velocities and accelerations
+    double Time;
+    std::vector<double> U, V, A;
+
+    //! Work vectors
+    std::vector<double> R, W, X;
+
+    //! y = M*x
+    void MultiplyMass(const double* x, double* y);
+
+    //! Assemble and factorize the effective stiffness matrix
+    void Factorize();
+
+public:
+    //! Constructor
+    CNewmarkSolver(CSkylineMatrix<double>& _K, CSkylineMatrix<double>& _M, double _TimeStep,
+                   double _Alpha = 0.0, double _DampingM = 0.0, double _DampingK = 0.0,
+                   unsigned int _NumThreads = 1);
+
+    //! Constructor for a lumped mass matrix, whose diagonal is _LumpedM
+    CNewmarkSolver(CSkylineMatrix<double>& _K, const double* _LumpedM, double _TimeStep,
+                   double _Alpha = 0.0, double _DampingM = 0.0, double _DampingK = 0.0,
+                   unsigned int _NumThreads = 1);
+
+    ~CNewmarkSolver();
+
+    //! Start from rest (u = v = 0) at t = 0 under the loads Force, factorizing the effective
+    //! stiffness matrix (and the consistent mass matrix if the loads do not vanish)
+    void Initialize(const double* Force);
+
+    //! Advance one step, Force and NextForce being the loads at the current and at the next time
+    void Step(const double* Force, const double* NextForce);
+
+    //! Return the current time
+    inline double GetTime() const { return Time; }
+
+    //! Return the current displacements, velocities and accelerations (NEQ entries)
+    inline const double* GetDisplacement() const { return U.data(); }
+    inline const double* GetVelocity() const { return V.data(); }
+    inline const double* GetAcceleration() const { return A.data(); }
+};
@@ -11,6 +11,7 @@
 #pragma once
 
 #include "Outputter.h"
+#include "IndexTypes.h"
 
 #include <iostream>
 #include <fstream>
@@ -37,7 +38,7 @@ public:
 /*!		1: The corresponding degree of freedom in nonactive (not defined) */
 /*!	After call Domain::CalculateEquationNumber(), bcode stores the global equation number */
 /*!	corresponding to each degree of freedom of the node */
-	unsigned int bcode[NDF];
+	Index_t bcode[NDF];
 
 //! Boundary code flag marking whether the last 3 bcodes are given while inputting 
 /*!     1: Given       !*/
@@ -0,0 +1,81 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+//! Orderings of the nodes (or equations) of the model
+enum class OrderingTypes
+{
+    Input,  //!< Order of the input data
+    RCM,    //!< Reverse Cuthill-McKee
+    Sloan,  //!< Sloan profile reduction
+    AMD,    //!< Approximate minimum degree
+    ND      //!< Geometric nested dissection
+};
+
+//! Ordering of the vertices of an undirected graph
+/*! The neighbours of vertex i (numbered from 0) are Index[Start[i]:Start[i+1]-1],
+    without i itself. An ordering is returned in Order, where Order[k] is the vertex
+    to be numbered k-th. Every connected component is ordered separately. */
+class CGraphOrdering
+{
+protected:
+    std::vector<int> Start, Index;
+
+    //! Number of vertices
+    int N;
+
+    //! Breadth first search from root over the vertices with Numbered[i] false.
+    //! Level[i] receives the distance to root, and the vertices reached are returned in
+    //! Visit in the order of the search; return the number of levels
+    int LevelStructure(int root, const std::vector<bool>& Numbered, std::vector<int>& Level,
+                       std::vector<int>& Visit) const;
+
+    //! Find the two ends (Root, End) of a pseudo-diameter of the component of Root
+    //! (George and Liu). Root is replaced by a vertex of larger or equal eccentricity
+    void PseudoPeripheral(int& Root, int& End, const std::vector<bool>& Numbered) const;
+
+    //! Dissect the vertices in Part recursively and append them to Order
+    //! (Side is a workspace of size N filled with -1)
+    void Dissect(std::vector<int>& Part, const std::vector<double>& XYZ, std::vector<int>& Side,
+                 std::vector<int>& Order, int LeafSize) const;
+
+public:
+    //! Constructor
+    CGraphOrdering(const std::vector<int>& _Start, const std::vector<int>& _Index)
+        : Start(_Start), Index(_Index), N(int(_Start.size()) - 1){};
+
+    //! Return the degree of vertex i
+    int Degree(int i) const { return Start[i + 1] - Start[i]; }
+
+    //! Reverse Cuthill-McKee ordering
+    void RCM(std::vector<int>& Order) const;
+
+    //! Sloan ordering with priority W1*distance(i, End) - W2*(Degree(i)+1)
+    void Sloan(std::vector<int>& Order, int W1 = 1, int W2 = 2) const;
+
+    //! Approximate minimum degree ordering (Amestoy, Davis and Duff) on the quotient graph,
+    //! where vertex i stands for Weight[i] equations coupled with each other
+    void AMD(const std::vector<int>& Weight, std::vector<int>& Order) const;
+
+    //! Geometric nested dissection: split the vertices at the median coordinate along the
+    //! longest side of their bounding box, number the separator last and recurse on both
+    //! halves down to LeafSize vertices. XYZ holds the 3 coordinates of each vertex
+    void NestedDissection(const std::vector<double>& XYZ, std::vector<int>& Order,
+                          int LeafSize = 64) const;
+
+    //! Predict the entries of L (including the diagonal) and the floating point operations
+    //! (sum of the squared column counts) of the factorization of the equations numbered by
+    //! Order, where vertex i stands for Weight[i] equations coupled with each other
+    void SymbolicFactorization(const std::vector<int>& Order, const std::vector<int>& Weight,
+                               double& Fill, double& Flops) const;
+};
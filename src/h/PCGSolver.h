@@ -0,0 +1,152 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+#include "Solver.h"
+
+//! Preconditioners of the PCG solver
+enum class PreconditionerTypes
+{
+    Jacobi,         //!< Inverse of the diagonal
+    BlockJacobi,    //!< Inverse of the diagonal block of each node
+    IC0,            //!< Incomplete Cholesky factorization on the pattern of K
+    AMG             //!< Smoothed aggregation algebraic multigrid
+};
+
+//! Base class for a preconditioner M of the PCG solver
+class CPreconditioner
+{
+public:
+    //! Virtual deconstructor
+    virtual ~CPreconditioner(){};
+
+    //! Apply the preconditioner: z = M^(-1) r
+    virtual void Apply(const double* r, double* z) = 0;
+};
+
+//! Jacobi preconditioner: M = diag(K)
+class CJacobiPreconditioner : public CPreconditioner
+{
+protected:
+    std::vector<double> InvDiagonal;
+
+public:
+    CJacobiPreconditioner(CSRMatrix<double>& K);
+
+    //! Constructor from the diagonal of K
+    CJacobiPreconditioner(const std::vector<double>& Diagonal);
+
+    virtual void Apply(const double* r, double* z);
+};
+
+//! Block Jacobi preconditioner: M holds the diagonal blocks of K coupling the DOFs of a node
+/*! Block b is made of the equations (numbered from 0) BlockIndex[BlockStart[b]:BlockStart[b+1]-1].
+    Equations not listed in any block are treated as blocks of size 1. */
+class CBlockJacobiPreconditioner : public CPreconditioner
+{
+protected:
+    std::vector<int> BlockStart, BlockIndex;
+
+    //! Inverse of block b (dense, column major) is stored in InvBlocks from InvStart[b]
+    std::vector<double> InvBlocks;
+    std::vector<std::size_t> InvStart;
+
+public:
+    CBlockJacobiPreconditioner(CSRMatrix<double>& K, const std::vector<int>& _BlockStart,
+                               const std::vector<int>& _BlockIndex);
+
+    virtual void Apply(const double* r, double* z);
+};
+
+//! IC(0) preconditioner: M = U^T*U with U restricted to the pattern of the upper triangle of K
+/*! If a pivot breaks down, the factorization is restarted on K + alpha*diag(K) with
+    an increasing shift alpha. */
+class CIC0Preconditioner : public CPreconditioner
+{
+protected:
+    CSRMatrix<double>& K;
+    std::vector<double> U;
+
+    //! Diagonal shift used in the successful factorization
+    double Shift;
+
+    //! Factorize K + alpha*diag(K); return false if a pivot is not positive
+    bool Factorize(double alpha);
+
+public:
+    CIC0Preconditioner(CSRMatrix<double>& _K);
+
+    virtual void Apply(const double* r, double* z);
+
+    double GetShift() const { return Shift; }
+};
+
+//! Preconditioned conjugate gradient solver for the CSR (upper triangular) stiffness matrix
+/*! Only K, the preconditioner and four work vectors are stored, so the memory grows
+    linearly with the number of nonzeros. */
+class CPCGSolver : public CSolver
+{
+protected:
+    //! Stiffness matrix (nullptr if K*x is calculated without it)
+    CSRMatrix<double>* K;
+
+    //! Number of equations
+    Index_t N;
+
+    //! Number of threads of the products K*p
+    unsigned int NumThreads;
+
+    //! Preconditioner (owned by the caller)
+    CPreconditioner* M;
+
+    //! Convergence tolerance on the relative residual ||K*a - R|| / ||R||
+    double Tolerance;
+
+    //! Maximum number of iterations
+    unsigned int MaxIterations;
+
+    //! Number of iterations and relative residual of the last solution
+    unsigned int Iterations;
+    double Residual;
+
+    //! Constructor of a solver calculating K*x without an assembled matrix (in Multiply)
+    CPCGSolver(Index_t _N, CPreconditioner* _M, double _Tolerance, unsigned int _MaxIterations)
+        : K(nullptr), N(_N), NumThreads(1), M(_M), Tolerance(_Tolerance), MaxIterations(_MaxIterations),
+          Iterations(0), Residual(0.0){};
+
+    //! q = K * p
+    virtual void Multiply(const double* p, double* q) { K->multiply(p, q, 1, NumThreads); }
+
+public:
+    //! Constructor
+    CPCGSolver(CSRMatrix<double>& _K, CPreconditioner* _M, double _Tolerance = 1.0e-10,
+               unsigned int _MaxIterations = 10000)
+        : CSolver(_K), K(&_K), N(_K.size), NumThreads(1), M(_M), Tolerance(_Tolerance),
+          MaxIterations(_MaxIterations), Iterations(0), Residual(0.0){};
+
+    //! Virtual deconstructor
+    virtual ~CPCGSolver(){};
+
+    //! Solve K*a = Force, the displacement a is returned in Force.
+    //! Return false if the tolerance is not reached within MaxIterations
+    bool Solve(double* Force);
+
+    //! Calculate the products K*p on NumThreads threads (0: all hardware threads)
+    void SetNumThreads(unsigned int _NumThreads) { NumThreads = _NumThreads; }
+
+    //! Return the number of iterations of the last solution
+    unsigned int GetIterations() const { return Iterations; }
+
+    //! Return the relative residual of the last solution
+    double GetResidual() const { return Residual; }
+};
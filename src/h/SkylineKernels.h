@@ -0,0 +1,52 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+
+#include "IndexTypes.h"
+
+//! Instruction sets of the kernels on the column segments of the skyline storage
+enum class SIMDLevels
+{
+    Scalar,     //!< Plain loops
+    SSE2,       //!< 128-bit vectors
+    AVX2,       //!< 256-bit vectors with fused multiply-add
+    AVX512      //!< 512-bit vectors with fused multiply-add and masked tails
+};
+
+//! Kernels on raw column segments of the skyline storage, used by the LDLT solvers and by the
+//! matrix-vector products, and on the rows of the CSR storage
+/*! The kernels are chosen once at start-up for the best instruction set supported by the CPU
+    (x86 with GCC or Clang; the scalar loops elsewhere). A kernel always sums its products in
+    the same order for a given instruction set, so all the factorizations of the LDLT solver
+    give bitwise identical factors on the same machine. */
+
+//! Return sum(a[k]*b[k], k=0:n-1)
+extern double (*SkylineDot)(const double* a, const double* b, std::size_t n);
+extern float (*SkylineDotFloat)(const float* a, const float* b, std::size_t n);
+
+//! Return sum(a[k]*b[n-1-k], k=0:n-1), i.e. the product of a and of b read backwards
+extern double (*SkylineReverseDot)(const double* a, const double* b, std::size_t n);
+
+//! y[k] -= alpha*x[n-1-k], k=0:n-1
+extern void (*SkylineReverseAxpy)(double* y, double alpha, const double* x, std::size_t n);
+
+//! Return sum(a[k]*x[index[k]-1], k=0:n-1) and add alpha*a[k] to y[index[k]-1-offset], k=0:n-1,
+//! i.e. the products of a row of the CSR storage (with indices from 1) and of its transpose
+extern double (*SparseRowProduct)(const double* a, const CSRIndex_t* index, std::size_t n, const double* x, double* y,
+                                  CSRIndex_t offset, double alpha);
+
+//! Return the instruction set of the kernels in use
+SIMDLevels GetSIMDLevel();
+
+//! Use the kernels of instruction set Level, or of the best one supported by the CPU below it
+void SetSIMDLevel(SIMDLevels Level);
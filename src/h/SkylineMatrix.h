@@ -11,7 +11,12 @@
 #pragma once
 
 #include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
 #include "SparseMatrix.h"
+#include "SkylineKernels.h"
 
 //! CSkylineMatrix class is used to store the FEM stiffness matrix in skyline storage
 template <class T_>
@@ -21,51 +26,126 @@ class CSkylineMatrix : public SparseMatrix<T_>
     T_* data_;
     
 //! Dimension of the stiffness matrix
-    unsigned int NEQ_;
+    Index_t NEQ_;
     
 //! Size of the storage used to store the stiffness matrkix in skyline
-    unsigned int NWK_;
+    Index_t NWK_;
 
 //! Column hights
-    unsigned int* ColumnHeights_;
+    Index_t* ColumnHeights_;
     
 //! Diagonal address of all columns in data_
-    unsigned int* DiagonalAddress_;
-    
+    Index_t* DiagonalAddress_;
+
+//! Out-of-core storage: the matrix is kept in File_, and data_ holds the columns
+//! First_:Last_-1 only, starting from the entry Offset_ of the whole storage
+    std::fstream* File_;
+    std::string FileName_;
+    size_t Offset_;
+    size_t WindowSize_;
+    size_t Capacity_;
+    Index_t First_, Last_;
+
+//! Memory budget (number of entries) of the out-of-core window
+    size_t Budget_;
+
 public:
 
 //! constructors
     inline CSkylineMatrix();
-    inline CSkylineMatrix(unsigned int N);
+    inline CSkylineMatrix(Index_t N);
     
 //! destructor
     inline ~CSkylineMatrix();
 
 //! operator (i,j) where i and j number from 1
 //! For the sake of efficiency, the index bounds are not checked
-    inline T_& operator()(unsigned int i, unsigned int j);
+    inline T_& operator()(Index_t i, Index_t j);
     
 //! operator (i) where i numbers from 1
 //! For the sake of efficiency, the index bounds are not checked
-    inline T_ operator()(unsigned int i);
+    inline T_ operator()(Index_t i);
 
 //! Allocate storage for the skyline matrix
     inline void Allocate();
 
+//! Return pointer to the data_ (column j is stored from data_[DiagonalAddress_[j-1]-1-GetOffset()]
+//! upwards, where the offset is 0 unless the matrix is out of core)
+    inline T_* GetData();
+
+//! Keep the matrix in file FileName instead of memory, with at most Budget entries in memory
+//! (called instead of Allocate)
+    inline void AllocateOutOfCore(const std::string& FileName, size_t Budget);
+
+//! Return true if the matrix is kept out of core
+    inline bool IsOutOfCore() const { return File_ != nullptr; }
+
+//! Return the memory budget (number of entries) of the out-of-core window
+    inline size_t GetBudget() const { return Budget_; }
+
+//! Return the position in the whole storage of data_[0]
+    inline size_t GetOffset() const { return Offset_; }
+
+//! Return the number of entries stored in columns c0:c1-1
+    inline size_t ColumnsSize(Index_t c0, Index_t c1) const
+    {
+        return DiagonalAddress_[c1 - 1] - DiagonalAddress_[c0 - 1];
+    }
+
+//! Return true if column j is held in data_
+    inline bool HasColumn(Index_t j) const { return j >= First_ && j < Last_; }
+
+//! Bring the columns c0:c1-1 of the out-of-core matrix into data_ (read from the file,
+//! or set to zero if Read is false). The columns already in memory are reused
+    inline void LoadColumns(Index_t c0, Index_t c1, bool Read = true);
+
+//! Write the columns c0:c1-1 held in data_ back to the file
+    inline void StoreColumns(Index_t c0, Index_t c1);
+
+//! y = A * x for the symmetric matrix held in core (x and y number from 0), for NRHS vectors
+//! stored one after another, on NumThreads threads (0: all hardware threads)
+    inline void Multiply(const T_* x, T_* y, unsigned int NRHS = 1, unsigned int NumThreads = 1) const;
+
 //! Return pointer to the ColumnHeights_
-    inline unsigned int* GetColumnHeights();
+    inline Index_t* GetColumnHeights();
     
 //! Return pointer to the DiagonalAddress_
-    inline unsigned int* GetDiagonalAddress();
+    inline Index_t* GetDiagonalAddress();
 
 //! Return the dimension of the stiffness matrix
-    inline unsigned int dim() const;
+    inline Index_t dim() const;
     
 //! Return the size of the storage used to store the stiffness matrkix in skyline
-    inline unsigned int size() const;
+    inline Index_t size() const;
 
 }; /* class definition */
 
+//! Add x[j]*A(j-k, j) to row j-k of z for k = 1:Height and return the sum of A(j-k, j)*x[j-k],
+//! with Colj[k-1] = A(j-k, j) and xv[Height-k] = x[j-k], zv[Height-k] being row j-k
+template <class T_>
+inline T_ SkylineColumnProduct(const T_* Colj, const T_* xv, T_* zv, T_ xj, Index_t Height)
+{
+    T_ sum = 0;
+    for (Index_t k = 1; k <= Height; k++)
+    {
+        sum += Colj[k - 1] * xv[Height - k];
+        zv[Height - k] += Colj[k - 1] * xj;
+    }
+
+    return sum;
+}
+
+//! The double columns use the vectorized kernels, the loop above not being vectorized by the
+//! compiler because of the reduction (without SIMD the single loop above is faster)
+inline double SkylineColumnProduct(const double* Colj, const double* xv, double* zv, double xj, Index_t Height)
+{
+    if (GetSIMDLevel() == SIMDLevels::Scalar)
+        return SkylineColumnProduct<double>(Colj, xv, zv, xj, Height);
+
+    SkylineReverseAxpy(zv, -xj, Colj, Height);
+    return SkylineReverseDot(Colj, xv, Height);
+}
+
 //! constructor functions
 template <class T_>
 inline CSkylineMatrix<T_>::CSkylineMatrix() : SparseMatrix<T_>(0)
@@ -75,22 +155,31 @@ inline CSkylineMatrix<T_>::CSkylineMatrix() : SparseMatrix<T_>(0)
     data_ = nullptr;
     ColumnHeights_ = nullptr;
     DiagonalAddress_ = nullptr;
+
+    File_ = nullptr;
+    Offset_ = WindowSize_ = Capacity_ = Budget_ = 0;
+    First_ = Last_ = 0;
 }
 
 template <class T_>
-inline CSkylineMatrix<T_>::CSkylineMatrix(unsigned int N) : NWK_(0), SparseMatrix<T_>(N)
+inline CSkylineMatrix<T_>::CSkylineMatrix(Index_t N) : NWK_(0), SparseMatrix<T_>(N)
 {
     NEQ_ = N;
 
     data_ = nullptr;
     
-    ColumnHeights_ = new unsigned int [NEQ_];
-    for (unsigned int i = 0; i < NEQ_; i++)
+    ColumnHeights_ = new Index_t [NEQ_];
+    for (Index_t i = 0; i < NEQ_; i++)
         ColumnHeights_[i] = 0;
 
-    DiagonalAddress_ = new unsigned int [NEQ_ + 1];
-    for (unsigned int i = 0; i < NEQ_ + 1; i++)
+    DiagonalAddress_ = new Index_t [NEQ_ + 1];
+    for (Index_t i = 0; i < NEQ_ + 1; i++)
         DiagonalAddress_[i] = 0;
+
+    File_ = nullptr;
+    Offset_ = WindowSize_ = Capacity_ = Budget_ = 0;
+    First_ = 1;
+    Last_ = NEQ_ + 1;
 }
 
 //! destructor function
@@ -105,21 +194,27 @@ inline CSkylineMatrix<T_>::~CSkylineMatrix()
     
     if (data_)
         delete[] data_;
+
+    if (File_)
+    {
+        delete File_;
+        std::remove(FileName_.c_str());
+    }
 }
 
 //! operator function (i,j) where i and j number from 1
 template <class T_>
-inline T_& CSkylineMatrix<T_>::operator()(unsigned int i, unsigned int j)
+inline T_& CSkylineMatrix<T_>::operator()(Index_t i, Index_t j)
 {
     if (j >= i)
-        return data_[DiagonalAddress_[j - 1] + (j - i) - 1];
+        return data_[DiagonalAddress_[j - 1] + (j - i) - 1 - Offset_];
     else
-        return data_[DiagonalAddress_[i - 1] + (i - j) - 1];
+        return data_[DiagonalAddress_[i - 1] + (i - j) - 1 - Offset_];
 }
 
 //! operator function (i) where i numbers from 1
 template <class T_>
-inline T_ CSkylineMatrix<T_>::operator()(unsigned int i)
+inline T_ CSkylineMatrix<T_>::operator()(Index_t i)
 {
     return data_[i];
 }
@@ -131,34 +226,159 @@ inline void CSkylineMatrix<T_>::Allocate()
     NWK_ = DiagonalAddress_[NEQ_] - DiagonalAddress_[0];
 
     data_ = new T_[NWK_];
-    for (unsigned int i = 0; i < NWK_; i++)
+    for (Index_t i = 0; i < NWK_; i++)
         data_[i] = T_(0);
 }
 
+//! Allocate the matrix in a file
+template <class T_>
+inline void CSkylineMatrix<T_>::AllocateOutOfCore(const std::string& FileName, size_t Budget)
+{
+    NWK_ = DiagonalAddress_[NEQ_] - DiagonalAddress_[0];
+
+    FileName_ = FileName;
+    File_ = new std::fstream(FileName, std::ios::in | std::ios::out | std::ios::binary |
+                                           std::ios::trunc);
+    if (!*File_)
+    {
+        std::cerr << "*** Error *** Cannot open the out-of-core file " << FileName << std::endl;
+        exit(5);
+    }
+
+    Budget_ = Budget;
+    First_ = Last_ = 1;
+}
+
+//! Bring columns c0:c1-1 into memory
+template <class T_>
+inline void CSkylineMatrix<T_>::LoadColumns(Index_t c0, Index_t c1, bool Read)
+{
+    const size_t Begin = DiagonalAddress_[c0 - 1] - 1;
+    const size_t End = DiagonalAddress_[c1 - 1] - 1;
+
+    if (End - Begin > Capacity_)
+    {
+        delete[] data_;
+        Capacity_ = End - Begin;
+        data_ = new T_[Capacity_];
+        WindowSize_ = 0;
+    }
+
+//  Entries Begin:Loaded-1 are already in memory
+    size_t Loaded = Begin;
+    if (Read && Begin >= Offset_ && Begin < Offset_ + WindowSize_ && End >= Offset_ + WindowSize_)
+    {
+        Loaded = Offset_ + WindowSize_;
+        std::memmove(data_, data_ + (Begin - Offset_), sizeof(T_) * (Loaded - Begin));
+    }
+
+    if (Read)
+    {
+        File_->seekg(sizeof(T_) * Loaded);
+        File_->read((char*)(data_ + (Loaded - Begin)), sizeof(T_) * (End - Loaded));
+    }
+    else
+        for (size_t i = 0; i < End - Begin; i++)
+            data_[i] = T_(0);
+
+    if (!*File_)
+    {
+        std::cerr << "*** Error *** Cannot read the out-of-core file " << FileName_ << std::endl;
+        exit(5);
+    }
+
+    Offset_ = Begin;
+    WindowSize_ = End - Begin;
+    First_ = c0;
+    Last_ = c1;
+}
+
+//! Write columns c0:c1-1 to the file
+template <class T_>
+inline void CSkylineMatrix<T_>::StoreColumns(Index_t c0, Index_t c1)
+{
+    const size_t Begin = DiagonalAddress_[c0 - 1] - 1;
+    const size_t End = DiagonalAddress_[c1 - 1] - 1;
+
+    File_->seekp(sizeof(T_) * Begin);
+    File_->write((const char*)(data_ + (Begin - Offset_)), sizeof(T_) * (End - Begin));
+
+    if (!*File_)
+    {
+        std::cerr << "*** Error *** Cannot write the out-of-core file " << FileName_ << std::endl;
+        exit(5);
+    }
+}
+
+//! Symmetric matrix-vector product from the columns of the upper triangle
+template <class T_>
+inline void CSkylineMatrix<T_>::Multiply(const T_* x, T_* y, unsigned int NRHS, unsigned int NumThreads) const
+{
+    const Index_t N = NEQ_;
+
+    auto Start = [this](Index_t j) { return DiagonalAddress_[j]; };
+
+//  Column j reaches the rows j - ColumnHeights_[j] up to j
+    auto Range = [this](Index_t j0, Index_t j1, Index_t& lo, Index_t& hi) {
+        lo = j0;
+        hi = j1;
+        for (Index_t j = j0; j < j1; j++)
+            lo = std::min(lo, j - ColumnHeights_[j]);
+    };
+
+//  The entries of column j above the diagonal are contiguous, Colj[k] = A(j-k, j), so the
+//  loop over k runs over contiguous x, y and data_
+    auto Kernel = [this, x, N, NRHS](Index_t j0, Index_t j1, Index_t lo, T_* z, Index_t ldz) {
+        for (Index_t j = j0; j < j1; j++)
+        {
+            const T_* Colj = data_ + DiagonalAddress_[j] - 1;
+            const Index_t Height = ColumnHeights_[j];
+
+            for (unsigned int v = 0; v < NRHS; v++)
+            {
+                const T_* xv = x + (std::size_t)v * N + j - Height;       // xv[Height-k] = x[j-k]
+                T_* zv = z + (std::size_t)v * ldz + j - Height - lo;    // zv[Height-k] is row j-k
+                const T_ xj = xv[Height];
+
+                zv[Height] += Colj[0] * xj + SkylineColumnProduct(Colj + 1, xv, zv, xj, Height);
+            }
+        }
+    };
+
+    SymmetricProduct(N, y, NRHS, NumThreads, Start, Range, Kernel);
+}
+
+//! Return pointer to the data_
+template <class T_>
+inline T_* CSkylineMatrix<T_>::GetData()
+{
+    return data_;
+}
+
 //! Return pointer to the ColumnHeights_
 template <class T_>
-inline unsigned int* CSkylineMatrix<T_>::GetColumnHeights()
+inline Index_t* CSkylineMatrix<T_>::GetColumnHeights()
 {
     return ColumnHeights_;
 }
 
 //! Return pointer to the DiagonalAddress_
 template <class T_>
-inline unsigned int* CSkylineMatrix<T_>::GetDiagonalAddress()
+inline Index_t* CSkylineMatrix<T_>::GetDiagonalAddress()
 {
     return DiagonalAddress_;
 }
 
 //! Return the dimension of the stiffness matrix
 template <class T_>
-inline unsigned int CSkylineMatrix<T_>::dim() const
+inline Index_t CSkylineMatrix<T_>::dim() const
 {
     return(NEQ_);
 }
 
 //! Return the size of the storage used to store the stiffness matrkix in skyline
 template <class T_>
-inline unsigned int CSkylineMatrix<T_>::size() const
+inline Index_t CSkylineMatrix<T_>::size() const
 {
    return(NWK_);
 }
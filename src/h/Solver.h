@@ -10,10 +10,28 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include "CSRMatrix.h"
 #include "SkylineMatrix.h"
 #include "SparseMatrix.h"
 
+//!	Solvers of the global equilibrium equations
+enum class SolverTypes
+{
+    LDLT,       //!< Skyline storage, column reduction LDLT solver (CLDLTSolver)
+    Sparse,     //!< CSR storage, supernodal multifrontal LDLT solver (CSparseLDLTSolver)
+    PCG,        //!< CSR storage, preconditioned conjugate gradient solver (CPCGSolver)
+    EBE,        //!< No global matrix, element-by-element PCG solver (CEBESolver)
+    Substructure,   //!< Substructures condensed to the interface equations (CSubstructureSolver)
+    PARDISO,    //!< CSR storage, MKL PARDISO solver (CSRSolver), only with USE_MKL
+    Auto        //!< LDLT, Sparse or PCG, chosen by CDomain::ChooseSolver from the size of the model
+};
+
 //!	Base class for a solver
 /*	New solver should be derived from this base class, and match the storage scheme
     of the global stiffness matrix employed in Domain class. */
@@ -21,6 +39,46 @@ class CSolver
 {
 public:
     CSolver(SparseMatrix<double>& _K){};
+
+    //! Constructor of a solver without an assembled stiffness matrix
+    CSolver(){};
+};
+
+//!	Completion flags of the columns factored by CLDLTSolver::ParallelLDLT
+/*!	A thread needing a column that is not factored yet blocks on the condition variable of the
+    panel of the column instead of spinning, so that it leaves its core to the threads still
+    reducing. The columns are marked one by one as they are factored, and the waiting threads are
+    woken up once per panel, only those waiting for a column of that panel. */
+class CColumnFlags
+{
+protected:
+    //!	Mutex and condition variable of a panel
+    struct CPanel
+    {
+        std::mutex Mutex;
+        std::condition_variable Factored;
+    };
+
+    std::unique_ptr<std::atomic<bool>[]> Done;
+    std::unique_ptr<CPanel[]> Panels;
+    Index_t PanelSize;
+
+    //!	Return the panel of column i, the panels starting from column 2
+    inline CPanel& PanelOf(Index_t i) { return Panels[(i - 2) / PanelSize]; }
+
+public:
+    //!	Constructor, only column 1 (which needs no reduction) of the N columns being factored.
+    //!	The columns 2:N are reduced in panels of _PanelSize columns
+    CColumnFlags(Index_t N, Index_t _PanelSize);
+
+    //!	Block until column i (numbered from 1) is factored
+    void Wait(Index_t i);
+
+    //!	Mark column i as factored, without waking up the threads waiting for it
+    void MarkFactored(Index_t i);
+
+    //!	Wake up the threads waiting for a column of the panel starting at column p0
+    void Signal(Index_t p0);
 };
 
 //!	LDLT solver: A in core solver using skyline storage  and column reduction scheme
@@ -29,27 +87,161 @@ class CLDLTSolver : public CSolver
 protected:
     CSkylineMatrix<double>& K;
 
+    //!	Reduce columns p0:p1-1. If Flags is given, every column of the previous panels is
+    //!	waited for in Flags just before it is used, the columns are marked once factored and
+    //!	the panel is signalled at the end
+    void ReducePanel(Index_t p0, Index_t p1, CColumnFlags* Flags);
+
+    //!	Reduce and back substitute NRHS load vectors with the factor streamed from the file
+    void OutOfCoreSubstitution(double* Force, unsigned int NRHS);
+
+    //!	Parent[i-1] is the parent of equation i in the elimination tree of the skyline, i.e. the
+    //!	first equation whose column reaches row i (0 for a root), built on first use
+    std::vector<Index_t> Parent;
+
+    //!	Mark in Reached the equations whose reduced loads may be nonzero: those of the nonzero
+    //!	entries of the NRHS load vectors in Force and their ancestors in the elimination tree.
+    //!	Return the first nonzero equation (numbered from 1), or N+1 if all loads are zero
+    Index_t ForwardReach(const double* Force, unsigned int NRHS, std::vector<char>& Reached);
+
 public:
     //!	Constructor
     CLDLTSolver(CSkylineMatrix<double>& _K) : CSolver(_K), K(_K){};
 
+    //!	Return the number of equations
+    inline Index_t dim() const { return K.dim(); }
+
     //!	Perform L*D*L(T) factorization of the stiffness matrix
     void LDLT();
 
+    //!	Perform L*D*L(T) factorization panel by panel
+    /*!	PanelSize neighbouring columns are reduced together, so that every factored column
+        is streamed once per panel instead of once per column. The factor is stored in the
+        same layout (and is bitwise identical) as the one produced by LDLT(). */
+    void BlockLDLT(unsigned int PanelSize = 64);
+
+    //!	Perform L*D*L(T) factorization on NumThreads threads (0: all hardware threads)
+    /*!	Panels of PanelSize columns are handed out in increasing order. A panel is updated by
+        the factored columns its skyline reaches into one after another, and waits for a column
+        only when it comes to it, so the updates by the columns factored long ago overlap the
+        reduction of the previous panels. The factor is bitwise identical to LDLT() whatever
+        the number of threads. */
+    void ParallelLDLT(unsigned int NumThreads, unsigned int PanelSize = 16);
+
+    //!	Perform L*D*L(T) factorization of a matrix kept out of core
+    /*!	The matrix is reduced panel by panel, each panel holding as many columns as the
+        memory budget of K allows for them and for the factored columns they depend on.
+        The factor is bitwise identical to LDLT(). BackSubstitution streams it from the file. */
+    void OutOfCoreLDLT();
+
+    //!	Return the number of negative pivots of the factor held in core, which is the number of
+    //!	negative eigenvalues of the matrix factorized (Sylvester's law of inertia)
+    Index_t NegativePivots();
+
     //!	Reduce right-hand-side load vector and back substitute
+    /*!	The forward reduction starts at the first nonzero load and skips the equations that no
+        nonzero load reaches through the elimination tree, so that a few concentrated loads are
+        reduced over a part of the factor only. */
     void BackSubstitution(double* Force);
-#ifdef _VIB_
-	void Multiple(double* acc,double* Force,unsigned int numeq,unsigned int vib_m);
-#endif
+
+    //!	Reduce and back substitute NRHS load vectors stored one after another in Force
+    /*!	The factor is streamed once for all load vectors, which are interleaved in a work
+        array so that every entry of the factor updates NRHS contiguous values. */
+    void BackSubstitution(double* Force, unsigned int NRHS);
+};
+
+//!	Mixed precision LDLT solver: single precision skyline factor with iterative refinement
+/*!	The factor is computed in float on a copy of K, so it takes half the memory and memory
+    traffic of the double factor. Each solution is refined in double against K itself,
+    a_{k+1} = a_k + (LDL^T)^(-1) (R - K a_k), until ||R - K a||_inf <= ||a||_inf ||K||_inf eps sqrt(N)
+    (the criterion of LAPACK dsposv). If the float factorization breaks down or the refinement
+    does not converge in MaxIterations steps, K is factorized in double instead. */
+class CMixedLDLTSolver : public CSolver
+{
+protected:
+    CSkylineMatrix<double>& K;
+
+    //!	Single precision factor, stored in the layout of K
+    std::vector<float> Factor;
+
+    //!	Infinity norm of K
+    double NormK;
+
+    //!	True once K itself has been factorized in double
+    bool DoubleFactor;
+
+    //!	Maximum number of refinement steps
+    unsigned int MaxIterations;
+
+    //!	Number of refinement steps and relative residual ||R - K a|| / ||R|| of the last solution
+    unsigned int Iterations;
+    double Residual;
+
+    //!	Solve (LDL^T) x = b with the single precision factor
+    void FactorSolve(double* x) const;
+
+    //!	Give up the single precision factor and factorize K in double
+    void FallBack(const char* Reason);
+
+public:
+    //!	Constructor
+    CMixedLDLTSolver(CSkylineMatrix<double>& _K, unsigned int _MaxIterations = 30)
+        : CSolver(_K), K(_K), NormK(0.0), DoubleFactor(false), MaxIterations(_MaxIterations),
+          Iterations(0), Residual(0.0){};
+
+    //!	Perform L*D*L(T) factorization of a single precision copy of the stiffness matrix
+    void LDLT();
+
+    //!	Solve K*a = Force by iterative refinement, the displacement a is returned in Force
+    void Solve(double* Force);
+
+    //!	Return the number of refinement steps of the last solution
+    unsigned int GetIterations() const { return Iterations; }
+
+    //!	Return the relative residual of the last solution
+    double GetResidual() const { return Residual; }
+
+    //!	Return true if the solver fell back to a double precision factor
+    bool IsDoubleFactor() const { return DoubleFactor; }
 };
 
+//!	MKL PARDISO solver for the CSR (upper triangular) stiffness matrix
+/*!	The PARDISO handle is kept between the phases: analyze() computes the fill-reducing ordering
+    and the symbolic factorization, factorize() the numerical factorization and solve() the
+    solutions for any number of load vectors. factorize() may be called again after the values
+    of K have changed on the same pattern, and solve() for as many load vectors as needed, without
+    repeating the analysis. The memory of PARDISO is released in the destructor (phase -1). */
 class CSRSolver : public CSolver
 {
 protected:
     CSRMatrix<double>& K;
 
+    //!	PARDISO handle and parameters
+    void* pt[64];
+    CSRIndex_t iparm[64];
+    CSRIndex_t mtype;
+    CSRIndex_t msglvl;
+
+    //!	Phases completed: 0 none, 1 analysis, 2 factorization
+    int Done;
+
+    //!	Run PARDISO phase on NRHS load vectors in Force (the solutions overwrite Force)
+    void Call(CSRIndex_t phase, double* Force = nullptr, CSRIndex_t NRHS = 1);
+
 public:
-    CSRSolver(CSRMatrix<double>& _K) : CSolver(_K), K(_K){};
+    //!	Constructor
+    CSRSolver(CSRMatrix<double>& _K);
+
+    //!	Destructor, releasing the memory held by PARDISO
+    ~CSRSolver();
+
+    //!	Reordering and symbolic factorization (phase 11)
+    void analyze();
+
+    //!	Numerical factorization (phase 22), after analyze()
+    void factorize();
 
-    void solve(double* Force, unsigned NLCase);
+    //!	Forward and backward substitution of NRHS load vectors stored one after another in
+    //!	Force (phase 33), after factorize(). The displacements are returned in Force
+    void solve(double* Force, unsigned NRHS = 1);
 };
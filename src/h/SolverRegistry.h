@@ -0,0 +1,89 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Solver.h"
+#include "PCGSolver.h"
+
+class COutputter;
+
+//!	Options of the solvers given on the command line
+struct CSolverOptions
+{
+    unsigned int NumThreads;        //!< 0: all hardware threads
+    unsigned int PanelSize;         //!< 0: column by column LDLT
+    PreconditionerTypes Preconditioner;
+    double Tolerance;
+    unsigned int MaxIterations;
+    std::string CacheFile;          //!< Factor cache of the skyline solver, empty for none
+    bool MixedPrecision;
+    bool CacheElementMatrices;      //!< Element matrices kept by the ebe solver
+
+    CSolverOptions()
+        : NumThreads(1), PanelSize(0), Preconditioner(PreconditionerTypes::IC0), Tolerance(1.0e-10),
+          MaxIterations(10000), MixedPrecision(false), CacheElementMatrices(true){};
+};
+
+//!	Solution of the equilibrium equations of CDomain by one of the solvers
+/*!	main() calls Assemble(), Factorize(), then Solve() and Report() for every load case. A new
+    solver is added by deriving from this class and registering it in SolverRegistry(). */
+class CSolution
+{
+protected:
+    const CSolverOptions& Options;
+
+public:
+    CSolution(const CSolverOptions& _Options) : Options(_Options){};
+
+    virtual ~CSolution(){};
+
+    //!	Assemble the global stiffness matrix, or what the solver uses instead of it
+    virtual void Assemble();
+
+    //!	Factorize the stiffness matrix, or set up the iterations
+    virtual void Factorize() = 0;
+
+    //!	Assemble the force vector of load case lcase (from 0) and replace it by the displacements.
+    //!	Called for the load cases in increasing order; the solvers using all the load vectors at
+    //!	once solve all of them at the first call
+    virtual void Solve(unsigned int lcase) = 0;
+
+    //!	Write the statistics of the last solution (iterations, residual) to Output
+    virtual void Report(COutputter&) {}
+
+    //!	Return the skyline solver holding the factor of K in double precision, or nullptr
+    virtual CLDLTSolver* GetSkylineSolver() { return nullptr; }
+};
+
+//!	Entry of the solver registry: the name of a solver on the command line, its description, and
+//!	the function creating its solution (nullptr for Auto, which is replaced by the solver chosen)
+struct CSolverEntry
+{
+    const char* Name;
+    SolverTypes Type;
+    const char* Description;
+    CSolution* (*Create)(const CSolverOptions& Options);
+};
+
+//!	Return the solvers available in this build
+const std::vector<CSolverEntry>& SolverRegistry();
+
+//!	Find the solver called Name, return false if it is not available in this build
+bool FindSolver(const std::string& Name, SolverTypes& Type);
+
+//!	Return the name of solver Type
+const char* SolverName(SolverTypes Type);
+
+//!	Create the solution by solver Type (not Auto) with Options, which must outlive it
+CSolution* CreateSolution(SolverTypes Type, const CSolverOptions& Options);
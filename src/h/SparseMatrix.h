@@ -1,12 +1,92 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "IndexTypes.h"
+#include "ThreadPool.h"
+
 template <typename T> class SparseMatrix
 {
 private:
     SparseMatrix(SparseMatrix<T>&);
 
 public:
-    SparseMatrix(unsigned size) {}
+    SparseMatrix(Index_t size) {}
 
-    virtual T& operator()(unsigned i, unsigned j) = 0;
+    //! The matrices are deleted through SparseMatrix pointers, e.g. the stiffness matrix of CDomain
+    virtual ~SparseMatrix() {}
+
+    virtual T& operator()(Index_t i, Index_t j) = 0;
 };
+
+//! y = A * x for a symmetric sparse matrix A and NRHS vectors stored one after another (N x NRHS)
+/*! Row (or column) i of the storage starts at the entry Start(i) (Start(N) is the number of
+    entries), and contributes to the rows [lo, hi) given by Range(i0, i1, lo, hi) for the rows
+    [i0, i1). Kernel(i0, i1, lo, z, ldz) adds the products of the rows [i0, i1) to z, row i of
+    vector v being z[v * ldz + i - lo].
+    The rows are split into NumThreads blocks (0: all hardware threads) of about the same number
+    of entries. Every thread sums its products into its own vectors, and the rows reached by
+    several blocks are added up afterwards, each by one thread, so that no two threads write
+    the same entry. Both steps run on the threads of CThreadPool, so that the products repeated
+    in every iteration of a solver do not start new threads. */
+template <class T, class StartFunction, class RangeFunction, class KernelFunction>
+void SymmetricProduct(Index_t N, T* y, unsigned int NRHS, unsigned int NumThreads,
+                      StartFunction Start, RangeFunction Range, KernelFunction Kernel)
+{
+    if (NumThreads == 0)
+        NumThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    if (NumThreads > N / 64)
+        NumThreads = std::max(Index_t(1), N / 64);
+
+    if (NumThreads == 1)
+    {
+        std::fill(y, y + (std::size_t)N * NRHS, T(0));
+        Kernel(0, N, 0, y, N);
+        return;
+    }
+
+//  Blocks of rows [Block[t], Block[t+1])
+    std::vector<Index_t> Block(NumThreads + 1, N), Lo(NumThreads), Hi(NumThreads);
+    const double Entries = double(Start(N) - Start(0));
+    Block[0] = 0;
+    Index_t i = 0;
+    for (unsigned int t = 1; t < NumThreads; t++)
+    {
+        while (i < N && double(Start(i) - Start(0)) < Entries * t / NumThreads)
+            i++;
+        Block[t] = i;
+    }
+
+    std::vector<std::vector<T>> Local(NumThreads);
+
+    CThreadPool::Instance().Run(NumThreads, [&](unsigned int t) {
+        if (Block[t] == Block[t + 1])
+            return;
+
+        Range(Block[t], Block[t + 1], Lo[t], Hi[t]);
+        Local[t].assign((std::size_t)(Hi[t] - Lo[t]) * NRHS, T(0));
+        Kernel(Block[t], Block[t + 1], Lo[t], Local[t].data(), Hi[t] - Lo[t]);
+    });
+
+//  Each thread sums the contributions of all blocks to the rows of its own block
+    CThreadPool::Instance().Run(NumThreads, [&](unsigned int t) {
+        for (unsigned int v = 0; v < NRHS; v++)
+            std::fill(y + (std::size_t)v * N + Block[t], y + (std::size_t)v * N + Block[t + 1], T(0));
+
+        for (unsigned int s = 0; s < NumThreads; s++)
+        {
+            if (Local[s].empty())
+                continue;
+
+            const Index_t i0 = std::max(Block[t], Lo[s]), i1 = std::min(Block[t + 1], Hi[s]);
+            const Index_t ld = Hi[s] - Lo[s];
+            for (unsigned int v = 0; v < NRHS; v++)
+                for (Index_t i = i0; i < i1; i++)
+                    y[(std::size_t)v * N + i] += Local[s][(std::size_t)v * ld + i - Lo[s]];
+        }
+    });
+}
@@ -0,0 +1,86 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Solver.h"
+
+//! Supernodal multifrontal LDLT solver for the CSR (upper triangular) stiffness matrix
+/*! Analyze() orders the equations, builds the elimination tree and the supernodal
+    structure of L. LDLT() factorizes the supernodes with dense kernels, independent
+    subtrees of the assembly tree at the same time. BackSubstitution() solves for one
+    load vector. The symbolic analysis is kept, so LDLT() may be called again after the
+    values of K have changed on the same pattern. */
+class CSparseLDLTSolver : public CSolver
+{
+protected:
+    CSRMatrix<double>& K;
+
+    //! Number of threads used in LDLT()
+    unsigned int NumThreads;
+
+    //! Dimension of the matrix
+    int N;
+
+    //! Perm[k] is the original equation (numbered from 0) eliminated in the k-th step
+    std::vector<int> Perm;
+
+    //! Lower triangle of the permuted matrix stored by columns (numbered from 0):
+    //! column k holds rows Ai[Ap[k]:Ap[k+1]-1] >= k with values K.values[Ax[...]]
+    std::vector<CSRIndex_t> Ap, Ax;
+    std::vector<int> Ai;
+
+    //! Supernode s holds the columns SuperStart[s]:SuperStart[s+1]-1
+    std::vector<int> SuperStart;
+
+    //! Parent of each supernode in the assembly tree (-1 for a root)
+    std::vector<int> SuperParent;
+
+    //! Children of supernode s are Children[ChildStart[s]:ChildStart[s+1]-1], in increasing order
+    std::vector<int> ChildStart, Children;
+
+    //! Row structure of supernode s is RowIndex[RowStart[s]:RowStart[s+1]-1]
+    //! (its own columns first, then the rows below in increasing order)
+    std::vector<std::size_t> RowStart;
+    std::vector<int> RowIndex;
+
+    //! Supernode s is stored in Factor from FactorStart[s] as a dense column major block
+    //! (rows x columns) holding the unit L with D on its diagonal
+    std::vector<std::size_t> FactorStart;
+    std::vector<double> Factor;
+
+    //! Assemble and factorize supernode s, and keep its update matrix in Update[s]
+    //! (RowMap is a workspace of size N)
+    void FactorSupernode(int s, int* RowMap, std::vector<std::vector<double>>& Update);
+
+public:
+    //! Constructor
+    CSparseLDLTSolver(CSRMatrix<double>& _K, unsigned int _NumThreads = 1)
+        : CSolver(_K), K(_K), NumThreads(_NumThreads), N(0){};
+
+    //! Symbolic analysis with the given ordering (Ordering[k] is the equation, numbered
+    //! from 0, to be eliminated k-th), or in the natural order if Ordering is nullptr
+    void Analyze(const int* Ordering = nullptr);
+
+    //! Perform the numerical L*D*L(T) factorization
+    void LDLT();
+
+    //! Reduce right-hand-side load vector and back substitute
+    void BackSubstitution(double* Force);
+
+    //! Return the number of supernodes
+    std::size_t GetNumSupernodes() const { return SuperParent.size(); }
+
+    //! Return the number of entries stored in the factor
+    std::size_t GetFactorSize() const { return FactorStart.empty() ? 0 : FactorStart.back(); }
+};
@@ -0,0 +1,70 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+#include "SkylineMatrix.h"
+
+//! Spectrum slicing: all the eigenpairs of K x = lambda M x below a cutoff
+/*! The interval [0, Cutoff) is split into NumWindows windows whose bounds are spaced uniformly
+    in frequency, i.e. in sqrt(lambda). The number of eigenvalues below a bound b is the number
+    of negative pivots of the LDLT factor of K - b*M (Sylvester's law of inertia), so the number
+    of modes in each window is known before they are calculated. The modes of a window are then
+    calculated by the block Lanczos solver shifted to its centre, and the window is accepted only
+    if it holds as many Lanczos eigenvalues as the Sturm counts of its bounds give.
+    The shifted matrices are factorized and the windows solved concurrently, each thread working
+    on its own copy of the profile of K. */
+class CSpectrumSlicer
+{
+protected:
+    //! Stiffness matrix and mass matrix, consistent (with the profile of K) or lumped (diagonal)
+    CSkylineMatrix<double>& K;
+    CSkylineMatrix<double>* M;
+    const double* LumpedM;
+
+    unsigned int NumWindows;
+
+    //! Number of windows handled at the same time
+    unsigned int NumThreads;
+
+    //! Upper bounds of the windows and the number of eigenvalues below each of them
+    std::vector<double> Bounds;
+    std::vector<Index_t> Counts;
+
+    //! Set A (with the profile of K, allocated here) to K - Shift*M
+    void ShiftedMatrix(double Shift, CSkylineMatrix<double>& A);
+
+    //! Run Task(0:Size-1) on NumThreads threads. Return false if a task returned false
+    template <class Task_>
+    bool ForEach(unsigned int Size, Task_ Task);
+
+public:
+    //! Constructor, solving NumThreads windows at a time (0: all hardware threads), with one
+    //! window per thread if NumWindows is 0
+    CSpectrumSlicer(CSkylineMatrix<double>& _K, CSkylineMatrix<double>& _M, unsigned int _NumWindows,
+                    unsigned int _NumThreads = 0);
+
+    //! Constructor for a lumped mass matrix, whose diagonal is _LumpedM
+    CSpectrumSlicer(CSkylineMatrix<double>& _K, const double* _LumpedM, unsigned int _NumWindows,
+                    unsigned int _NumThreads = 0);
+
+    //! Calculate the eigenvalues below Cutoff in increasing order, and their M-orthonormal
+    //! eigenvectors stored one after another in EigenVectors (NEQ x number of eigenvalues).
+    //! Return false if a window does not hold the modes its Sturm counts give
+    bool Solve(double Cutoff, std::vector<double>& EigenValues, std::vector<double>& EigenVectors);
+
+    //! Return the upper bounds of the windows of the last solution
+    inline const std::vector<double>& GetBounds() const { return Bounds; }
+
+    //! Return the number of eigenvalues below each bound of the last solution
+    inline const std::vector<Index_t>& GetCounts() const { return Counts; }
+};
@@ -0,0 +1,126 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#pragma once
+
+#include <vector>
+
+#include "ElementGroup.h"
+#include "SkylineMatrix.h"
+
+//! Substructuring solver
+/*! The elements are partitioned into substructures: each element group, split into NumParts
+    slabs along the longest side of the bounding box of its elements. The equations used by
+    one substructure only are its interior equations, the others are interface equations.
+    Every substructure is condensed to its interface equations,
+        S = K_bb - K_bi * K_ii^-1 * K_ib,
+    the substructures being condensed on separate threads. The interface matrix assembled
+    from the S is factorized by the skyline LDLT solver. Substructures whose elements have
+    the same stiffness matrices and the same pattern of interior and interface equations
+    share the factor of K_ii and K_ii^-1 * K_ib, which are calculated once. */
+class CSubstructureSolver
+{
+protected:
+    //! A substructure: its elements and the global equations (numbered from 1) of its interior
+    //! and interface DOFs, in the order they are met in the location matrices of the elements
+    struct CSubstructure
+    {
+        std::vector<CElement*> Elements;
+        std::vector<Index_t> Interior, Interface;
+
+        //! Local equation of every entry of the location matrices of the elements (without the
+        //! condensed DOFs): 0 for a fixed DOF, i for Interior[i-1] and -b for Interface[b-1]
+        std::vector<long long> Pattern;
+
+        //! Index of the condensed matrices used by this substructure
+        unsigned int Condensed;
+    };
+
+    //! Condensed matrices shared by identical substructures
+    struct CCondensed
+    {
+        //! Substructure from which the matrices are calculated
+        unsigned int Substructure;
+
+        //! Factor of K_ii
+        CSkylineMatrix<double>* Kii;
+
+        //! X = K_ii^-1 * K_ib (interior x interface, column major)
+        std::vector<double> X;
+
+        //! S = K_bb - K_bi * X (interface x interface, column major), released once assembled
+        std::vector<double> S;
+
+        //! Stiffness matrices of the elements of the substructure one after another, calculated
+        //! once in Partition() and released once condensed
+        std::vector<double> Matrices;
+    };
+
+    std::vector<CSubstructure> Substructures;
+    std::vector<CCondensed> Condensed;
+
+    //! Number of equations of the model
+    Index_t NEQ;
+
+    //! Interface[eq-1] is the interface equation (numbered from 1) of equation eq, or 0
+    std::vector<Index_t> InterfaceNumber;
+
+    //! Interface matrix, factorized in Factorize()
+    CSkylineMatrix<double>* KBB;
+
+    //! Split the elements of a group into NumParts slabs of consecutive element centroids
+    //! along the longest side of their bounding box
+    static void Split(std::vector<CElement*>& Elements, unsigned int NumParts,
+                      std::vector<std::vector<CElement*>>& Parts);
+
+    //! Calculate the stiffness matrices of the elements of substructure s one after another
+    void ElementMatrices(unsigned int s, std::vector<double>& Matrices) const;
+
+    //! Return true if substructure s, whose element stiffness matrices are Matrices, has the
+    //! same equation pattern and element stiffness matrices as the condensed matrices c
+    bool Identical(unsigned int s, const std::vector<double>& Matrices, unsigned int c) const;
+
+    //! Assemble and factorize K_ii of condensed matrices c, and calculate X and S
+    void CondenseSubstructure(unsigned int c);
+
+public:
+    //! Constructor
+    CSubstructureSolver() : NEQ(0), KBB(nullptr){};
+
+    //! Destructor
+    ~CSubstructureSolver();
+
+    //! Partition the elements into substructures, find the interface equations and the identical
+    //! substructures, and allocate the interface matrix
+    void Partition(CElementGroup* EleGrpList, unsigned int NUMEG, Index_t NEQ, unsigned int NumParts);
+
+    //! Condense the distinct substructures on NumThreads threads (0: all hardware threads), and
+    //! assemble the interface matrix
+    void Condense(unsigned int NumThreads);
+
+    //! Factorize the interface matrix
+    void Factorize();
+
+    //! Solve for NRHS load vectors stored one after another in Force, which are replaced by
+    //! the displacements
+    void Solve(double* Force, unsigned int NRHS = 1);
+
+    //! Return the number of substructures
+    inline std::size_t GetNumSubstructures() const { return Substructures.size(); }
+
+    //! Return the number of distinct substructures condensed
+    inline std::size_t GetNumCondensed() const { return Condensed.size(); }
+
+    //! Return the number of interface equations
+    inline Index_t GetNumInterface() const { return KBB->dim(); }
+
+    //! Return the interface matrix
+    inline CSkylineMatrix<double>& GetInterfaceMatrix() { return *KBB; }
+};
@@ -0,0 +1,65 @@
+/*****************************************************************************/
+/*  STAP++ : A C++ FEM code sharing the same input data file with STAP90     */
+/*     Computational Dynamics Laboratory                                     */
+/*     School of Aerospace Engineering, Tsinghua University                  */
+/*                                                                           */
+/*     Release 1.02, October 27, 2017                                        */
+/*                                                                           */
+/*     http://www.comdyn.cn/                                                 */
+/*****************************************************************************/
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//! Pool of worker threads kept for the whole run
+/*! The operations repeated in every iteration of a solver (matrix products of the PCG solver,
+    internal forces of the explicit solver) run their tasks on these threads instead of starting
+    new ones each time. The workers are started on first use and wait on a condition variable
+    between two calls. A call made while the pool is busy, e.g. from one of its own tasks or
+    from another thread, runs its tasks one after another on the calling thread. */
+class CThreadPool
+{
+private:
+
+//! Workers, and the mutex and condition variables guarding the task counters
+    std::vector<std::thread> Workers;
+    std::mutex Mutex;
+    std::condition_variable Start, Finished;
+
+//! Held by the thread whose tasks run on the pool
+    std::mutex Busy;
+
+//! Tasks of the current call, the next one to run and the number not finished yet
+    const std::function<void(unsigned int)>* Task;
+    unsigned int NumTasks, NextTask, Pending;
+
+//! Number of calls so far, which wakes up the workers
+    unsigned long long Generation;
+
+    bool Stop;
+
+//! Run the tasks left, Lock being held on Mutex
+    void RunTasks(std::unique_lock<std::mutex>& Lock);
+
+//! Loop of a worker thread started at call Seen
+    void Work(unsigned long long Seen);
+
+    CThreadPool();
+
+public:
+
+//! Return the pool of the program
+    static CThreadPool& Instance();
+
+//! Stop and join the workers
+    ~CThreadPool();
+
+//! Run Task(t) for t = 0:NumTasks-1, on NumTasks-1 workers and on the calling thread, and
+//! return when all of them are finished
+    void Run(unsigned int NumTasks, const std::function<void(unsigned int)>& Task);
+};
@@ -1,19 +1,48 @@
 import os
 import sys
+import math
 import platform
 
 ProjectDir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
 DataDir = ProjectDir + os.sep + 'data'
 STAP = None
 
+# Options of the static cases, each of which must reproduce the displacements of the default solver
+Options = ['-block 2',
+           '-block 16',
+           '-threads 2',
+           '-block 16 -threads 2',
+           '-solver ldlt',
+           '-solver sparse',
+           '-solver pcg',
+           '-solver pcg -precond jacobi',
+           '-solver pcg -precond block',
+           '-solver pcg -precond ic0',
+           '-solver pcg -precond amg',
+           '-renumber rcm',
+           '-renumber sloan',
+           '-solver sparse -ordering amd',
+           '-solver sparse -ordering nd',
+           '-cache ' + DataDir + os.sep + 'test.fac',   # writes the factor
+           '-cache ' + DataDir + os.sep + 'test.fac',   # reads it back
+           '-ooc 1',
+           '-precision mixed',
+           '-solver substructure -parts 4 -threads 2',
+           '-solver ebe',
+           '-solver ebe -ebe recompute',
+           '-solver pcg -threads 2',
+           '-solver auto',
+           ]
 
-def winmake(mkl=False):
+
+def winmake(mkl=False, index64=False, vib=False):
     os.chdir(ProjectDir)
     if not os.path.exists('vsbuild'):
         os.mkdir('vsbuild')
     os.chdir(ProjectDir + os.sep + 'vsbuild')
-    if os.system('cmake ../src -G "Visual Studio 15 2017 Win64" -DUSE_MKL=%s' %
-                 ('ON' if mkl else 'OFF')):
+    if os.system('cmake ../src -G "Visual Studio 15 2017 Win64" -DUSE_MKL=%s -DSTAP++_INDEX64=%s '
+                 '-DSTAP++_VIBRATION=%s' %
+                 ('ON' if mkl else 'OFF', 'ON' if index64 else 'OFF', 'ON' if vib else 'OFF')):
         quit(1)
     if os.system('msbuild stap++.vcxproj /m'):
         print('build failed.')
@@ -24,12 +53,13 @@ def winmake(mkl=False):
     os.chdir(ProjectDir)
 
 
-def unixmake(mkl=False):
+def unixmake(mkl=False, index64=False, vib=False):
     os.chdir(ProjectDir)
     if not os.path.exists('build'):
         os.mkdir('build')
     os.chdir(ProjectDir + os.sep + 'build')
-    if os.system('cmake ../src -DUSE_MKL=%s' % ('ON'if mkl else 'OFF')):
+    if os.system('cmake ../src -DUSE_MKL=%s -DSTAP++_INDEX64=%s -DSTAP++_VIBRATION=%s' %
+                 ('ON'if mkl else 'OFF', 'ON' if index64 else 'OFF', 'ON' if vib else 'OFF')):
         quit(1)
     if os.system('make'):
         print('build failed.')
@@ -39,18 +69,91 @@ def unixmake(mkl=False):
     os.chdir(ProjectDir)
 
 
+def run(name, options=''):
+    if os.system(STAP + ' ' + DataDir + os.sep + name + ' ' + options + ' > nul'):
+        print('test failed for file ' + name + ' ' + options)
+        quit(2)
+
+
+def check(name, options, passed):
+    if not passed:
+        print('test failed for file ' + name + ' ' + options)
+        quit(2)
+
+
+def output(name):
+    with open(DataDir + os.sep + name + '.out', 'r') as fp:
+        return fp.readlines()
+
+
+def displacements(name):
+    '''Nodal displacements of all load cases in the output file of name'''
+    values = []
+    reading = False
+    for line in output(name):
+        if line.startswith('  NODE') and 'X-DISPLACEMENT' in line:
+            reading = True
+        elif reading and line.split():
+            values += [float(v) for v in line.split()[1:]]
+        else:
+            reading = False
+    return values
+
+
 def test():
-    def run(name):
-        if os.system(STAP + ' ' + DataDir + os.sep + name + ' > nul'):
-            print('test failed for file ' + name)
-            quit(2)
     run('bar-6')
     run('test_truss_22')
     run('truss')
 
+#   cube-12 is large enough for the threads and panels to get work, and has two load cases
+    for name in ['bar-6', 'test_truss_22', 'truss', 'cube-12']:
+        run(name)
+        expected = displacements(name)
+        scale = max(abs(v) for v in expected)
+        for options in Options:
+            run(name, options)
+            actual = displacements(name)
+            check(name, options, len(actual) == len(expected) and
+                  all(abs(a - e) <= 1.0e-5 * scale for a, e in zip(actual, expected)))
+
     os.chdir(DataDir)
     if os.system(PY + ' run-patch.py ' + STAP):
         quit(2)
+    os.chdir(ProjectDir)
+
+
+def testvib():
+    '''Axial bar of unit length, modulus, area and density fixed at x = 0: eigenvalues
+    ((2n - 1) pi / 2)^2 and tip displacement oscillating from 0 to 2 under a unit step load'''
+    bar = 'vib' + os.sep + 'bar'
+    step = DataDir + os.sep + 'vib' + os.sep + 'step.dyn'
+
+    def modes(options, count):
+        run(bar, options)
+        values = [float(line.split()[-1]) for line in output(bar) if line.startswith('EIGEN VALUE')]
+        check(bar, options, len(values) == count and
+              all(abs(values[n] / ((n + 0.5) * math.pi) ** 2 - 1) < 1.0e-2 for n in range(count)))
+
+    modes('', 5)
+    modes('-threads 2', 5)
+    modes('-precision mixed', 5)
+    modes('-ooc 1', 5)
+    modes('-solver auto', 5)
+    modes('-cutoff 1.5', 3)     # frequencies (2n - 1) / 4 Hz
+    modes('-cutoff 1.5 -windows 3 -threads 2', 3)
+    modes('-mass hrz', 5)
+    modes('-mass rowsum', 5)
+
+    def history(options):
+        run(bar, '-dynamics ' + step + ' ' + options)
+        with open(DataDir + os.sep + bar + '.his', 'r') as fp:
+            tip = [float(line.split()[1]) for line in fp if not line.startswith('#')]
+        check(bar, '-dynamics ' + options, len(tip) == 2001 and abs(max(tip) / 2 - 1) < 0.02)
+
+    history('')
+    history('-threads 2')
+    history('-explicit')
+    history('-explicit -mass rowsum -threads 2')
 
 
 def main():
@@ -59,14 +162,22 @@ def main():
         PY = 'python'
         winmake(False)
         test()
+        winmake(False, index64=True)
+        test()
         winmake(True)
         test()
+        winmake(False, vib=True)
+        testvib()
     elif platform.system() == 'Linux':
         PY = 'python3'
         unixmake(False)
         test()
+        unixmake(False, index64=True)
+        test()
         unixmake(True)
         test()
+        unixmake(False, vib=True)
+        testvib()
     else:
         print('unsupported platform')
     print('test passed.')